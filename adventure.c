@@ -36,42 +36,54 @@
  */
 
 #include <errno.h>
-#include <pthread.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
 #include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "assert.h"
+#include "hist.h"
 #include "input.h"
 #include "modex.h"
 #include "photo.h"
+#include "pool.h"
+#include "realtime.h"
+#include "render.h"
+#include "replay.h"
+#include "server.h"
+#include "session.h"
+#include "status.h"
 #include "text.h"
+#include "timer.h"
+#include "verbs.h"
 #include "world.h"
 
 
-/*
- * If NDEBUG is not defined, we execute sanity checks to make sure that
- * changes to enumerations, bit maps, etc., have been made consistently.
- */
-#if defined(NDEBUG)
-#define sanity_check() 0
-#else
-static int sanity_check (void);
-#endif
-
-
 /* a few constants */
 #define TICK_USEC      50000 /* tick length in microseconds          */
-#define STATUS_MSG_LEN 40    /* maximum length of status message     */
+#define STATUS_MSG_TICKS (1500000 / TICK_USEC) /* message lifetime (1.5 s) */
 #define MOTION_SPEED   2     /* pixels moved per command             */
+#define MAX_TICK_CMDS  8     /* default limit on commands per tick   */
+#define STATS_JSON_FILE "adventure-stats.json" /* default for SIGUSR1  */
+#define BENCH_SEED     391   /* random seed for benchmark runs       */
+#define RENDER_HZ      60    /* default rate of showing frames       */
+#define TERM_BUDGET    8192  /* default terminal bytes per frame     */
+#define WORLD_FILE "adventure.world" /* default world description  */
 
 /* outcome of the game */
 typedef enum {GAME_WON, GAME_QUIT} game_condition_t;
 
 /* structure used to hold game information */
 typedef struct {
+    world_t*     world;		 /* the game's world                      */
     room_t*      where;		 /* current room for player               */
     unsigned int map_x, map_y;   /* current upper left display pixel      */
     int          x_speed;        /* number of pixels of x motion per move */
@@ -79,111 +91,186 @@ typedef struct {
 } game_info_t;
 
 
-/* 
- * enumerated values, structure, and static data used for parsing typed 
- * commands 
- *
- * Note that the structure allows us to abbreviate commands and to create
- * synonyms for verbs (e.g., get and grab).
- */
-typedef enum { /* TC = typed command */
-    TC_BUY,
-    TC_CHARGE,
-    TC_DO,
-    TC_DRINK,
-    TC_DROP,
-    TC_FIX,
-    TC_FLASH,
-    TC_GET,
-    TC_GO,
-    TC_INSTALL,
-    TC_INVENTORY,
-    TC_SIGH,
-    TC_USE,
-    TC_WEAR,
-    NUM_TC_VALUES
-} cmd_id_t;
-
-typedef struct typed_cmd_t typed_cmd_t;
-struct typed_cmd_t {
-    const char* name;	/* verb that must be typed               */
-    int32_t min_len;	/* minimum number of matching characters */
-    cmd_id_t cmd;	/* resulting command                     */
-};
-
-static const typed_cmd_t cmd_list[] = {
-    {"buy",       3, TC_BUY},
-    {"charge",    2, TC_CHARGE},
-    {"do",        2, TC_DO},
-    {"drink",     3, TC_DRINK},
-    {"drop",      2, TC_DROP},
-    {"fix",       3, TC_FIX},
-    {"flash",     5, TC_FLASH},
-    {"get",       1, TC_GET},
-    {"go",        2, TC_GO},
-    {"grab",      2, TC_GET},
-    {"install",   3, TC_INSTALL},
-    {"inventory", 1, TC_INVENTORY},
-    {"sigh",      4, TC_SIGH},
-    {"use",       3, TC_USE},
-    {"wear",      4, TC_WEAR},
-    {NULL, 0, 0}
-};
-
-
 /* local functions--see function headers for details */
 
-static void cancel_status_thread (void* ignore);
+static void clear_status (void* ignore);
 static game_condition_t game_loop (void);
+static void enter_new_room (void);
+static int32_t handle_command (cmd_t cmd, int32_t* enter_room);
+static int32_t handle_input (int32_t* enter_room);
 static int32_t handle_typing (void);
-static void init_game (void);
+static int32_t init_game (unsigned int seed);
 static void move_photo_down (void);
 static void move_photo_left (void);
 static void move_photo_right (void);
 static void move_photo_up (void);
+static void move_view_to (int32_t x, int32_t y);
 static void redraw_room (void);
-static void* status_thread (void* ignore);
-static int time_is_after (struct timeval* t1, struct timeval* t2);
+static void show_frame (void);
+static void update_status_bar (void);
+static void add_usec (struct timespec* t, long usec);
+static double usec_between (struct timespec* t1, struct timespec* t2);
+static double cpu_usec (void);
+static uint64_t now_ns (void);
+static void phase_done (int32_t phase, uint64_t start);
+static void record_tick_phases (void);
+static void request_stats_dump (int sig);
+static int32_t write_stats_json (const char* fname);
+static int32_t load_bench (const char* fname);
+static int32_t run_bench (void);
+static int32_t bench_command (cmd_t cmd);
+static void bench_enter (room_t* r);
+static void bench_jump (void);
+static void bench_scroll (void);
+static void bench_show (void);
+static void report_bench (void);
+static void publish_status (void* ignore, const char* s);
+static long resident_bytes (void);
+static int32_t run_sessions (int32_t n, unsigned int seed);
+static void report_world (void);
+static int32_t parse_int (const char* arg, int lo, int hi, int* val);
 
 
 /* file-scope variables */
 
 static game_info_t game_info; /* game information */
 
+/* 
+ * The work done between screen updates is split into phases, each timed
+ * separately: reading input, carrying out commands other than scrolling,
+ * scrolling and drawing rooms, building the status bar, and showing the
+ * screen.  The time spent in each phase is summed over a tick and then
+ * recorded in the phase's histogram when the screen is shown.
+ */
+enum {
+    PHASE_INPUT, PHASE_COMMAND, PHASE_DRAW, PHASE_STATUS, PHASE_SHOW,
+    NUM_PHASES
+};
+static const char* const phase_name[NUM_PHASES] = {
+    "input", "command", "draw", "status", "show"
+};
 
 /* 
- * The variables below are used to keep track of the status message helper
- * thread, with Posix thread id recorded in status_thread_id.  
- *
- * The status_msg records the current status message: when the
+ * Tick timing statistics are always kept; they are summarized at exit 
+ * with --stats, and written as JSON at exit with --json or whenever the
+ * program receives SIGUSR1.
+ */
+typedef struct {
+    struct timespec start;  /* time at which the game loop started     */
+    double start_cpu_us;    /* CPU time used before the game loop      */
+    unsigned long   ticks;  /* ticks executed                          */
+    unsigned long   missed; /* ticks skipped because the loop ran late */
+    unsigned long max_missed; /* most ticks skipped at once            */
+    unsigned long commands; /* commands carried out                    */
+    unsigned long stacked;  /* commands after the first in one tick    */
+    hist_t late;            /* wake-up lateness                        */
+    hist_t input;           /* time from input to screen update        */
+    hist_t busy;            /* time spent in all phases in a tick      */
+    hist_t phase[NUM_PHASES];     /* time spent in each phase in a tick */
+    uint64_t phase_ns[NUM_PHASES]; /* time in each phase this tick      */
+} tick_stats_t;
+static tick_stats_t tick_stats;
+
+/* where and whether to write tick statistics as JSON */
+static const char* json_file = STATS_JSON_FILE;
+static int32_t json_at_exit = 0;
+static volatile sig_atomic_t dump_requested = 0;
+
+/* 
+ * Commands are recorded when recording is set.  When replaying is set,
+ * commands come from a recording rather than the keyboard, and when
+ * fast_replay is also set, the game loop runs ticks back to back rather
+ * than waiting for the tick timer.
+ */
+static int32_t recording = 0;
+static int32_t replaying = 0;
+static int32_t fast_replay = 0;
+
+/* 
+ * A benchmark script (--bench) is a list of steps, each of which is
+ * carried out and shown without waiting for ticks; see load_bench for
+ * the script syntax.
+ */
+typedef enum {
+    BENCH_CMD,     /* carry out a command                        */
+    BENCH_TYPED,   /* carry out a typed command                  */
+    BENCH_SCROLL,  /* scroll to each edge of the room photo      */
+    BENCH_JUMP,    /* move the view by large steps in both axes  */
+    BENCH_ROOM,    /* jump to a room                             */
+    BENCH_TOUR     /* visit, scroll, and leave every room        */
+} bench_kind_t;
+
+typedef struct {
+    bench_kind_t kind;  /* type of step                    */
+    cmd_t cmd;          /* command (BENCH_CMD)             */
+    char* typed;        /* typed command (BENCH_TYPED)     */
+    room_t* room;       /* destination (BENCH_ROOM)        */
+} bench_step_t;
+
+/* benchmark measurements */
+typedef struct {
+    hist_t entry;            /* room change until room is shown */
+    unsigned long scrolls;   /* scroll ticks                    */
+    uint64_t scroll_ns;      /* time spent in scroll ticks      */
+    unsigned long jumps;     /* view jumps                      */
+    uint64_t jump_ns;        /* time spent in view jumps        */
+    unsigned long commands;  /* other commands carried out      */
+    uint64_t total_ns;       /* time for whole script           */
+    int32_t helpers;         /* threads helping to draw views   */
+} bench_stats_t;
+
+static bench_step_t* bench_step = NULL;
+static int32_t bench_len = 0;
+static bench_stats_t bench_stats;
+
+/* 
+ * Commands are taken from the input queue as they arrive, but no more
+ * than max_tick_cmds are carried out between screen updates; any others
+ * wait in the queue for the next tick.  tick_cmds counts the commands
+ * carried out since the last update, and input_time records the arrival
+ * of the first input not yet shown (if input_pending is set).
+ */
+static int32_t max_tick_cmds = MAX_TICK_CMDS;
+static int32_t tick_cmds;
+static int32_t input_pending;
+static struct timespec input_time;
+
+
+/* 
+ * The status_msg holds a copy of the current status message (see status.c),
+ * taken when its generation changes and recorded in status_gen: when the
  * string recorded there is empty, no status message need be displayed, and
  * the status bar should instead reflect the name of the current room and the
- * player's typing (for typed commands).
- *
- * The status_msg is protected by the msg_lock mutex, which should be
- * acquired before reading or writing the message.  Further, if the message
- * is changed, the helper thread must be notified by signaling it with the 
- * condition variable msg_cv (while holding the msg_lock).
- */
-static pthread_t status_thread_id;
-static pthread_mutex_t msg_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  msg_cv = PTHREAD_COND_INITIALIZER;
+ * player's typing (for typed commands).  A message is cleared by the
+ * status_timer STATUS_MSG_TICKS ticks after it is first shown.
+ */
 static char status_msg[STATUS_MSG_LEN + 1] = {'\0'};
+static uint32_t status_gen = 0;
+static tick_timer_t status_timer;
+
+/* 
+ * The frame to be shown at the next tick, handed to the render thread by
+ * show_frame.  Moving the view changes only game_info.map_x and map_y;
+ * entering a room or moving objects sets frame.new_room or frame.redraw
+ * so that the whole view is drawn, and update_status_bar writes the text
+ * for the status bar into frame.bar.
+ */
+static frame_t frame;
 
 
 /* 
- * cancel_status_thread
- *   DESCRIPTION: Terminates the status message helper thread.  Used as
- *                a cleanup method to ensure proper shutdown.
+ * clear_status
+ *   DESCRIPTION: Clear the status message when its time is up, unless
+ *                it has already been replaced.  Called by the status_timer.
  *   INPUTS: none (ignored)
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: none
+ *   SIDE EFFECTS: the status bar shows the room again at the next update
  */
 static void
-cancel_status_thread (void* ignore)
+clear_status (void* ignore)
 {
-    (void)pthread_cancel (status_thread_id);
+    (void)status_clear_if (status_gen);
 }
 
 // helper function I wrote to get length of a string as an int;
@@ -198,7 +285,12 @@ int getLength(const char * str){
 
 /* 
  * game_loop
- *   DESCRIPTION: Main event loop for the adventure game.
+ *   DESCRIPTION: Main event loop for the adventure game.  The loop waits
+ *                in poll for any of three events: keyboard input, which
+ *                is handled as soon as it arrives; expiration of a status
+ *                message; and the tick timer.  A frame is handed to the
+ *                render thread once per tick, so input handled between
+ *                ticks appears at the next tick.
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: GAME_QUIT if the player quits, or GAME_WON if they have won
@@ -211,179 +303,395 @@ game_loop ()
      * Variables used to carry information between event loop ticks; see
      * initialization below for explanations of purpose.
      */
-    struct timeval start_time, tick_time;
+    struct timespec start_time, tick_time;
+
+    struct timespec cur_time;  /* current time (during tick)           */
+    struct itimerspec period;  /* tick timer setting                   */
+    struct pollfd fds[2];      /* events for which the loop waits      */
+    uint64_t count;            /* tick timer expirations               */
+    int32_t enter_room;        /* player has changed rooms             */
+    game_condition_t game;     /* outcome of a command                 */
+    double late;               /* wake-up lateness for tick            */
+    uint64_t start;            /* start time of a phase                */
+    unsigned long missed;      /* ticks skipped at once                */
+    int tick;                  /* tick timer has expired               */
+    int32_t more;              /* recorded commands remain to replay   */
+    int timer_fd;              /* tick timer                           */
 
-    struct timeval cur_time; /* current time (during tick)      */
-    cmd_t cmd;               /* command issued by input control */
-    int32_t enter_room;      /* player has changed rooms        */
-
-    /* Record the starting time--assume success. */
-    (void)gettimeofday (&start_time, NULL);
+    /* 
+     * Record the starting time--assume success.  All tick times are 
+     * measured on the monotonic clock, which never jumps when the time
+     * of day is set.
+     */
+    (void)clock_gettime (CLOCK_MONOTONIC, &start_time);
+    tick_stats.start = start_time;
+    tick_stats.start_cpu_us = cpu_usec ();
 
     /* Calculate the time at which the first event loop tick should occur. */
     tick_time = start_time;
-    if ((tick_time.tv_usec += TICK_USEC) > 1000000) {
-	tick_time.tv_sec++;
-	tick_time.tv_usec -= 1000000;
+    add_usec (&tick_time, TICK_USEC);
+
+    /* 
+     * Start a timer that expires at each tick.  Its expiration count
+     * tells us how many ticks have passed since we last read it.
+     */
+    if (-1 == (timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC))) {
+	PANIC ("cannot create tick timer");
     }
+    period.it_value = tick_time;
+    period.it_interval.tv_sec = 0;
+    period.it_interval.tv_nsec = TICK_USEC * 1000L;
+    if (0 != timerfd_settime (timer_fd, TFD_TIMER_ABSTIME, &period, NULL)) {
+	PANIC ("cannot start tick timer");
+    }
+    fds[0].fd = timer_fd;
+    fds[0].events = (fast_replay ? 0 : POLLIN);
+    fds[1].fd = get_input_fd ();
+    fds[1].events = POLLIN;
 
     /* The player has just entered the first room. */
     enter_room = 1;
+    input_pending = 0;
 
     /* The main event loop. */
     while (1) {
 	/* 
-	 * Update the screen, preparing the VGA palette and photo-drawing
-	 * routines and drawing a new room photo first if the player has
-	 * entered a new room, then showing the screen (and status bar,
-	 * once you have it working).
+	 * Update the screen: note a new room if the player has entered
+	 * one, fill in the status bar, and hand the frame to the render
+	 * thread, which draws and shows it while this loop goes on.
 	 */
 	if (enter_room) {
-	    /* Reset the view window to (0,0). */
-	    game_info.map_x = game_info.map_y = 0;
-	    set_view_window (game_info.map_x, game_info.map_y);
-
-	    /* Discard any partially-typed command. */
-	    reset_typed_command ();
-	    
-	    /* Adjust colors and photo drawing for the current room photo. */
-	    prep_room (game_info.where);
-
-	    /* Draw the room (calls show. */
-	    redraw_room ();
+	    start = now_ns ();
+	    enter_new_room ();
 
 	    /* Only draw once on entry. */
 	    enter_room = 0;
+	    phase_done (PHASE_DRAW, start);
 	}
 
-	show_screen ();
-	
-
-	if (*status_msg){
-		(void)pthread_mutex_lock (&msg_lock);
-		char message[41]; // number of characters on status bar +1 for null
-		int i; int j = 0;
-		int offset = (40 - strlen(status_msg))/2; // offset from left of bar to write string
-		for (i = 0; i < 40; i++){
-			if ((i >= offset)&&(i < 40-offset)){
-				message[i] = status_msg[j];
-				j++;
-			} else {
-				message[i] = ' ';
-			}
-		};
-
-		//message = status_msg;
-		text_to_bar(message); 
-		(void)pthread_mutex_unlock (&msg_lock);
-	} else {
-		char barText[40];
-		const char * typed = get_typed_command();
-		const char * roomName = room_name(game_info.where);
-		int i = 0;
-		
-		int typedLength = 0; int roomNameLength = 0;
-		const char * curr = typed;
-		while ((*curr!='\0')&&curr){
-			typedLength++;
-			curr++;
-		}
-		curr = roomName;
-		while ((*curr!='\0')&&curr){
-			roomNameLength++;
-			curr++;
-		}
-		while (roomName && (*roomName!='\0') && (i < 20)){ // 20 is halfway point of bar
-			barText[i] = *roomName;
-			roomName++;
-			i++;
-		}
-		int j;
-		for (j=0; j < (40-typedLength-roomNameLength); j++){
-			barText[i] = ' ';
-			i++;
-		}
-		while (typed && (*typed!='\0') && (i<40)){
-			barText[i] = *typed;
-			typed++;
-			i++;
-		}
-		
-		text_to_bar(barText);
+	start = now_ns ();
+	update_status_bar ();
+	phase_done (PHASE_STATUS, start);
+	start = now_ns ();
+	show_frame ();
+	phase_done (PHASE_SHOW, start);
+	record_tick_phases ();
+	tick_cmds = 0;
+
+	/* Record the time from arrival of input until it was shown. */
+	if (input_pending) {
+	    (void)clock_gettime (CLOCK_MONOTONIC, &cur_time);
+	    late = usec_between (&input_time, &cur_time);
+	    hist_record (&tick_stats.input, (0 < late ? late * 1e3 : 0));
+	    input_pending = 0;
 	}
 
+	/* 
+	 * Queue any recorded commands for this tick, then carry out any
+	 * commands left waiting (by the per-tick limit, a room change, or
+	 * a recording).  A replay without a recorded quit ends once all
+	 * of its commands have been carried out.
+	 */
+	more = (replaying && replay_commands (tick_stats.ticks));
+	if (-1 != (game = handle_input (&enter_room)))
+	    return game;
+	if (replaying && !more && !enter_room && max_tick_cmds > tick_cmds)
+	    return GAME_QUIT;
+
 	/*
 	 * Wait for tick.  The tick defines the basic timing of our
-	 * event loop, and is the minimum amount of time between events.
+	 * event loop, and is the minimum amount of time between screen
+	 * updates.  Input is handled while waiting.  After a room change,
+	 * or once the limit on commands per tick is reached, input is left
+	 * waiting until the next tick.
 	 */
-	do {
-	    if (gettimeofday (&cur_time, NULL) != 0) {
-		/* Panic!  (should never happen) */
-		clear_mode_X ();
-		shutdown_input ();
-		perror ("gettimeofday");
-		exit (3);
+	tick = 0;
+	while (!tick) {
+	    fds[1].events = ((replaying || enter_room || 
+			      max_tick_cmds <= tick_cmds) ? 0 : POLLIN);
+	    if (0 > poll (fds, 2, (fast_replay ? 0 : -1))) {
+		if (EINTR != errno) {
+		    /* Panic!  (should never happen) */
+		    stop_render_thread (NULL);
+		    clear_mode_X ();
+		    shutdown_input ();
+		    perror ("poll");
+		    exit (3);
+		}
+		fds[0].revents = fds[1].revents = 0;
 	    }
-	} while (!time_is_after (&cur_time, &tick_time));
 
-	/*
-	 * Advance the tick time.  If we missed one or more ticks completely, 
-	 * i.e., if the current time is already after the time for the next 
-	 * tick, just skip the extra ticks and advance the clock to the one
-	 * that we haven't missed.
-	 */
-	do {
-	    if ((tick_time.tv_usec += TICK_USEC) > 1000000) {
-		tick_time.tv_sec++;
-		tick_time.tv_usec -= 1000000;
+	    /* Write the statistics if SIGUSR1 asked for them. */
+	    if (dump_requested) {
+		dump_requested = 0;
+		(void)write_stats_json (json_file);
 	    }
-	} while (time_is_after (&cur_time, &tick_time));
 
-	/*
-	 * Handle asynchronous events.  These events use real time rather
-	 * than tick counts for timing, although the real time is rounded
-	 * off to the nearest tick by definition.
-	 */
-	/* (none right now...) */
+	    /* A fast replay runs the next tick right away. */
+	    if (fast_replay) {
+		tick_stats.ticks++;
+		tick = 1;
+	    }
+
+	    /*
+	     * Handle the tick.  If we missed one or more ticks completely, 
+	     * the timer has expired more than once, and we just skip the
+	     * extra ticks.
+	     */
+	    if (fds[0].revents & POLLIN) {
+		if (sizeof (count) != read (timer_fd, &count, sizeof (count)))
+		    continue;
+		(void)clock_gettime (CLOCK_MONOTONIC, &cur_time);
+		for (missed = 0; 1 < count--; missed++) {
+		    add_usec (&tick_time, TICK_USEC);
+		}
+		tick_stats.missed += missed;
+		if (missed > tick_stats.max_missed)
+		    tick_stats.max_missed = missed;
+
+		/* Record how late we woke up. */
+		late = usec_between (&tick_time, &cur_time);
+		tick_stats.ticks++;
+		hist_record (&tick_stats.late, (0 < late ? late * 1e3 : 0));
+		add_usec (&tick_time, TICK_USEC);
+		tick = 1;
+	    }
+
+	    /* 
+	     * Handle synchronous events--in this case, only player commands. 
+	     * Note that typed commands that move objects may cause the room
+	     * to be redrawn.
+	     */
+	    if (fds[1].revents & POLLIN) {
+		start = now_ns ();
+		(void)read_input ();
+		phase_done (PHASE_INPUT, start);
+		if (-1 != (game = handle_input (&enter_room)))
+		    return game;
+		start = now_ns ();
+		update_status_bar ();
+		phase_done (PHASE_STATUS, start);
+	    }
+	}
 
 	/* 
-	 * Handle synchronous events--in this case, only player commands. 
-	 * Note that typed commands that move objects may cause the room
-	 * to be redrawn.
+	 * Run the timed events due by this tick.  Timers count the same
+	 * ticks as recordings, so a replay sees, for example, a status
+	 * message replaced by the room name at the same tick as the game.
 	 */
-	
-	cmd = get_command ();
-	switch (cmd) {
-	    case CMD_UP:    move_photo_down ();  break;
-	    case CMD_RIGHT: move_photo_left ();  break;
-	    case CMD_DOWN:  move_photo_up ();    break;
-	    case CMD_LEFT:  move_photo_right (); break;
-	    case CMD_MOVE_LEFT:   
-		enter_room = (TC_CHANGE_ROOM == 
-			      try_to_move_left (&game_info.where));
-		break;
-	    case CMD_ENTER:
-		enter_room = (TC_CHANGE_ROOM ==
-			      try_to_enter (&game_info.where));
-		break;
-	    case CMD_MOVE_RIGHT:
-		enter_room = (TC_CHANGE_ROOM == 
-			      try_to_move_right (&game_info.where));
-		break;
-	    case CMD_TYPED:
-		if (handle_typing ()) {
-		    enter_room = 1;
-		}
-		break;
-	    case CMD_QUIT: return GAME_QUIT;
-	    default: break;
+	timer_advance (tick_stats.ticks);
+    } /* end of the main event loop */
+}
+
+
+/* 
+ * enter_new_room
+ *   DESCRIPTION: Prepare the view for the player's room, which has just
+ *                changed, so that the next frame shows the room.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: resets the view window and the typed command; marks
+ *                 the next frame as a new room (so that the palette is
+ *                 changed and the whole room drawn)
+ */
+static void
+enter_new_room ()
+{
+    /* Reset the view window to (0,0). */
+    game_info.map_x = game_info.map_y = 0;
+
+    /* Discard any partially-typed command. */
+    reset_typed_command ();
+    
+    /* Adjust colors and draw the whole room in the next frame. */
+    frame.new_room = 1;
+}
+
+
+/* 
+ * handle_input
+ *   DESCRIPTION: Carry out commands from the input queue in the order in
+ *                which they arrived, until the queue is empty, the player
+ *                changes rooms, or max_tick_cmds commands have been
+ *                carried out since the screen was last shown.
+ *   INPUTS: none
+ *   OUTPUTS: enter_room -- set to 1 if the player's room changes
+ *   RETURN VALUE: GAME_QUIT if the player quits, GAME_WON if they have
+ *                 won, or -1 to keep playing
+ *   SIDE EFFECTS: may move the view, the player, or objects; updates
+ *                 tick_cmds, input timing, and command statistics
+ */
+static int32_t
+handle_input (int32_t* enter_room)
+{
+    struct timespec when; /* arrival of first event removed */
+    cmd_t cmd;            /* command from the input queue   */
+    int32_t game;         /* outcome of the command         */
+    uint64_t start;       /* time at which command started  */
+
+    while (!*enter_room && max_tick_cmds > tick_cmds) {
+	if (0 == get_queued_command (&cmd, &when))
+	    break;
+	if (!input_pending) {
+	    input_time = when;
+	    input_pending = 1;
 	}
+	if (CMD_NONE == cmd)
+	    break;
+	if (recording)
+	    record_command (tick_stats.ticks, cmd, get_typed_command ());
+
+	/* 
+	 * Before commands were queued, only the last command read in a 
+	 * tick was carried out; count the ones that would have been lost.
+	 */
+	tick_stats.commands++;
+	if (0 < tick_cmds++)
+	    tick_stats.stacked++;
+	start = now_ns ();
+	game = handle_command (cmd, enter_room);
+	phase_done ((CMD_RIGHT <= cmd && CMD_DOWN >= cmd) ? 
+		    PHASE_DRAW : PHASE_COMMAND, start);
+	if (-1 != game)
+	    return game;
+    }
+    return -1;
+}
+
+
+/* 
+ * handle_command
+ *   DESCRIPTION: Carry out a command from the input controller.
+ *   INPUTS: cmd -- the command
+ *   OUTPUTS: enter_room -- set to 1 if the player's room changes
+ *   RETURN VALUE: GAME_QUIT if the player quits, GAME_WON if they have
+ *                 won, or -1 to keep playing
+ *   SIDE EFFECTS: may move the view, the player, or objects
+ */
+static int32_t
+handle_command (cmd_t cmd, int32_t* enter_room)
+{
+    tc_action_t result = TC_ALLOW_EDIT; /* result of room change attempt */
+
+    switch (cmd) {
+	case CMD_UP:    move_photo_down ();  break;
+	case CMD_RIGHT: move_photo_left ();  break;
+	case CMD_DOWN:  move_photo_up ();    break;
+	case CMD_LEFT:  move_photo_right (); break;
+	case CMD_MOVE_LEFT:   
+	    result = try_to_move_left (&game_info.where);
+	    break;
+	case CMD_ENTER:
+	    result = try_to_enter (&game_info.where);
+	    break;
+	case CMD_MOVE_RIGHT:
+	    result = try_to_move_right (&game_info.where);
+	    break;
+	case CMD_TYPED:
+	    if (handle_typing ()) {
+		*enter_room = 1;
+	    }
+	    break;
+	case CMD_QUIT: return GAME_QUIT;
+	default: break;
+    }
+    if (TC_CHANGE_ROOM == result) {
+	*enter_room = 1;
+    }
+
+    /* If player wins the game, their room becomes NULL. */
+    if (NULL == game_info.where) {
+	return GAME_WON;
+    }
+    return -1;
+}
+
 
-	/* If player wins the game, their room becomes NULL. */
-	if (NULL == game_info.where) {
-	    return GAME_WON;
+/* 
+ * update_status_bar
+ *   DESCRIPTION: Write the status message, if any, to the status bar;
+ *                otherwise, write the room name and the typed command.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: changes the status bar text in the next frame
+ */
+static void
+update_status_bar ()
+{
+    /* 
+     * Copy the status message only when a new one has been published,
+     * starting the timer that clears it.  A message already on the bar
+     * needs no more work until then.
+     */
+    if (status_gen != status_generation ()) {
+	status_gen = status_read (status_msg);
+	if ('\0' != status_msg[0]) {
+	    timer_schedule (&status_timer, STATUS_MSG_TICKS, clear_status, 
+	    		    NULL);
+	} else {
+	    timer_cancel (&status_timer);
 	}
-    } /* end of the main event loop */
+    } else if ('\0' != status_msg[0]) {
+	return;
+    }
+
+    if (*status_msg){
+    	char message[41]; // number of characters on status bar +1 for null
+    	int i; int j = 0;
+    	int offset = (40 - strlen(status_msg))/2; // offset from left of bar to write string
+    	for (i = 0; i < 40; i++){
+    		if ((i >= offset)&&(i < 40-offset)){
+    			message[i] = status_msg[j];
+    			j++;
+    		} else {
+    			message[i] = ' ';
+    		}
+    	};
+    	message[40] = '\0';
+
+    	(void)memcpy (frame.bar, message, sizeof (frame.bar));
+    } else {
+    	char barText[41]; // number of characters on status bar +1 for null
+    	const char * typed = get_typed_command();
+    	const char * roomName = room_name(game_info.where);
+    	int i = 0;
+    	
+    	int typedLength = 0; int roomNameLength = 0;
+    	const char * curr = typed;
+    	while ((*curr!='\0')&&curr){
+    		typedLength++;
+    		curr++;
+    	}
+    	curr = roomName;
+    	while ((*curr!='\0')&&curr){
+    		roomNameLength++;
+    		curr++;
+    	}
+    	while (roomName && (*roomName!='\0') && (i < 20)){ // 20 is halfway point of bar
+    		barText[i] = *roomName;
+    		roomName++;
+    		i++;
+    	}
+    	int j;
+    	for (j=0; j < (40-typedLength-roomNameLength); j++){
+    		barText[i] = ' ';
+    		i++;
+    	}
+    	while (typed && (*typed!='\0') && (i<40)){
+    		barText[i] = *typed;
+    		typed++;
+    		i++;
+    	}
+    	while (i < 40){ // long room names leave a gap
+    		barText[i] = ' ';
+    		i++;
+    	}
+    	barText[40] = '\0';
+    	
+    	(void)memcpy (frame.bar, barText, sizeof (frame.bar));
+    }
 }
 
 
@@ -398,135 +706,62 @@ game_loop ()
 static int32_t
 handle_typing ()
 {
-    const char*      cmd;     /* command verb typed                */
-    int32_t          cmd_len; /* length of command verb            */
-    const char*      arg;     /* argument given to command verb    */
-    int32_t          idx;     /* loop index over command list      */
+    cmd_id_t         verb;    /* command for typed verb            */
     tc_action_t      result;  /* result of typed command execution */
 
-    /* Read the command and strip leading spaces.  If it's empty, return. */
-    cmd = get_typed_command ();
-    while (' ' == *cmd) { cmd++; }
-    if ('\0' == *cmd) { return 0; }
-
-    /* 
-     * Walk over the command verb, calculating its length as we go.  Space
-     * or NUL marks the end of the verb, after which the argument begins.
-     * Leading spaces are first stripped from the argument, but we make no
-     * attempt to deal with trailing spaces (argument names must match
-     * exactly).
-     */
-    for (cmd_len = 0; ' ' != cmd[cmd_len] && '\0' != cmd[cmd_len]; cmd_len++);
-    arg = &cmd[cmd_len];
-    while (' ' == *arg) { arg++; }
-
-    /* Compare the typed verb with each command in our list. */
-    for (idx = 0; NULL != cmd_list[idx].name; idx++) {
-
-        /* If the typed verb is not long enough, it can't match. */
-	if (cmd_list[idx].min_len > cmd_len) { continue; }
-
-	/* Compare the prefix of the command with the typed verb. */
-        if (0 != strncasecmp (cmd_list[idx].name, cmd, cmd_len)) { continue; }
-
-	/* Execute the command found. */
-	switch (cmd_list[idx].cmd) {
-	    case TC_BUY:
-	        result = typed_cmd_buy (&game_info.where, arg);
-		break;
-	    case TC_CHARGE:
-	        result = typed_cmd_charge (&game_info.where, arg);
-		break;
-	    case TC_DO:
-	        result = typed_cmd_do (&game_info.where, arg);
-		break;
-	    case TC_DRINK:
-	        result = typed_cmd_drink (&game_info.where, arg);
-		break;
-	    case TC_DROP:
-	        result = typed_cmd_drop (&game_info.where, arg);
-		if (!player_has_board ()) {
-		    game_info.x_speed = MOTION_SPEED;
-		}
-		if (!player_has_jetpack ()) {
-		    game_info.y_speed = MOTION_SPEED;
-		}
-		break;
-	    case TC_FIX:
-	        result = typed_cmd_fix (&game_info.where, arg);
-		break;
-	    case TC_FLASH:
-	        result = typed_cmd_flash (&game_info.where, arg);
-		break;
-	    case TC_GET:
-	        result = typed_cmd_get (&game_info.where, arg);
-		if (player_has_board ()) {
-		    game_info.x_speed = MOTION_SPEED * 3;
-		}
-		if (player_has_jetpack ()) {
-		    game_info.y_speed = MOTION_SPEED * 3;
-		}
-		break;
-	    case TC_GO:
-	        result = typed_cmd_go (&game_info.where, arg);
-		break;
-	    case TC_INSTALL:
-	        result = typed_cmd_install (&game_info.where, arg);
-		break;
-	    case TC_INVENTORY:
-	        result = typed_cmd_inventory (&game_info.where, arg);
-		break;
-	    case TC_SIGH:
-	        result = typed_cmd_sigh (&game_info.where, arg);
-		break;
-	    case TC_USE:
-	        result = typed_cmd_use (&game_info.where, arg);
-		break;
-	    case TC_WEAR:
-	        result = typed_cmd_wear (&game_info.where, arg);
-		break;
-	    default:
-		show_status ("Bug...!");
-		result = TC_ALLOW_EDIT;
-	        break;
+    /* Execute the command, then adjust speeds for objects moved. */
+    result = typed_command (&game_info.where, get_typed_command (), &verb);
+    if (TC_DROP == verb) {
+	if (!player_has_board (game_info.world)) {
+	    game_info.x_speed = MOTION_SPEED;
 	}
-
-	/* Handle command result and return. */
-	if (TC_CHANGE_ROOM == result) {
-	    return 1;
+	if (!player_has_jetpack (game_info.world)) {
+	    game_info.y_speed = MOTION_SPEED;
 	}
-	if (TC_ALLOW_EDIT != result) {
-	    reset_typed_command ();
-	    if (TC_REDRAW_ROOM == result) {
-	        redraw_room ();
-	    }
+    } else if (TC_GET == verb) {
+	if (player_has_board (game_info.world)) {
+	    game_info.x_speed = MOTION_SPEED * 3;
+	}
+	if (player_has_jetpack (game_info.world)) {
+	    game_info.y_speed = MOTION_SPEED * 3;
+	}
+    }
+
+    /* Handle command result and return. */
+    if (TC_CHANGE_ROOM == result) {
+	return 1;
+    }
+    if (TC_ALLOW_EDIT != result) {
+	reset_typed_command ();
+	if (TC_REDRAW_ROOM == result) {
+	    redraw_room ();
 	}
-	return 0;
     }
-    
-    /* The command was not recognized. */
-    show_status ("What are you babbling about?");
     return 0;
 }
 
 
 /* 
  * init_game
- *   DESCRIPTION: Initialize the game information, including the initial
- *                room, photo display, motion speed, and so forth.
- *   INPUTS: none
+ *   DESCRIPTION: Initialize the game information, including the world,
+ *                initial room, photo display, motion speed, and so forth.
+ *   INPUTS: seed -- random seed for the game
  *   OUTPUTS: none
- *   RETURN VALUE: none
- *   SIDE EFFECTS: none
+ *   RETURN VALUE: 0 on success, -1 if memory runs out
+ *   SIDE EFFECTS: creates the game's world
  */
-static void
-init_game ()
+static int32_t
+init_game (unsigned int seed)
 {
-    game_info.where = start_in_room ();
+    if (NULL == (game_info.world = new_world (seed, publish_status, NULL))) {
+	return -1;
+    }
+    game_info.where = start_in_room (game_info.world);
     game_info.map_x = 0;
     game_info.map_y = 0;
     game_info.x_speed = MOTION_SPEED;
     game_info.y_speed = MOTION_SPEED;
+    return 0;
 }
 
 
@@ -538,26 +773,14 @@ init_game ()
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: shifts view window
+ *   SIDE EFFECTS: shifts view window (the next frame draws the lines
+ *                 exposed)
  */
 static void
 move_photo_down ()
 {
-    int32_t delta; /* Number of pixels by which to move. */
-    int32_t idx;   /* Index over rows to redraw.         */
-
-    /* Calculate the number of pixels by which to move. */
-    delta = (game_info.y_speed > game_info.map_y ?
-	     game_info.map_y : game_info.y_speed);
-
-    /* Shift the logical view upward. */
-    game_info.map_y -= delta;
-    set_view_window (game_info.map_x, game_info.map_y);
-
-    /* Draw the newly exposed lines. */
-    for (idx = 0; delta > idx; idx++) {
-	(void)draw_horiz_line (idx);
-    }
+    move_view_to (game_info.map_x, 
+		  (int32_t)game_info.map_y - game_info.y_speed);
 }
 
 
@@ -569,27 +792,14 @@ move_photo_down ()
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: shifts view window
+ *   SIDE EFFECTS: shifts view window (the next frame draws the lines
+ *                 exposed)
  */
 static void
 move_photo_left ()
 {
-    int32_t delta; /* Number of pixels by which to move. */
-    int32_t idx;   /* Index over columns to redraw.      */
-
-    /* Calculate the number of pixels by which to move. */
-    delta = room_photo_width (game_info.where) - SCROLL_X_DIM -
-    	    game_info.map_x;
-    delta = (game_info.x_speed > delta ? delta : game_info.x_speed);
-
-    /* Shift the logical view to the right. */
-    game_info.map_x += delta;
-    set_view_window (game_info.map_x, game_info.map_y);
-
-    /* Draw the newly exposed lines. */
-    for (idx = 1; delta >= idx; idx++) {
-	(void)draw_vert_line (SCROLL_X_DIM - idx);
-    }
+    move_view_to ((int32_t)game_info.map_x + game_info.x_speed, 
+		  game_info.map_y);
 }
 
 
@@ -601,26 +811,14 @@ move_photo_left ()
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: shifts view window
+ *   SIDE EFFECTS: shifts view window (the next frame draws the lines
+ *                 exposed)
  */
 static void
 move_photo_right ()
 {
-    int32_t delta; /* Number of pixels by which to move. */
-    int32_t idx;   /* Index over columns to redraw.      */
-
-    /* Calculate the number of pixels by which to move. */
-    delta = (game_info.x_speed > game_info.map_x ?
-	     game_info.map_x : game_info.x_speed);
-
-    /* Shift the logical view to the left. */
-    game_info.map_x -= delta;
-    set_view_window (game_info.map_x, game_info.map_y);
-
-    /* Draw the newly exposed lines. */
-    for (idx = 0; delta > idx; idx++) {
-	(void)draw_vert_line (idx);
-    }
+    move_view_to ((int32_t)game_info.map_x - game_info.x_speed, 
+		  game_info.map_y);
 }
 
 
@@ -632,289 +830,1220 @@ move_photo_right ()
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: shifts view window
+ *   SIDE EFFECTS: shifts view window (the next frame draws the lines
+ *                 exposed)
  */
 static void
 move_photo_up ()
 {
-    int32_t delta; /* Number of pixels by which to move. */
-    int32_t idx;   /* Index over rows to redraw.         */
-
-    /* Calculate the number of pixels by which to move. */
-    delta = room_photo_height (game_info.where) - SCROLL_Y_DIM - 
-    	    game_info.map_y;
-    delta = (game_info.y_speed > delta ? delta : game_info.y_speed);
+    move_view_to (game_info.map_x, 
+		  (int32_t)game_info.map_y + game_info.y_speed);
+}
 
-    /* Shift the logical view upward. */
-    game_info.map_y += delta;
-    set_view_window (game_info.map_x, game_info.map_y);
 
-    /* Draw the newly exposed lines. */
-    for (idx = 1; delta >= idx; idx++) {
-	(void)draw_horiz_line (SCROLL_Y_DIM - idx);
-    }
+/* 
+ * move_view_to
+ *   DESCRIPTION: Move the view window as near to a given upper left pixel
+ *                as the room photo allows.  The view may move any distance
+ *                in both directions at once; the next frame draws only the
+ *                lines exposed, or the whole view when that costs less.
+ *   INPUTS: x, y -- desired upper left pixel of the view
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: shifts view window
+ */
+static void
+move_view_to (int32_t x, int32_t y)
+{
+    int32_t max_x; /* rightmost allowed view position  */
+    int32_t max_y; /* lowest allowed view position     */
+
+    max_x = room_photo_width (game_info.where) - SCROLL_X_DIM;
+    max_y = room_photo_height (game_info.where) - SCROLL_Y_DIM;
+    x = (max_x < x ? max_x : x);
+    y = (max_y < y ? max_y : y);
+    game_info.map_x = (0 > x ? 0 : x);
+    game_info.map_y = (0 > y ? 0 : y);
 }
 
 
 /* 
  * redraw_room
- *   DESCRIPTION: Draw all lines on the screen.
+ *   DESCRIPTION: Draw all lines on the screen in the next frame.
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: Draws the entire screen (but not the status bar).
+ *   SIDE EFFECTS: marks the next frame to draw the entire screen (but 
+ *                 not the status bar)
  */
 static void
 redraw_room ()
 {
-    int32_t i; /* index over rows */
-
-    /* Draw all lines in the scroll region. */
-    for (i = 0; i < SCROLL_Y_DIM; i++) {
-	(void)draw_horiz_line (i);
-    }
+    frame.redraw = 1;
 }
 
 
 /* 
- * status_thread
- *   DESCRIPTION: Function executed by status message helper thread.
- *                Waits for a message to be displayed, then shows the
- *                message for 1.5 seconds before deleting it.  If a
- *                new message has appeared in the meantime, restarts the
- *                clock and tries again.
- *   INPUTS: none (ignored)
+ * show_frame
+ *   DESCRIPTION: Hand the frame for this tick--the player's room as it is
+ *                now, the view window, and the status bar text--to the
+ *                render thread (or draw and show it, if there is none).
+ *   INPUTS: none
  *   OUTPUTS: none
- *   RETURN VALUE: NULL
- *   SIDE EFFECTS: Changes the status message to an empty string.
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: clears the requests to draw the whole view
  */
-static void*
-status_thread (void* ignore)
+static void
+show_frame ()
 {
-    struct timespec ts; /* absolute wake-up time */
-
-    while (1) {
-
-	/* 
-	 * Wait for a message to appear.  Note that we must check the
-	 * condition after acquiring the lock, and that pthread_cond_wait
-	 * yields the lock, then reacquires the lock before returning.
-	 */
-	(void)pthread_mutex_lock (&msg_lock);
-	while ('\0' == status_msg[0]) {
-	    pthread_cond_wait (&msg_cv, &msg_lock);
-	}
-
-	/* 
-	 * A message is present: if we stop before the timeout
-	 * passes, assume that a new one has been posted; if the
-	 * timeout passes, clear the message and wait for a new one.
-	 */
-	do {
-	    /* Get the current time. */
-	    clock_gettime (CLOCK_REALTIME, &ts);
-	    
-	    /* Add 1.5 seconds to it. */
-	    if (500000000 <= ts.tv_nsec) {
-		ts.tv_sec += 2;
-		ts.tv_nsec -= 500000000;
-	    } else {
-		ts.tv_sec += 1;
-		ts.tv_nsec += 500000000;
-	    }
+    get_room_scene (game_info.where, &frame.scene);
+    frame.map_x = game_info.map_x;
+    frame.map_y = game_info.map_y;
+    post_frame (&frame);
+    frame.new_room = 0;
+    frame.redraw = 0;
+}
 
-	    /* 
-	     * And go to sleep.  If we wake up due to anything but a
-	     * timeout, we assume (possibly incorrectly) that a new
-	     * message has appeared and try to wait 1.5 seconds again.
-	     */
-	} while (ETIMEDOUT != 
-		 pthread_cond_timedwait (&msg_cv, &msg_lock, &ts));
 
-	/* 
-	 * Clear the message, then release the lock (remember that 
-	 * pthread_cond_timedwait reacquires the lock before returning).
-	 */
-	status_msg[0] = '\0';
-	(void)pthread_mutex_unlock (&msg_lock);
+/* 
+ * add_usec
+ *   DESCRIPTION: Advance a time by a number of microseconds.
+ *   INPUTS: t -- the time
+ *           usec -- microseconds to add (less than one second)
+ *   OUTPUTS: t -- the advanced time
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void
+add_usec (struct timespec* t, long usec)
+{
+    if ((t->tv_nsec += usec * 1000) >= 1000000000) {
+	t->tv_sec++;
+	t->tv_nsec -= 1000000000;
     }
-
-    /* This code never executes--the thread should always be cancelled. */
-    return NULL;
 }
 
 
 /* 
- * time_is_after 
- *   DESCRIPTION: Check whether one time is at or after a second time.
+ * usec_between
+ *   DESCRIPTION: Calculate the time from one time to a second time.
  *   INPUTS: t1 -- the first time
  *           t2 -- the second time
  *   OUTPUTS: none
- *   RETURN VALUE: 1 if t1 >= t2
- *                 0 if t1 < t2
+ *   RETURN VALUE: t2 - t1 in microseconds
  *   SIDE EFFECTS: none
  */
-static int
-time_is_after (struct timeval* t1, struct timeval* t2)
+static double
+usec_between (struct timespec* t1, struct timespec* t2)
 {
-    if (t1->tv_sec == t2->tv_sec)
-        return (t1->tv_usec >= t2->tv_usec);
-    if (t1->tv_sec > t2->tv_sec)
-        return 1;
-    return 0;
+    return ((t2->tv_sec - t1->tv_sec) * 1e6 + 
+	    (t2->tv_nsec - t1->tv_nsec) / 1e3);
 }
 
 
 /* 
- * show_status (interface function; declared in world.h)
- *   DESCRIPTION: Show a specific status message of up to STATUS_MSG_LEN
- *                characters.
- *   INPUTS: s -- the string used for the status message
+ * cpu_usec
+ *   DESCRIPTION: Get the CPU time used by the process (all threads).
+ *   INPUTS: none
  *   OUTPUTS: none
- *   RETURN VALUE: none
- *   SIDE EFFECTS: Overwrites any previous message.
+ *   RETURN VALUE: user plus system time in microseconds
+ *   SIDE EFFECTS: none
  */
-void
-show_status (const char* s)
+static double
+cpu_usec ()
 {
-    /* msg_lock critical section starts here. */
-    (void)pthread_mutex_lock (&msg_lock);
-
-    /* Copy the new message under the protection of msg_lock. */
-    strncpy (status_msg, s, STATUS_MSG_LEN);
-    status_msg[STATUS_MSG_LEN] = '\0';
-
-    /* 
-     * Wake up the status message helper thread.  Note that we still hold
-     * the msg_lock, so the thread can't wake up until we release it.
-     */
-    (void)pthread_cond_signal (&msg_cv);
+    struct rusage ru; /* resource usage of process */
 
-    /* msg_lock critical section ends here. */
-    (void)pthread_mutex_unlock (&msg_lock);
+    (void)getrusage (RUSAGE_SELF, &ru);
+    return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 + 
+	    ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
 }
 
 
 /* 
- * main
- *   DESCRIPTION: Play the adventure game.
- *   INPUTS: none (command line arguments are ignored)
+ * now_ns
+ *   DESCRIPTION: Read the monotonic clock.
+ *   INPUTS: none
  *   OUTPUTS: none
- *   RETURN VALUE: 0 on success, 3 in panic situations
+ *   RETURN VALUE: current time in nanoseconds
+ *   SIDE EFFECTS: none
  */
-int
-main ()
+static uint64_t
+now_ns ()
 {
-    game_condition_t game;  /* outcome of playing */
+    struct timespec ts; /* current time */
 
-    /* Randomize for more fun (remove for deterministic layout). */
-    srand (time (NULL));
+    (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
 
-    /* Provide some protection against fatal errors. */
-    clean_on_signals ();
 
-    if (!build_world ()) {PANIC ("can't build world");}
-    init_game ();
+/* 
+ * phase_done
+ *   DESCRIPTION: Add the time since a phase started to the time spent in
+ *                that phase during the current tick.
+ *   INPUTS: phase -- the phase
+ *           start -- time at which the phase started (from now_ns)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates tick statistics
+ */
+static void
+phase_done (int32_t phase, uint64_t start)
+{
+    tick_stats.phase_ns[phase] += now_ns () - start;
+}
 
-    /* Perform sanity checks. */
-    if (0 != sanity_check ()) {
-	PANIC ("failed sanity checks");
-    }
 
-    /* Create status message thread. */
-    if (0 != pthread_create (&status_thread_id, NULL, status_thread, NULL)) {
-        PANIC ("failed to create status thread");
+/* 
+ * record_tick_phases
+ *   DESCRIPTION: Record the time spent in each phase since the last screen
+ *                update, and the total, in the tick statistics.  Phases
+ *                that did not run are not recorded.  Called after each
+ *                screen update.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates tick statistics; clears per-tick phase times
+ */
+static void
+record_tick_phases ()
+{
+    uint64_t busy = 0; /* time in all phases */
+    int32_t  p;        /* index over phases  */
+
+    for (p = 0; NUM_PHASES > p; p++) {
+	if (0 < tick_stats.phase_ns[p]) {
+	    hist_record (&tick_stats.phase[p], tick_stats.phase_ns[p]);
+	    busy += tick_stats.phase_ns[p];
+	    tick_stats.phase_ns[p] = 0;
+	}
     }
-    push_cleanup (cancel_status_thread, NULL); {
+    hist_record (&tick_stats.busy, busy);
+}
 
-	/* Start mode X. */
-	if (0 != set_mode_X (fill_horiz_buffer, fill_vert_buffer)) {
-	    PANIC ("cannot initialize mode X");
+
+/* 
+ * request_stats_dump
+ *   DESCRIPTION: Signal handler for SIGUSR1.  Asks the game loop to write
+ *                the tick statistics, which it does within one tick.
+ *   INPUTS: sig -- signal number (ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: sets dump_requested
+ */
+static void
+request_stats_dump (int sig)
+{
+    dump_requested = 1;
+}
+
+
+/* 
+ * write_stats_json
+ *   DESCRIPTION: Write the tick statistics to a file as a JSON object.
+ *   INPUTS: fname -- name of the file
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: creates or replaces the file
+ */
+static int32_t
+write_stats_json (const char* fname)
+{
+    FILE*   f; /* the file           */
+    int32_t p; /* index over phases  */
+
+    if (NULL == (f = fopen (fname, "w"))) {
+	return -1;
+    }
+    fprintf (f, "{\n  \"tick_us\": %d,\n  \"ticks\": %lu,\n"
+	     "  \"missed\": %lu,\n  \"max_missed_at_once\": %lu,\n"
+	     "  \"commands\": %lu,\n  \"stacked_commands\": %lu,\n", 
+	     TICK_USEC, tick_stats.ticks, tick_stats.missed, 
+	     tick_stats.max_missed, tick_stats.commands, tick_stats.stacked);
+    fprintf (f, "  \"lateness\": ");
+    hist_write_json (f, &tick_stats.late);
+    fprintf (f, ",\n  \"input_to_screen\": ");
+    hist_write_json (f, &tick_stats.input);
+    fprintf (f, ",\n  \"busy\": ");
+    hist_write_json (f, &tick_stats.busy);
+    fprintf (f, ",\n  \"phases\": {");
+    for (p = 0; NUM_PHASES > p; p++) {
+	fprintf (f, "%s\n    \"%s\": ", (0 == p ? "" : ","), phase_name[p]);
+	hist_write_json (f, &tick_stats.phase[p]);
+    }
+    fprintf (f, "\n  }\n}\n");
+    return (0 == fclose (f) ? 0 : -1);
+}
+
+
+/* 
+ * load_bench
+ *   DESCRIPTION: Read a benchmark script.  Each line holds one step:
+ *
+ *                  <command>      a command, named as in recordings
+ *                                 ("up", "move-left", "enter", ...)
+ *                  typed <text>   a typed command, such as "get board"
+ *                  scroll         scroll to the bottom, right, top, and
+ *                                 left edges of the room photo in turn
+ *                  jump           move the view diagonally across the
+ *                                 room photo and back in steps of
+ *                                 several sizes, one show per step
+ *                  room <name>    jump to the first room with the name
+ *                  tour           for every room in the world, jump to
+ *                                 it, scroll, and try each of move-left,
+ *                                 enter, and move-right from it
+ *
+ *                Blank lines and lines starting with '#' are ignored.
+ *                Must be called after the world is built.
+ *   INPUTS: fname -- name of the script
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: allocates the steps; prints a message on failure
+ */
+static int32_t
+load_bench (const char* fname)
+{
+    FILE* f;              /* the script                  */
+    char line[200];       /* one line of the script      */
+    int32_t lnum;         /* line number                 */
+    bench_step_t step;    /* step read from line         */
+    bench_step_t* grown;  /* larger step array           */
+    int32_t cap;          /* size of step array          */
+    int32_t idx;          /* index over rooms            */
+
+    if (NULL == (f = fopen (fname, "r"))) {
+	perror (fname);
+	return -1;
+    }
+    cap = 0;
+    for (lnum = 1; NULL != fgets (line, sizeof (line), f); lnum++) {
+	line[strcspn (line, "\r\n")] = '\0';
+	if ('\0' == line[0] || '#' == line[0]) {
+	    continue;
 	}
-	push_cleanup ((cleanup_fn_t)clear_mode_X, NULL); {
+	step.typed = NULL;
+	step.room = NULL;
+	if (0 == strcmp (line, "scroll")) {
+	    step.kind = BENCH_SCROLL;
+	} else if (0 == strcmp (line, "jump")) {
+	    step.kind = BENCH_JUMP;
+	} else if (0 == strcmp (line, "tour")) {
+	    step.kind = BENCH_TOUR;
+	} else if (0 == strncmp (line, "typed ", 6) &&
+		   MAX_TYPED_LEN >= strlen (&line[6])) {
+	    step.kind = BENCH_TYPED;
+	    if (NULL == (step.typed = strdup (&line[6]))) {
+		break;
+	    }
+	} else if (0 == strncmp (line, "room ", 5)) {
+	    step.kind = BENCH_ROOM;
+	    for (idx = 0;
+		 NULL != (step.room = get_room (game_info.world, idx));
+		 idx++) {
+		if (0 == strcasecmp (&line[5], room_name (step.room))) {
+		    break;
+		}
+	    }
+	    if (NULL == step.room) {
+		break;
+	    }
+	} else {
+	    step.kind = BENCH_CMD;
+	    step.cmd = find_command (line);
+	    if (NUM_COMMANDS == step.cmd || CMD_TYPED == step.cmd || 
+		CMD_QUIT == step.cmd) {
+		break;
+	    }
+	}
+	if (bench_len == cap) {
+	    cap = (0 == cap ? 64 : 2 * cap);
+	    if (NULL == (grown = realloc (bench_step, 
+					  cap * sizeof (*bench_step)))) {
+		break;
+	    }
+	    bench_step = grown;
+	}
+	bench_step[bench_len++] = step;
+    }
+    if (!feof (f)) {
+	fprintf (stderr, "%s:%d: bad benchmark step\n", fname, lnum);
+	(void)fclose (f);
+	return -1;
+    }
+    (void)fclose (f);
+    return 0;
+}
+
+
+/* 
+ * run_bench
+ *   DESCRIPTION: Carry out the steps of the benchmark script as fast as
+ *                possible, showing the screen after each command or
+ *                scroll, and measure room entry and scrolling times.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if the whole script ran, or -1 if the game ended 
+ *                 before the end of the script
+ *   SIDE EFFECTS: plays the game; records benchmark measurements
+ */
+static int32_t
+run_bench ()
+{
+    uint64_t start;  /* time at which script started */
+    int32_t  i;      /* index over steps             */
+    int32_t  idx;    /* index over rooms             */
+    room_t*  r;      /* room visited on tour         */
+    cmd_t    cmd;    /* typed command                */
+    struct timespec when; /* queue time (ignored)    */
+
+    bench_stats.helpers = pool_size ();
+    start = now_ns ();
+    bench_enter (game_info.where);
+    for (i = 0; bench_len > i; i++) {
+	switch (bench_step[i].kind) {
+	    case BENCH_CMD:
+		if (0 != bench_command (bench_step[i].cmd)) {
+		    return -1;
+		}
+		break;
+	    case BENCH_TYPED:
+		queue_command (CMD_TYPED, bench_step[i].typed);
+		(void)get_queued_command (&cmd, &when);
+		if (0 != bench_command (cmd)) {
+		    return -1;
+		}
+		break;
+	    case BENCH_SCROLL:
+		bench_scroll ();
+		break;
+	    case BENCH_JUMP:
+		bench_jump ();
+		break;
+	    case BENCH_ROOM:
+		bench_enter (bench_step[i].room);
+		break;
+	    case BENCH_TOUR:
+		for (idx = 0; NULL != (r = get_room (game_info.world, idx));
+		     idx++) {
+		    bench_enter (r);
+		    bench_scroll ();
+		    for (cmd = CMD_MOVE_LEFT; CMD_MOVE_RIGHT >= cmd; cmd++) {
+			if (r != game_info.where) {
+			    bench_enter (r);
+			}
+			if (0 != bench_command (cmd)) {
+			    return -1;
+			}
+		    }
+		}
+		break;
+	}
+    }
+    bench_stats.total_ns = now_ns () - start;
+    return 0;
+}
+
+
+/* 
+ * bench_command
+ *   DESCRIPTION: Carry out a command for the benchmark and show the 
+ *                result.  If the player's room changes, the time until 
+ *                the new room is shown is recorded as a room entry.
+ *   INPUTS: cmd -- the command
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 normally, or -1 if the game has ended
+ *   SIDE EFFECTS: plays the game; records benchmark measurements
+ */
+static int32_t
+bench_command (cmd_t cmd)
+{
+    uint64_t start = now_ns ();  /* time at which command started */
+    int32_t  enter_room = 0;     /* player has changed rooms       */
+
+    if (-1 != handle_command (cmd, &enter_room)) {
+	return -1;
+    }
+    bench_stats.commands++;
+    if (enter_room) {
+	enter_new_room ();
+	bench_show ();
+	hist_record (&bench_stats.entry, now_ns () - start);
+    } else {
+	bench_show ();
+    }
+    return 0;
+}
 
-	    /* Initialize the keyboard and/or Tux controller. */
-	    if (0 != init_input ()) {
-		PANIC ("cannot initialize input");
+
+/* 
+ * bench_enter
+ *   DESCRIPTION: Put the player in a room for the benchmark and show it,
+ *                recording the time taken as a room entry.
+ *   INPUTS: r -- the room
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: moves the player; records benchmark measurements
+ */
+static void
+bench_enter (room_t* r)
+{
+    uint64_t start = now_ns ();  /* time at which entry started */
+
+    game_info.where = r;
+    enter_new_room ();
+    bench_show ();
+    hist_record (&bench_stats.entry, now_ns () - start);
+}
+
+
+/* 
+ * bench_jump
+ *   DESCRIPTION: Move the view diagonally from the upper left corner of
+ *                the room photo to the far corner and back, in steps of
+ *                each of several sizes, one show per step.  The largest
+ *                step, a whole view, crosses any photo in this world at
+ *                once.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: moves the view; records benchmark measurements
+ */
+static void
+bench_jump ()
+{
+    static const int32_t step[][2] = {
+	{1, 1}, {3, 2}, {8, 6}, {20, 15}, {SCROLL_X_DIM, SCROLL_Y_DIM}
+    };
+    uint64_t start;  /* time at which jump started  */
+    int32_t  x, y;   /* view position before jump   */
+    int32_t  dir;    /* 1 toward far corner, -1 back */
+    int32_t  s;      /* index over step sizes       */
+
+    for (s = 0; sizeof (step) / sizeof (step[0]) > s; s++) {
+	for (dir = 1; -1 <= dir; dir -= 2) {
+	    while (1) {
+		start = now_ns ();
+		x = game_info.map_x;
+		y = game_info.map_y;
+		move_view_to (x + dir * step[s][0], y + dir * step[s][1]);
+		if (x == game_info.map_x && y == game_info.map_y) {
+		    break;
+		}
+		bench_show ();
+		bench_stats.jumps++;
+		bench_stats.jump_ns += now_ns () - start;
 	    }
-	    push_cleanup ((cleanup_fn_t)shutdown_input, NULL); {
+	}
+    }
+}
 
-		game = game_loop ();
 
-	    } pop_cleanup (1);
+/* 
+ * bench_scroll
+ *   DESCRIPTION: Scroll to the bottom, right, top, and left edges of the
+ *                room photo in turn, one tick (show) per step.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: moves the view; records benchmark measurements
+ */
+static void
+bench_scroll ()
+{
+    static const cmd_t dir[4] = {CMD_DOWN, CMD_RIGHT, CMD_UP, CMD_LEFT};
+    uint64_t start;       /* time at which tick started */
+    int32_t  x, y;        /* view position before tick  */
+    int32_t  enter_room;  /* (never set by scrolling)   */
+    int32_t  d;           /* index over directions      */
+
+    for (d = 0; 4 > d; d++) {
+	while (1) {
+	    start = now_ns ();
+	    x = game_info.map_x;
+	    y = game_info.map_y;
+	    (void)handle_command (dir[d], &enter_room);
+	    if (x == game_info.map_x && y == game_info.map_y) {
+		break;
+	    }
+	    bench_show ();
+	    bench_stats.scrolls++;
+	    bench_stats.scroll_ns += now_ns () - start;
+	}
+    }
+}
 
-	} pop_cleanup (1);
 
-    } pop_cleanup (1);
+/* 
+ * bench_show
+ *   DESCRIPTION: Run the timed events for one tick, then update the
+ *                status bar and show the screen.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: draws the status bar; shows the screen (no render 
+ *                 thread runs during a benchmark)
+ */
+static void
+bench_show ()
+{
+    timer_advance (timer_now () + 1);
+    update_status_bar ();
+    show_frame ();
+}
 
-    /* Print a message about the outcome. */
-    switch (game) {
-	case GAME_WON: printf ("You win the game!  CONGRATULATIONS!\n"); break;
-	case GAME_QUIT: printf ("Quitter!\n"); break;
+
+/* 
+ * report_bench
+ *   DESCRIPTION: Print the benchmark measurements.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void
+report_bench ()
+{
+    hist_t* e = &bench_stats.entry;  /* room entry times */
+    scroll_stats_t ss;               /* image uploads    */
+    bar_stats_t bs;                  /* bar uploads      */
+    scroll_costs_t sc;               /* view move costs  */
+
+    get_scroll_stats (&ss);
+    get_bar_stats (&bs);
+    get_scroll_costs (&sc);
+    printf ("bench: whole views drawn by %d thread%s\n", 
+	    1 + bench_stats.helpers, (0 == bench_stats.helpers ? "" : "s"));
+    printf ("bench: %llu room entries: p50 %.3f ms, p90 %.3f ms, "
+	    "p99 %.3f ms, max %.3f ms\n", (unsigned long long)e->count,
+	    hist_percentile (e, 0.5) / 1e6, hist_percentile (e, 0.9) / 1e6,
+	    hist_percentile (e, 0.99) / 1e6, e->max / 1e6);
+    printf ("bench: %lu scroll ticks in %.3f s (%.0f ticks/s)\n", 
+	    bench_stats.scrolls, bench_stats.scroll_ns / 1e9,
+	    (0 == bench_stats.scroll_ns ? 0 : 
+	     bench_stats.scrolls * 1e9 / bench_stats.scroll_ns));
+    printf ("bench: %lu view jumps in %.3f s (%.0f jumps/s)\n", 
+	    bench_stats.jumps, bench_stats.jump_ns / 1e9,
+	    (0 == bench_stats.jump_ns ? 0 : 
+	     bench_stats.jumps * 1e9 / bench_stats.jump_ns));
+    printf ("bench: view moves cost %u ns a row, %u ns a column, %llu ns "
+	    "a whole view (%s); %lu drawn as strips, %lu as whole views\n",
+	    sc.row_ns, sc.col_ns, sc.whole_ns,
+	    (sc.calibrated ? "measured" : "assumed"), sc.strips, sc.redraws);
+    printf ("bench: %llu bytes uploaded (%llu image, %llu status bar), "
+	    "%llu moved by latch copies\n", ss.uploaded + bs.uploaded, 
+	    ss.uploaded, bs.uploaded, ss.latched);
+    printf ("bench: %lu other commands, %.3f s total\n", 
+	    bench_stats.commands, bench_stats.total_ns / 1e9);
+}
+
+
+/* 
+ * publish_status
+ *   DESCRIPTION: Show a specific status message of up to STATUS_MSG_LEN
+ *                characters (the game world's status function).
+ *   INPUTS: ignore -- ignored
+ *           s -- the string used for the status message
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: Overwrites any previous message.  Safe to call from
+ *                 any thread; readers of the status bar retry only
+ *                 while the message is being copied in.
+ */
+static void
+publish_status (void* ignore, const char* s)
+{
+    /* 
+     * Publish the message; the game loop notices the new generation when
+     * it next updates the status bar, and clears the message 1.5 seconds
+     * later unless another replaces it.
+     */
+    status_publish (s);
+}
+
+
+/* 
+ * resident_bytes
+ *   DESCRIPTION: Get the memory of the process resident in RAM.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: resident bytes, or 0 if unknown
+ *   SIDE EFFECTS: none
+ */
+static long
+resident_bytes ()
+{
+    FILE* f;        /* memory statistics of the process */
+    long pages = 0; /* resident pages                   */
+
+    if (NULL != (f = fopen ("/proc/self/statm", "r"))) {
+	if (1 != fscanf (f, "%*d %ld", &pages)) {
+	    pages = 0;
+	}
+	(void)fclose (f);
     }
+    return pages * sysconf (_SC_PAGESIZE);
+}
 
-    /* Return success. */
-    return 0;
+
+/* 
+ * run_sessions
+ *   DESCRIPTION: Play the recording loaded for replay in many headless
+ *                sessions at once, taking turns command by command, and
+ *                report the time taken, the memory used by each session,
+ *                and whether all of the games ended alike.
+ *   INPUTS: n -- number of sessions
+ *           seed -- random seed of the recording
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if every session ended as the first did, 1 if not,
+ *                 or -1 if memory runs out
+ *   SIDE EFFECTS: prints the results to stdout
+ */
+static int32_t
+run_sessions (int32_t n, unsigned int seed)
+{
+    session_t** s;      /* the sessions                      */
+    long before;        /* resident bytes before sessions    */
+    long grown;         /* resident bytes added by sessions  */
+    uint64_t start;     /* time at which play started        */
+    uint64_t ns;        /* time taken to play                */
+    int32_t n_cmds;     /* commands in the recording         */
+    int32_t differ;     /* sessions ending unlike the first  */
+    int32_t i;          /* index over sessions               */
+    cmd_t cmd;          /* recorded command                  */
+    const char* typed;  /* recorded typed command            */
+
+    before = resident_bytes ();
+    if (NULL == (s = calloc (n, sizeof (*s)))) {
+	return -1;
+    }
+    for (i = 0; n > i; i++) {
+	if (NULL == (s[i] = new_session (seed))) {
+	    while (0 < i--) {
+		free_session (s[i]);
+	    }
+	    free (s);
+	    return -1;
+	}
+    }
+
+    start = now_ns ();
+    for (n_cmds = 0; get_replay_command (n_cmds, &cmd, &typed); n_cmds++) {
+	for (i = 0; n > i; i++) {
+	    (void)session_command (s[i], cmd, typed);
+	}
+    }
+    ns = now_ns () - start;
+    grown = resident_bytes () - before;
+
+    for (differ = 0, i = 1; n > i; i++) {
+	if (s[i]->over != s[0]->over ||
+	    (NULL == s[i]->where) != (NULL == s[0]->where) ||
+	    (NULL != s[i]->where && NULL != s[0]->where &&
+	     0 != strcmp (room_name (s[i]->where), room_name (s[0]->where))) ||
+	    0 != strcmp (s[i]->status, s[0]->status)) {
+	    differ++;
+	}
+    }
+
+    printf ("sessions: %d played %d commands each in %.3f s "
+	    "(%.0f commands/s)\n", n, n_cmds, ns / 1e9,
+	    (0 == ns ? 0 : (double)n * n_cmds * 1e9 / ns));
+    printf ("sessions: %zu bytes of state each; resident memory grew by "
+	    "%ld bytes (%ld per session), sharing %zu bytes of photos and "
+	    "images\n", session_size (), grown, grown / n, prefault_world ());
+    printf ("sessions: %d ended unlike the first, which ended %s%s "
+	    "(\"%s\")\n", differ, (NULL == s[0]->where ? "by winning" : 
+	    "in "), (NULL == s[0]->where ? "" : room_name (s[0]->where)),
+	    s[0]->status);
+    report_world ();
+
+    for (i = 0; n > i; i++) {
+	free_session (s[i]);
+    }
+    free (s);
+    return (0 == differ ? 0 : 1);
 }
 
 
-#if !defined(NDEBUG)
 /* 
- * sanity_check 
- *   DESCRIPTION: Perform checks on changes to constants and enumerated values.
+ * report_world
+ *   DESCRIPTION: Report the size of the world description, the time
+ *                taken to load it (without the photos, which are read
+ *                separately), the photos read and the time taken to read
+ *                them ahead, and the memory used for each room.
  *   INPUTS: none
  *   OUTPUTS: none
- *   RETURN VALUE: 0 if checks pass, -1 if any fail
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: prints the report to stdout
+ */
+static void
+report_world ()
+{
+    world_stats_t ws; /* world description statistics */
+
+    get_world_stats (&ws);
+    printf ("world: %d rooms, %d objects (%d names), %d images; "
+	    "%zu-byte file loaded in %.3f ms (%.0f ns per room) without "
+	    "photos\n", ws.rooms, ws.objects, ws.names, ws.images,
+	    ws.file_bytes, ws.load_ns / 1e6, (double)ws.load_ns / ws.rooms);
+    printf ("world: %d of %d photos read; %.3f ms spent reading and "
+	    "faulting in pixels ahead of use\n", ws.photos_read, ws.photos,
+	    ws.prefault_ns / 1e6);
+    printf ("world: %zu bytes of description shared (%.0f per room), "
+	    "%zu bytes for each game's world (%.0f per room)\n",
+	    ws.shared_bytes, (double)ws.shared_bytes / ws.rooms,
+	    ws.world_bytes, (double)ws.world_bytes / ws.rooms);
+}
+
+
+/*
+ * parse_int
+ *   DESCRIPTION: Read a numeric command line argument, which must be a
+ *                decimal integer from lo to hi with nothing after it.
+ *   INPUTS: arg -- the argument
+ *           (lo,hi) -- the range of values allowed
+ *   OUTPUTS: *val -- the value (set only if the argument is good)
+ *   RETURN VALUE: 1 if the argument is good, or 0 if not
  *   SIDE EFFECTS: none
  */
-static int 
-sanity_check ()
+static int32_t
+parse_int (const char* arg, int lo, int hi, int* val)
 {
-    int32_t cnt[NUM_TC_VALUES]; /* count of synonymous commands      */
-    int32_t idx;                /* index over list of typed commands */
-    int32_t ret_val;            /* return value                      */
+    char* end;  /* first character not read */
+    long v;     /* value read               */
 
-    /* Initialize return value. */
-    ret_val = 0;
+    errno = 0;
+    v = strtol (arg, &end, 10);
+    if (end == arg || '\0' != *end || 0 != errno || lo > v || hi < v) {
+	return 0;
+    }
+    *val = v;
+    return 1;
+}
 
-    /* Check typed command list. */
-    (void)memset (cnt, 0, sizeof (cnt));
-    for (idx = 0; NULL != cmd_list[idx].name; idx++) {
-	if (1 > cmd_list[idx].min_len) {
-	    fprintf (stderr, "Typed command %s always matches.\n",
-		     cmd_list[idx].name);
-	    ret_val = -1;
-	    continue;
+
+/* 
+ * main
+ *   DESCRIPTION: Play the adventure game.
+ *   INPUTS: argc -- number of command line arguments
+ *           argv -- command line arguments (options in any order):
+ *     --vsync                    flip pages at most once a frame
+ *     --latch                    scroll by latch copies in video memory
+ *     --pan                      scroll by pixels with the panning register
+ *     --stats                    report timing, CPU, input, bar work at exit
+ *     --max-cmds <n>             commands per tick (default MAX_TICK_CMDS)
+ *     --json <file>              write tick statistics at exit and SIGUSR1
+ *     --record <file>            record the game's commands
+ *     --replay <file>            play a recorded game
+ *     --fast                     replay without waiting for ticks
+ *     --bench <script>           play a scripted route and report timings
+ *     --draw-threads <n>         helpers for whole views (default CPUs - 1)
+ *     --render-hz <n>            frames shown per second (default RENDER_HZ)
+ *     --realtime <priority>      run under SCHED_FIFO with memory locked
+ *     --cpus <list>              CPUs for --realtime (such as "2,3")
+ *     --sessions <n>             replay in n headless sessions at once
+ *     --serve <socket>           serve games on a Unix domain socket
+ *     --terminal <256|truecolor> also show the game on an ANSI terminal
+ *     --term-budget <bytes>      terminal bytes per frame (TERM_BUDGET)
+ *     --world <file>             world description (default WORLD_FILE)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, 1 if a benchmark ended early (or
+ *                 headless sessions ended differently), 2 on bad
+ *                 arguments, 3 in panic situations
+ */
+int
+main (int argc, char* argv[])
+{
+    game_condition_t game;  /* outcome of playing           */
+    int vsync = 0;          /* flip pages once a frame      */
+    int latch = 0;          /* scroll with latch copies     */
+    int pan = 0;            /* scroll with pixel panning    */
+    int stats = 0;          /* report statistics at exit    */
+    int draw_threads = -1;  /* drawing helpers (-1: by CPUs) */
+    int render_hz = RENDER_HZ; /* frames shown per second   */
+    int rt_priority = 0;    /* SCHED_FIFO priority (0: none) */
+    const char* rt_cpus = NULL; /* CPUs for real-time mode  */
+    int sessions = 0;       /* headless sessions to replay  */
+    const char* serve_path = NULL; /* socket for serving games */
+    term_colors_t term = TERM_OFF; /* terminal display colors  */
+    int term_budget = TERM_BUDGET; /* terminal bytes per frame */
+    const char* world_name = WORLD_FILE; /* world description */
+    term_stats_t ts;        /* terminal display statistics  */
+    realtime_stats_t rts;   /* real-time mode statistics    */
+    bar_stats_t bs;         /* status bar statistics        */
+    render_stats_t rnd;     /* render thread statistics     */
+    input_stats_t is;       /* input queue statistics       */
+    struct sigaction sa;    /* SIGUSR1 behavior             */
+    struct timespec end;    /* time at which the game ended */
+    double wall, cpu;       /* elapsed and CPU time (usec)  */
+    retrace_stats_t rs;     /* retrace wait statistics      */
+    scroll_stats_t ss;      /* video memory traffic         */
+    const char* record_name = NULL; /* file for recording   */
+    const char* replay_name = NULL; /* recording to replay  */
+    const char* bench_name = NULL;  /* benchmark script     */
+    int32_t bench_result = 0; /* benchmark outcome          */
+    unsigned int seed;      /* random seed                  */
+    int i;                  /* index over arguments         */
+
+    for (i = 1; argc > i; i++) {
+	if (0 == strcmp (argv[i], "--vsync")) {
+	    vsync = 1;
+	} else if (0 == strcmp (argv[i], "--latch")) {
+	    latch = 1;
+	} else if (0 == strcmp (argv[i], "--pan")) {
+	    pan = 1;
+	} else if (0 == strcmp (argv[i], "--stats")) {
+	    stats = 1;
+	} else if (0 == strcmp (argv[i], "--max-cmds") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 1, INT_MAX, &max_tick_cmds)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--json") && i + 1 < argc) {
+	    json_file = argv[++i];
+	    json_at_exit = 1;
+	} else if (0 == strcmp (argv[i], "--record") && i + 1 < argc) {
+	    record_name = argv[++i];
+	} else if (0 == strcmp (argv[i], "--replay") && i + 1 < argc) {
+	    replay_name = argv[++i];
+	} else if (0 == strcmp (argv[i], "--fast")) {
+	    fast_replay = 1;
+	} else if (0 == strcmp (argv[i], "--bench") && i + 1 < argc) {
+	    bench_name = argv[++i];
+	} else if (0 == strcmp (argv[i], "--draw-threads") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 0, INT_MAX, &draw_threads)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--render-hz") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 0, 1000, &render_hz)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--realtime") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 1, 99, &rt_priority)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--cpus") && i + 1 < argc) {
+	    rt_cpus = argv[++i];
+	} else if (0 == strcmp (argv[i], "--sessions") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 1, INT_MAX, &sessions)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--serve") && i + 1 < argc) {
+	    serve_path = argv[++i];
+	} else if (0 == strcmp (argv[i], "--terminal") && i + 1 < argc &&
+		   (0 == strcmp (argv[i + 1], "256") ||
+		    0 == strcmp (argv[i + 1], "truecolor"))) {
+	    term = ('2' == argv[++i][0] ? TERM_256_COLOR : TERM_TRUE_COLOR);
+	} else if (0 == strcmp (argv[i], "--term-budget") && i + 1 < argc &&
+		   parse_int (argv[i + 1], 1, INT_MAX, &term_budget)) {
+	    i++;
+	} else if (0 == strcmp (argv[i], "--world") && i + 1 < argc) {
+	    world_name = argv[++i];
+	} else {
+	    fprintf (stderr, "syntax: %s [--vsync] [--latch] [--pan] "
+		     "[--stats] [--max-cmds <n>] [--json <file>]\n"
+		     "\t[--record <file>] [--replay <file> [--fast]] "
+		     "[--bench <script>]\n\t[--draw-threads <n>] "
+		     "[--render-hz <n>] [--realtime <priority> "
+		     "[--cpus <list>]]\n\t[--replay <file> --sessions <n>] "
+		     "[--serve <socket>]\n\t[--terminal <256|truecolor> "
+		     "[--term-budget <bytes>]]\n\t[--world <file>]\n",
+		     argv[0]);
+	    return 2;
 	}
-	if (cmd_list[idx].min_len > strlen (cmd_list[idx].name)) {
-	    fprintf (stderr, "Typed command %s can never match.\n",
-		     cmd_list[idx].name);
-	    ret_val = -1;
-	    continue;
+    }
+    if (fast_replay && NULL == replay_name) {
+	fprintf (stderr, "%s: --fast requires --replay\n", argv[0]);
+	return 2;
+    }
+    if (0 != sessions &&
+	(NULL == replay_name || fast_replay || NULL != record_name)) {
+	fprintf (stderr, "%s: --sessions requires --replay (without --fast "
+		 "or --record)\n", argv[0]);
+	return 2;
+    }
+    if (NULL != serve_path && (NULL != bench_name || NULL != replay_name ||
+			       NULL != record_name || 0 != rt_priority)) {
+	fprintf (stderr, "%s: --serve cannot be combined with --bench, "
+		 "--record, --replay, or --realtime\n", argv[0]);
+	return 2;
+    }
+    if (NULL != rt_cpus && 0 == rt_priority) {
+	fprintf (stderr, "%s: --cpus requires --realtime\n", argv[0]);
+	return 2;
+    }
+    if (NULL != bench_name && 
+	(NULL != replay_name || NULL != record_name)) {
+	fprintf (stderr, "%s: --bench cannot be combined with --record "
+		 "or --replay\n", argv[0]);
+	return 2;
+    }
+    set_retrace_sync (vsync);
+    set_latch_scroll (latch);
+    set_pixel_pan (pan);
+    if (0 != set_terminal_display (term, term_budget)) {
+	fprintf (stderr, "%s: --terminal needs the VGA emulator "
+		 "(adventure-emu)\n", argv[0]);
+	return 2;
+    }
+
+    /* 
+     * Randomize for more fun, unless replaying a recorded game, which
+     * must use the recorded seed.
+     */
+    seed = (NULL == bench_name ? time (NULL) : BENCH_SEED);
+    if (NULL != replay_name) {
+	if (0 != load_replay (replay_name, &seed)) {
+	    return 2;
 	}
-        if (0 > cmd_list[idx].cmd || NUM_TC_VALUES <= cmd_list[idx].cmd) {
-	    fprintf (stderr, "Typed command %s has invalid command number.\n",
-		     cmd_list[idx].name);
-	    ret_val = -1;
-	    continue;
+	replaying = 1;
+    }
+    if (NULL != record_name) {
+	if (0 != start_recording (record_name, seed)) {
+	    perror (record_name);
+	    return 2;
 	}
-	cnt[cmd_list[idx].cmd]++;
+	recording = 1;
     }
 
+    /* Provide some protection against fatal errors. */
+    clean_on_signals ();
+
+    /* Write tick statistics on request. */
+    sa.sa_handler = request_stats_dump;
+    sa.sa_flags = 0;
+    (void)sigemptyset (&sa.sa_mask);
+    if (-1 == sigaction (SIGUSR1, &sa, NULL)) {
+	PANIC ("writing signal action failed");
+    }
+
+    if (!build_world (world_name)) {PANIC ("can't build world");}
+
+    /* Headless sessions need neither screen nor input. */
+    if (0 != sessions) {
+	switch (run_sessions (sessions, seed)) {
+	    case 0: return 0;
+	    case 1: return 1;
+	    default: PANIC ("out of memory for sessions");
+	}
+    }
+
+    /* Served games run in children forked from here, also headless. */
+    if (NULL != serve_path) {
+	(void)run_server (serve_path, seed);
+	return 3;
+    }
+    if (0 != init_game (seed)) {PANIC ("can't start game");}
+
     /* 
-     * Now check that every typed command can be issued with some string. 
-     * We could be fancier and check that it's possible to match (shadowing
-     * can prevent it: matching "a" in entry #1 prevents matching "an" in
-     * entry #2.).
+     * Read every photo now, before play, so that entering a room never
+     * reads one on the game thread (headless games above need none).
+     * Going real-time below does this itself, before locking memory.
      */
-    for (idx = 0; NUM_TC_VALUES > idx; idx++) {
-        if (0 == cnt[idx]) {
-	    fprintf (stderr, "TC_ #%d has no valid command strings.\n", idx);
-	    ret_val = -1;
+    if (0 == rt_priority) {
+	(void)prefault_world ();
+    }
+
+    /* Read the benchmark script, if any. */
+    if (NULL != bench_name && 0 != load_bench (bench_name)) {
+	return 2;
+    }
+
+    /* 
+     * Go real-time before starting any other thread, so that all of them
+     * inherit the scheduling policy and CPUs.
+     */
+    if (0 != rt_priority && 0 != start_realtime (rt_priority, rt_cpus)) {
+	return 2;
+    }
+
+    /* Start the threads that help to draw whole views. */
+    if (0 > draw_threads) {
+	draw_threads = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+    }
+    if (0 < draw_threads && 0 != start_pool (draw_threads)) {
+	PANIC ("cannot start drawing threads");
+    }
+    push_cleanup ((cleanup_fn_t)stop_pool, NULL); {
+
+	/* Start mode X. */
+	if (0 != set_mode_X (fill_horiz_buffer, fill_vert_buffer)) {
+	    PANIC ("cannot initialize mode X");
+	}
+	push_cleanup ((cleanup_fn_t)clear_mode_X, NULL); {
+
+	    /* Measure drawing costs now rather than in the first room. */
+	    calibrate_render (game_info.where);
+
+	    if (NULL != bench_name) {
+
+		/* A benchmark needs no input. */
+		bench_result = run_bench ();
+		game = GAME_QUIT;
+
+	    } else {
+
+		/* Initialize the keyboard and/or Tux controller. */
+		if (0 != init_input ()) {
+		    PANIC ("cannot initialize input");
+		}
+		push_cleanup ((cleanup_fn_t)shutdown_input, NULL); {
+
+		    /* Draw and show frames on their own thread. */
+		    if (0 != start_render_thread (render_hz, TICK_USEC)) {
+			PANIC ("cannot start render thread");
+		    }
+		    push_cleanup ((cleanup_fn_t)stop_render_thread, NULL); {
+
+			game = game_loop ();
+
+		    } pop_cleanup (1);
+
+		} pop_cleanup (1);
+	    }
+
+	} pop_cleanup (1);
+
+    } pop_cleanup (1);
+
+
+    stop_recording ();
+
+    /* Report what was written to the terminal. */
+    if (TERM_OFF != term) {
+	get_terminal_stats (&ts);
+	printf ("terminal: %dx%d cells (1/%d scale), %s; %lu frames, "
+		"%llu cells, avg %.0f bytes per frame (max %u); %lu frames "
+		"held to the %d-byte budget\n", ts.cols, ts.rows, ts.scale,
+		(TERM_256_COLOR == term ? "256 colors" : "24-bit color"),
+		ts.frames, ts.cells,
+		(0 == ts.frames ? 0 : (double)ts.bytes / ts.frames),
+		ts.max_bytes, ts.limited, term_budget);
+    }
+
+    /* Report benchmark results instead of the game's outcome. */
+    if (NULL != bench_name) {
+	if (0 != bench_result) {
+	    printf ("bench: the game ended before the end of the script\n");
+	}
+	report_bench ();
+	report_world ();
+	return (0 == bench_result ? 0 : 1);
+    }
+
+    /* Print a message about the outcome. */
+    switch (game) {
+	case GAME_WON: printf ("You win the game!  CONGRATULATIONS!\n"); break;
+	case GAME_QUIT: printf ("Quitter!\n"); break;
+    }
+
+    /* Report page flips and waits for vertical retrace. */
+    if (vsync) {
+	get_retrace_stats (&rs);
+	printf ("retrace: %lu flips, %lu screens replaced before a "
+		"flip\n", rs.flips, rs.replaced);
+	if (0 < rs.waits) {
+	    printf ("retrace wait: %lu waits, avg %.3f ms, "
+		    "min %.3f ms, max %.3f ms\n", rs.waits,
+		    rs.total_ns / 1e6 / rs.waits, rs.min_ns / 1e6,
+		    rs.max_ns / 1e6);
+	}
+    }
+
+    /* Report video memory traffic for latch-copy scrolling. */
+    if (latch) {
+	get_scroll_stats (&ss);
+	printf ("scrolling: %lu shows (%lu with latch copies), %llu bytes "
+		"copied from memory, %llu moved in video memory\n", 
+		ss.shows, ss.latch_shows, ss.uploaded, ss.latched);
+    }
+
+    /* Report tick timing and CPU usage. */
+    if (stats && 0 < tick_stats.ticks) {
+	(void)clock_gettime (CLOCK_MONOTONIC, &end);
+	wall = usec_between (&tick_stats.start, &end);
+	cpu = cpu_usec () - tick_stats.start_cpu_us;
+	printf ("ticks: %lu, %lu missed; wake-up lateness avg %.1f us, "
+		"max %.1f us\n", tick_stats.ticks, tick_stats.missed, 
+		hist_mean (&tick_stats.late) / 1e3, 
+		tick_stats.late.max / 1e3);
+	printf ("game loop CPU: %.2f s in %.2f s (%.1f%% of one CPU)\n", 
+		cpu / 1e6, wall / 1e6, 100 * cpu / wall);
+	printf ("work per tick: avg %.1f us, 99%% %.1f us, max %.1f us\n",
+		hist_mean (&tick_stats.busy) / 1e3, 
+		hist_percentile (&tick_stats.busy, 0.99) / 1e3,
+		tick_stats.busy.max / 1e3);
+	if (0 < tick_stats.input.count) {
+	    printf ("input to screen: %llu updates, avg %.1f us, "
+		    "max %.1f us\n", 
+		    (unsigned long long)tick_stats.input.count, 
+		    hist_mean (&tick_stats.input) / 1e3,
+		    tick_stats.input.max / 1e3);
 	}
     }
 
-    /* Return success/failure. */
-    return ret_val;
+    /* Report input handling. */
+    if (stats) {
+	get_input_stats (&is);
+	printf ("input: %lu events (%lu commands), %lu lost to a full queue, "
+		"max queue depth %u\n", is.events, is.commands, is.overflows,
+		is.max_depth);
+	printf ("commands: %lu carried out, %lu would have been dropped by "
+		"one command per tick\n", tick_stats.commands, 
+		tick_stats.stacked);
+    }
+
+    /* Write tick timing statistics. */
+    if (json_at_exit && 0 != write_stats_json (json_file)) {
+	perror (json_file);
+    }
+
+    /* Report frames drawn by the render thread. */
+    if (stats) {
+	get_render_stats (&rnd);
+	printf ("render: %lu frames posted, %lu shown (%lu whole views), "
+		"%lu replaced unshown; draw avg %.1f us, max %.1f us; "
+		"post to screen avg %.1f us, max %.1f us\n", rnd.posted,
+		rnd.shown, rnd.redraws, rnd.merged, hist_mean (&rnd.draw) / 1e3,
+		rnd.draw.max / 1e3, hist_mean (&rnd.latency) / 1e3,
+		rnd.latency.max / 1e3);
+	if (0 < render_hz && 0 < rnd.per_frame.count) {
+	    printf ("render: %d Hz, shown per tick avg %.2f, min %llu, "
+		    "max %llu; %lu draws over the %.1f ms budget, %lu "
+		    "periods skipped\n", render_hz, hist_mean (&rnd.per_frame),
+		    (unsigned long long)rnd.per_frame.min, 
+		    (unsigned long long)rnd.per_frame.max, rnd.over_budget,
+		    1e3 / render_hz, rnd.skipped);
+	}
+    }
+
+    /* Report status bar work. */
+    if (stats) {
+	get_bar_stats (&bs);
+	printf ("status bar: %lu updates, %lu renders, %lu uploads, "
+		"%lu allocations\n", bs.updates, bs.renders, bs.uploads,
+		bs.allocations);
+    }
+
+    /* Report the world description. */
+    if (stats) {
+	report_world ();
+    }
+
+    /* Report what the real-time mode obtained and how ticks fared. */
+    if (0 != rt_priority) {
+	get_realtime_stats (&rts);
+	printf ("realtime: SCHED_FIFO priority %d%s, %s%s, memory %slocked, "
+		"%zu bytes of photos pre-faulted; %ld minor and %ld major "
+		"page faults since\n", rt_priority, 
+		(0 == rts.priority ? " not obtained" : ""),
+		(0 == rts.n_cpus ? "any CPU" : "CPUs "),
+		(0 == rts.n_cpus ? "" : rt_cpus), 
+		(rts.locked ? "" : "not "), rts.prefaulted,
+		rts.minor_faults, rts.major_faults);
+	printf ("realtime: worst tick lateness %.1f us (p99 %.1f us, "
+		"p99.9 %.1f us) over %lu ticks, %lu missed\n", 
+		tick_stats.late.max / 1e3, 
+		hist_percentile (&tick_stats.late, 0.99) / 1e3,
+		hist_percentile (&tick_stats.late, 0.999) / 1e3,
+		tick_stats.ticks, tick_stats.missed);
+    }
+
+    /* Return success. */
+    return 0;
 }
-#endif /* !defined(NDEBUG) */
@@ -0,0 +1,166 @@
+/*									tab:8
+ *
+ * hist.c - log-linear latency histograms
+ *
+ * Filename:	    hist.c
+ * History:
+ *	1	First written.  Fixed-size histograms for per-tick timing
+ *		instrumentation in the game loop.
+ */
+
+#include <stdio.h>
+
+#include "hist.h"
+
+
+/* local functions--see function headers for details */
+static uint32_t bucket_of (uint64_t ns);
+static uint64_t bucket_low (uint32_t idx);
+
+
+/*
+ * bucket_of
+ *   DESCRIPTION: Find the bucket in which a value is recorded.
+ *   INPUTS: ns -- the value
+ *   OUTPUTS: none
+ *   RETURN VALUE: bucket index
+ *   SIDE EFFECTS: none
+ */
+static uint32_t
+bucket_of (uint64_t ns)
+{
+    uint32_t e; /* position of most significant bit of ns */
+
+    if ((1ULL << HIST_SUB_BITS) > ns)
+	return ns;
+    if ((1ULL << HIST_RANGE_BITS) <= ns)
+	return (HIST_BUCKETS - 1);
+    e = 63 - __builtin_clzll (ns);
+    return (((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+	    ((ns >> (e - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1)));
+}
+
+
+/*
+ * bucket_low
+ *   DESCRIPTION: Find the smallest value recorded in a bucket.
+ *   INPUTS: idx -- bucket index
+ *   OUTPUTS: none
+ *   RETURN VALUE: smallest value (ns) in the bucket
+ *   SIDE EFFECTS: none
+ */
+static uint64_t
+bucket_low (uint32_t idx)
+{
+    uint32_t e;   /* position of most significant bit of values */
+    uint64_t sub; /* bits below the most significant bit        */
+
+    if ((1 << HIST_SUB_BITS) > idx)
+	return idx;
+    e = (idx >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    sub = idx & ((1 << HIST_SUB_BITS) - 1);
+    return (((1ULL << HIST_SUB_BITS) + sub) << (e - HIST_SUB_BITS));
+}
+
+
+/*
+ * hist_record
+ *   DESCRIPTION: Record one value in a histogram.
+ *   INPUTS: h -- the histogram
+ *           ns -- the value
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates the histogram
+ */
+void
+hist_record (hist_t* h, uint64_t ns)
+{
+    if (0 == h->count || ns < h->min)
+	h->min = ns;
+    if (ns > h->max)
+	h->max = ns;
+    h->count++;
+    h->total += ns;
+    h->bucket[bucket_of (ns)]++;
+}
+
+
+/*
+ * hist_percentile
+ *   DESCRIPTION: Find the value at or below which a given fraction of the
+ *                recorded values lie.  The result is the top of the bucket
+ *                holding that value, but never more than the maximum.
+ *   INPUTS: h -- the histogram
+ *           p -- the fraction, from 0 to 1
+ *   OUTPUTS: none
+ *   RETURN VALUE: the value (ns), or 0 if the histogram is empty
+ *   SIDE EFFECTS: none
+ */
+uint64_t
+hist_percentile (const hist_t* h, double p)
+{
+    uint64_t want; /* rank of value sought   */
+    uint64_t seen; /* values in buckets seen */
+    uint32_t idx;  /* index over buckets     */
+    uint64_t top;  /* top of bucket          */
+
+    if (0 == h->count)
+	return 0;
+    want = (uint64_t)(p * h->count + 0.5);
+    if (1 > want)
+	want = 1;
+    for (seen = 0, idx = 0; HIST_BUCKETS - 1 > idx; idx++) {
+	if (want <= (seen += h->bucket[idx]))
+	    break;
+    }
+    top = (HIST_BUCKETS - 1 > idx ? bucket_low (idx + 1) - 1 : h->max);
+    return (top < h->max ? top : h->max);
+}
+
+
+/*
+ * hist_mean
+ *   DESCRIPTION: Find the mean of the recorded values.
+ *   INPUTS: h -- the histogram
+ *   OUTPUTS: none
+ *   RETURN VALUE: the mean (ns), or 0 if the histogram is empty
+ *   SIDE EFFECTS: none
+ */
+double
+hist_mean (const hist_t* h)
+{
+    return (0 == h->count ? 0 : (double)h->total / h->count);
+}
+
+
+/*
+ * hist_write_json
+ *   DESCRIPTION: Write a histogram as a JSON object.
+ *   INPUTS: out -- stream for the object
+ *           h -- the histogram
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+hist_write_json (FILE* out, const hist_t* h)
+{
+    uint32_t idx;   /* index over buckets           */
+    int      first; /* no bucket has been written yet */
+
+    fprintf (out, "{\"count\": %llu, \"min_us\": %.3f, \"mean_us\": %.3f, "
+	     "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, "
+	     "\"p999_us\": %.3f, \"max_us\": %.3f, \"buckets\": [",
+	     (unsigned long long)h->count, h->min / 1e3, hist_mean (h) / 1e3,
+	     hist_percentile (h, 0.5) / 1e3, hist_percentile (h, 0.9) / 1e3,
+	     hist_percentile (h, 0.99) / 1e3, hist_percentile (h, 0.999) / 1e3,
+	     h->max / 1e3);
+    for (first = 1, idx = 0; HIST_BUCKETS > idx; idx++) {
+	if (0 == h->bucket[idx])
+	    continue;
+	fprintf (out, "%s[%llu, %u]", (first ? "" : ", "),
+		 (unsigned long long)bucket_low (idx), h->bucket[idx]);
+	first = 0;
+    }
+    fprintf (out, "]}");
+}
@@ -0,0 +1,58 @@
+/*									tab:8
+ *
+ * hist.h - header file for log-linear latency histograms
+ *
+ * Filename:	    hist.h
+ * History:
+ *	1	First written.  Fixed-size histograms for per-tick timing
+ *		instrumentation in the game loop.
+ */
+
+#ifndef HIST_H
+#define HIST_H
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+/*
+ * Histograms record nanosecond values in the manner of HdrHistogram:
+ * values below 2^HIST_SUB_BITS each have a bucket of their own, and each
+ * power of two above that is split into 2^HIST_SUB_BITS equal buckets,
+ * so that every value is recorded to within 1/16 (6.25%).  Values of
+ * 2^HIST_RANGE_BITS ns (about 18 minutes) or more share the last bucket.
+ * Recording is a few shifts and an increment, with no allocation.
+ */
+#define HIST_SUB_BITS   4
+#define HIST_RANGE_BITS 40
+#define HIST_BUCKETS    ((HIST_RANGE_BITS - HIST_SUB_BITS + 1) << \
+			 HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t count;                 /* values recorded       */
+    uint64_t total;                 /* sum of values (ns)    */
+    uint64_t min;                   /* smallest value (ns)   */
+    uint64_t max;                   /* largest value (ns)    */
+    uint32_t bucket[HIST_BUCKETS];  /* counts by value range */
+} hist_t;
+
+/* Record one value (in nanoseconds). */
+extern void hist_record (hist_t* h, uint64_t ns);
+
+/*
+ * Get the value (ns) at or below which fraction p of the recorded values
+ * lie, accurate to the bucket width; 0 if nothing has been recorded.
+ */
+extern uint64_t hist_percentile (const hist_t* h, double p);
+
+/* Get the mean of the recorded values (ns); 0 if nothing was recorded. */
+extern double hist_mean (const hist_t* h);
+
+/*
+ * Write a histogram as a JSON object: count, summary statistics in
+ * microseconds, and the non-empty buckets as [lowest ns, count] pairs.
+ */
+extern void hist_write_json (FILE* out, const hist_t* h);
+
+#endif /* HIST_H */
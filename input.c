@@ -64,10 +64,46 @@
 #define USE_TUX_CONTROLLER 0
 
 
+/* 
+ * Input is passed from read_input to get_queued_command through a ring of
+ * timestamped events, so that every command is carried out in order even
+ * when several arrive within one tick.  Typed characters are queued as
+ * events too (with command CMD_NONE), so that characters typed after an
+ * Enter do not change the command before it is handled.  Commands 
+ * replayed from a recording are added with queue_command and may carry
+ * the typed command to be handled with them.
+ *
+ * The ring has a single producer (read_input or queue_command, in one
+ * thread), which alone advances
+ * ring_tail, and a single consumer (get_queued_command), which alone
+ * advances ring_head.  Each side publishes its index with a release store
+ * and reads the other's with an acquire load, so no lock is needed even
+ * if the two run in different threads.  The indices run freely; the slot
+ * is the index modulo INPUT_RING_SIZE, which must be a power of two.
+ */
+#define INPUT_RING_SIZE 256
+
+typedef struct {
+    cmd_t cmd;            /* command, or CMD_NONE for a typed character */
+    char ch;              /* the typed character                        */
+    const char* text;     /* replaces typed command (if not NULL)       */
+    struct timespec time; /* arrival time                               */
+} input_event_t;
+
+static input_event_t ring[INPUT_RING_SIZE];
+static unsigned int ring_head;  /* next event to remove */
+static unsigned int ring_tail;  /* next free slot       */
+static input_stats_t input_stats;
+
 /* stores original terminal settings */
 static struct termios tio_orig;
 
 
+/* local functions--see function headers for details */
+static void queue_event (cmd_t cmd, char ch, const char* text,
+			 const struct timespec* when);
+
+
 /* 
  * init_input
  *   DESCRIPTION: Initializes the input controller.  As both keyboard and
@@ -157,32 +193,73 @@ typed_a_char (char c)
 }
 
 /* 
- * get_command
- *   DESCRIPTION: Reads a command from the input controller.  As some
- *                controllers provide only absolute input (e.g., go
- *                right), the current direction is needed as an input
- *                to this routine.
- *   INPUTS: cur_dir -- current direction of motion
+ * queue_event
+ *   DESCRIPTION: Add an event to the input queue.
+ *   INPUTS: cmd -- the command, or CMD_NONE for a typed character
+ *           ch -- the typed character (ignored for commands)
+ *           text -- replacement typed command, or NULL for none
+ *           when -- arrival time of the event
  *   OUTPUTS: none
- *   RETURN VALUE: command issued by the input controller
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: drops the event and counts an overflow if the queue is
+ *                 full; updates queue statistics
+ */
+static void
+queue_event (cmd_t cmd, char ch, const char* text, 
+	     const struct timespec* when)
+{
+    unsigned int head = __atomic_load_n (&ring_head, __ATOMIC_ACQUIRE);
+    unsigned int depth = ring_tail - head;
+
+    if (INPUT_RING_SIZE == depth) {
+	input_stats.overflows++;
+	return;
+    }
+    ring[ring_tail % INPUT_RING_SIZE].cmd = cmd;
+    ring[ring_tail % INPUT_RING_SIZE].ch = ch;
+    ring[ring_tail % INPUT_RING_SIZE].text = text;
+    ring[ring_tail % INPUT_RING_SIZE].time = *when;
+    __atomic_store_n (&ring_tail, ring_tail + 1, __ATOMIC_RELEASE);
+
+    input_stats.events++;
+    if (CMD_NONE != cmd)
+	input_stats.commands++;
+    if (depth + 1 > input_stats.max_depth)
+	input_stats.max_depth = depth + 1;
+}
+
+/* 
+ * read_input
+ *   DESCRIPTION: Reads all available input from the input controller and
+ *                adds the commands and typed characters to the input queue.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of events queued
  *   SIDE EFFECTS: drains any keyboard input
  */
-cmd_t 
-get_command ()
+int
+read_input ()
 {
 #if (USE_TUX_CONTROLLER == 0) /* use keyboard control with arrow keys */
     static int state = 0;             /* small FSM for arrow keys */
 #endif
-    static cmd_t command = CMD_NONE;
-    cmd_t pushed = CMD_NONE;
+    struct timespec now;
+    unsigned int start = ring_tail;
+    cmd_t pushed;
     int ch;
 
+    /* All characters read now arrived at about the same time. */
+    (void)clock_gettime (CLOCK_MONOTONIC, &now);
+
     /* Read all characters from stdin. */
     while ((ch = getc (stdin)) != EOF) {
 
 	/* Backquote is used to quit the game. */
-	if (ch == '`')
-	    return CMD_QUIT;
+	if (ch == '`') {
+	    queue_event (CMD_QUIT, 0, NULL, &now);
+	    break;
+	}
+	pushed = CMD_NONE;
 	
 #if (USE_TUX_CONTROLLER == 0) /* use keyboard control with arrow keys */
 	/*
@@ -198,7 +275,7 @@ get_command ()
 	        if (27 == ch) {
 		    state = 1;
 		} else if (valid_typing (ch)) {
-		    typed_a_char (ch);
+		    queue_event (CMD_NONE, ch, NULL, &now);
 		} else if (10 == ch || 13 == ch) {
 		    pushed = CMD_TYPED;
 		}
@@ -213,7 +290,7 @@ get_command ()
 			 * Note that we may be discarding an ESC (27), but
 			 * we don't use that as typed input anyway.
 			 */
-			typed_a_char (ch);
+			queue_event (CMD_NONE, ch, NULL, &now);
 		    } else if (10 == ch || 13 == ch) {
 			pushed = CMD_TYPED;
 		    }
@@ -243,7 +320,7 @@ get_command ()
 			 * a bracket (91), but we don't use either as 
 			 * typed input anyway.
 			 */
-			typed_a_char (ch);
+			queue_event (CMD_NONE, ch, NULL, &now);
 		    } else if (10 == ch || 13 == ch) {
 			pushed = CMD_TYPED;
 		    }
@@ -254,7 +331,7 @@ get_command ()
 	        if ('~' == ch) {
 		    /* Consume it silently. */
 		} else if (valid_typing (ch)) {
-		    typed_a_char (ch);
+		    queue_event (CMD_NONE, ch, NULL, &now);
 		} else if (10 == ch || 13 == ch) {
 		    pushed = CMD_TYPED;
 		}
@@ -263,21 +340,126 @@ get_command ()
 #else /* USE_TUX_CONTROLLER */
 	/* Tux controller mode; still need to support typed commands. */
 	if (valid_typing (ch)) {
-	    typed_a_char (ch);
+	    queue_event (CMD_NONE, ch, NULL, &now);
 	} else if (10 == ch || 13 == ch) {
 	    pushed = CMD_TYPED;
 	}
 #endif /* USE_TUX_CONTROLLER */
+
+	if (CMD_NONE != pushed) {
+	    queue_event (pushed, 0, NULL, &now);
+	}
     }
+    return (ring_tail - start);
+}
 
-    /*
-     * Once a direction is pushed, that command remains active
-     * until a turn is taken.
-     */
-    if (pushed == CMD_NONE) {
-        command = CMD_NONE;
+/* 
+ * queue_command
+ *   DESCRIPTION: Adds a command to the input queue as if it had been read
+ *                from the input controller.  Used to replay recordings.
+ *   INPUTS: cmd -- the command
+ *           typed -- for CMD_TYPED, the typed command to be handled (it
+ *                    replaces the current one when the command is
+ *                    removed from the queue), or NULL to use the current
+ *                    one; must remain valid until then
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: adds an event to the input queue
+ */
+void
+queue_command (cmd_t cmd, const char* typed)
+{
+    struct timespec now;
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &now);
+    queue_event (cmd, 0, typed, &now);
+}
+
+/* 
+ * get_queued_command
+ *   DESCRIPTION: Removes the next command from the input queue.  Typed
+ *                characters queued ahead of the command are applied to
+ *                the typed command as they are removed.
+ *   INPUTS: none
+ *   OUTPUTS: cmd -- the command, or CMD_NONE if the queue holds none
+ *            when -- arrival time of the first event removed (unchanged
+ *                    if none were)
+ *   RETURN VALUE: number of events removed
+ *   SIDE EFFECTS: may change the typed command
+ */
+int
+get_queued_command (cmd_t* cmd, struct timespec* when)
+{
+    unsigned int tail = __atomic_load_n (&ring_tail, __ATOMIC_ACQUIRE);
+    unsigned int start = ring_head;
+    input_event_t* ev;
+
+    *cmd = CMD_NONE;
+    while (ring_head != tail && CMD_NONE == *cmd) {
+	ev = &ring[ring_head % INPUT_RING_SIZE];
+	if (start == ring_head)
+	    *when = ev->time;
+	if (CMD_NONE == ev->cmd) {
+	    typed_a_char (ev->ch);
+	} else if (NULL != ev->text) {
+	    (void)strncpy (typing, ev->text, MAX_TYPED_LEN);
+	    typing[MAX_TYPED_LEN] = '\0';
+	}
+	*cmd = ev->cmd;
+	__atomic_store_n (&ring_head, ring_head + 1, __ATOMIC_RELEASE);
     }
-    return pushed;
+    return (ring_head - start);
+}
+
+/* 
+ * get_command
+ *   DESCRIPTION: Reads a command from the input controller.  Any input
+ *                available is first added to the input queue; the next
+ *                queued command is then returned.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: command issued by the input controller
+ *   SIDE EFFECTS: drains any keyboard input
+ */
+cmd_t 
+get_command ()
+{
+    struct timespec when;
+    cmd_t cmd;
+
+    (void)read_input ();
+    (void)get_queued_command (&cmd, &when);
+    return cmd;
+}
+
+/* 
+ * get_input_stats
+ *   DESCRIPTION: Get statistics on the input queue.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+get_input_stats (input_stats_t* stats)
+{
+    *stats = input_stats;
+}
+
+/* 
+ * get_input_fd
+ *   DESCRIPTION: Get the file descriptor from which input is read, so that
+ *                the caller can wait (with poll or select) for input to
+ *                arrive before calling get_command.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the input file descriptor
+ *   SIDE EFFECTS: none
+ */
+int
+get_input_fd ()
+{
+    return fileno (stdin);
 }
 
 /* 
@@ -38,6 +38,8 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include <time.h>
+
 /* possible commands from input device, whether keyboard or game controller */
 typedef enum {
     CMD_NONE, CMD_RIGHT, CMD_LEFT, CMD_UP, CMD_DOWN,
@@ -52,9 +54,44 @@ typedef enum {
 /* Initialize the input device. */
 extern int init_input ();
 
+/* input queue statistics */
+typedef struct {
+    unsigned long events;    /* events queued (commands and characters) */
+    unsigned long commands;  /* commands queued                         */
+    unsigned long overflows; /* events lost because the queue was full  */
+    unsigned int  max_depth; /* most events waiting in the queue        */
+} input_stats_t;
+
+/* 
+ * Read all available input into the input queue.  Returns the number of
+ * events queued.
+ */
+extern int read_input ();
+
+/* 
+ * Add a command to the input queue as if it had been read.  For
+ * CMD_TYPED, typed (if not NULL) replaces the typed command when the
+ * command is removed from the queue, and must remain valid until then.
+ */
+extern void queue_command (cmd_t cmd, const char* typed);
+
+/* 
+ * Remove the next command from the input queue into *cmd (CMD_NONE if
+ * there is none), first applying any typed characters queued ahead of it
+ * to the typed command.  Returns the number of events removed; if any
+ * were, *when is set to the arrival time of the first.
+ */
+extern int get_queued_command (cmd_t* cmd, struct timespec* when);
+
 /* Read a command from the input device. */
 extern cmd_t get_command ();
 
+/* Get input queue statistics. */
+extern void get_input_stats (input_stats_t* stats);
+
+/* Get a file descriptor that becomes readable when input arrives. */
+extern int get_input_fd ();
+
 /* Get currently typed command string. */
 extern const char* get_typed_command ();
 
@@ -45,11 +45,17 @@
 #include <string.h>
 #include <sys/io.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 
 #include "modex.h"
 #include "text.h"
+#include "upload.h"
+#if defined(VGA_EMULATOR)
+#include "term.h"
+#include "vga_emu.h"
+#endif
 
 
 /* 
@@ -77,6 +83,34 @@
 #define BUILD_BASE_INIT ((BUILD_BUF_SIZE - SCREEN_SIZE) / 2) // center of buffer to copy planes to 
 // in the case that a new window request exceeds the boundaries of the buffer
 
+/*
+ * Display pages in video memory.  The status bar occupies the start of
+ * video memory (shown after the line compare), and NUM_PAGES pages of
+ * SCROLL_SIZE bytes per plane follow it at PAGE_STRIDE intervals.  Three
+ * pages allow page flips synchronized with vertical retrace without ever
+ * drawing into a page that may still be on the screen: after the start
+ * address is written, the CRTC keeps showing the old page until the next
+ * retrace, so the page drawn next must be neither of those two.
+ */
+#define NUM_PAGES       3
+#define PAGE_BASE       (18 * IMAGE_X_WIDTH * 2)
+#define PAGE_STRIDE     0x4000
+
+/* 
+ * Timing of mode X (800 dots by 449 scan lines at 25.175 MHz, about 70
+ * Hz), used to tell from the last retrace seen whether another has begun
+ * since: the length of a frame and of the retrace pulse (2 scan lines).
+ * Retraces are taken to come as much as one part in FRAME_SLACK later
+ * than FRAME_NS says, to allow for a dot clock off its nominal rate.
+ * That margin grows with each frame predicted, delaying flips, so
+ * retraces are predicted only ANCHOR_NS (a quarter frame of margin) past
+ * the last one seen.
+ */
+#define FRAME_NS        14268123ULL
+#define SYNC_NS         (FRAME_NS * 2 / 449)
+#define ANCHOR_NS       (FRAME_NS * FRAME_SLACK / 4)
+#define FRAME_SLACK     1024
+
 /* Mode X and general VGA parameters */
 #define VID_MEM_SIZE       131072
 #define MODE_X_MEM_SIZE     65536
@@ -144,8 +178,28 @@ static void fill_palette_mode_x ();
 static void fill_palette_text ();
 static void write_font_data ();
 static void set_text_mode_3 (int clear_scr);
+static void select_upload_kernel ();
+static unsigned long long retrace_clock_ns ();
+static void wait_for_retrace ();
+static void note_retrace ();
+static int retrace_since (unsigned long long t);
+static int page_busy (int pg);
+static int free_page ();
+static void flip_page (int pg, int pan);
+static void try_flip ();
+static int scroll_with_latches (unsigned char* img[4], int lx, int n,
+				unsigned short src_img);
+static void set_pixel_panning (unsigned char val);
+static void latch_copy (unsigned short dst, unsigned short src, int n);
 static void copy_image (unsigned char* img, unsigned short scr_addr);
+static void copy_image_part (unsigned char* img, unsigned short scr_addr,
+			     int n);
 static void copy_status_bar (unsigned char* bar);
+#if !defined(TEXT_RESTORE_PROGRAM)
+static void draw_column (int x, int first, int n);
+static void record_horiz_line (int y);
+static void record_vert_line (int x);
+#endif
 
 
 /* 
@@ -183,13 +237,78 @@ static void copy_status_bar (unsigned char* bar);
 static unsigned char build[BUILD_BUF_SIZE + 2 * MEM_FENCE_WIDTH];
 static unsigned char* bar; /* buffer for the pixel data of the status bar.   
                                             4 planes formatted just like screen buffer.*/ 
+
+/* 
+ * The status bar image is rendered into bar_image only when its text
+ * changes, and copied to video memory (where all pages share it) only
+ * after it is rendered or the video memory is cleared.
+ */
+#define BAR_CHARS (IMAGE_X_DIM / FONT_WIDTH)  /* characters on status bar */
+static unsigned char bar_image[BAR_SIZE];     /* planar status bar image  */
+static char bar_text[BAR_CHARS + 1];          /* text shown in bar_image  */
+static int bar_upload;                        /* bar needs copy to video  */
+static bar_stats_t bar_stats;                 /* status bar work done     */
 static int img3_off;		    /* offset of upper left pixel   */
 static unsigned char* img3;	    /* pointer to upper left pixel  */
 static int show_x, show_y;          /* logical view coordinates     */
 
 /* displayed video memory variables */
+#if !defined(VGA_EMULATOR)
 static unsigned char* mem_image;    /* pointer to start of video memory */
+#endif
 static unsigned short target_img;   /* offset of displayed screen image */
+static int page;                    /* index of target screen page      */
+
+/* 
+ * page flip synchronization with vertical retrace (see show_screen): the
+ * page flipped to last and when, the page flipped from (still on the
+ * screen until the next retrace), and a page drawn but not yet flipped to
+ */
+static int retrace_sync;                 /* flip once a frame if non-zero */
+static retrace_stats_t retrace_stats;    /* flips made and waits          */
+static unsigned long long retrace_ns;    /* start of a retrace seen, or 0 */
+static unsigned long long flip_ns;       /* time of the last flip         */
+static int front_page;                   /* page flipped to last, or -1   */
+static int old_page;                     /* page flipped from, or -1      */
+static int queued_page;                  /* page awaiting a flip, or -1   */
+static int queued_pan;                   /* pixel panning for that page   */
+
+/* 
+ * latch-copy scrolling (see show_screen): the screen on display, the
+ * logical view coordinates that it shows, and the logical lines drawn
+ * into the build buffer since it was shown
+ */
+static int latch_scroll;                 /* scroll with latches if set   */
+static int shown_valid;                  /* shown_* describe the display */
+static unsigned short shown_img;         /* offset of screen last shown  */
+static int shown_x, shown_y;             /* logical pixel at its address 0 */
+static int shown_n;                      /* bytes per row on display     */
+static int dirty_x[SCROLL_X_DIM];        /* logical columns drawn        */
+static int dirty_y[SCROLL_Y_DIM];        /* logical rows drawn           */
+static int n_dirty_x, n_dirty_y;         /* number of each drawn         */
+static int dirty_all;                    /* too many lines drawn to list */
+static scroll_stats_t scroll_stats;      /* video memory traffic         */
+
+/* 
+ * hardware pixel panning (see show_screen): with panning, each row in
+ * video memory holds one extra address for the up to three pixels 
+ * shifted in from the right, so rows are two addresses longer (the CRTC
+ * offset register counts words)
+ */
+static int pixel_pan;                     /* pan for x % 4 if set       */
+static int vram_width = IMAGE_X_WIDTH;    /* addresses per row in video */
+
+/* 
+ * terminal display of each frame shown (see set_terminal_display); only
+ * available with the VGA emulator, which can render the frame on display
+ */
+#if defined(VGA_EMULATOR)
+static term_colors_t term_colors = TERM_OFF;  /* colors, or off          */
+static unsigned int term_budget;              /* bytes per frame         */
+#endif
+
+/* copy kernel used by copy_image and copy_status_bar; see upload.c */
+static upload_fn_t upload_fn;
 
 
 /* 
@@ -201,6 +320,8 @@ static void (*horiz_line_fn) (int, int, unsigned char[SCROLL_X_DIM]);
 static void (*vert_line_fn) (int, int, unsigned char[SCROLL_Y_DIM]);
 	
 
+#if !defined(VGA_EMULATOR)
+
 /* 
  * macro used to target a specific video plane or planes when writing
  * to video memory in mode X; bits 8-11 in the mask_hi_bits enable writes
@@ -231,6 +352,16 @@ do {                                                                    \
       : "memory", "cc");                                                \
 } while (0)
 
+/* macro used to read a byte from a port */
+#define INB(port,val)                                                   \
+do {                                                                    \
+    asm volatile ("                                                     \
+        inb (%w1),%b0                                                   \
+    " : "=a" ((val))                                                    \
+      : "d" ((port))                                                    \
+      : "memory", "cc");                                                \
+} while (0)
+
 /* macro used to write two bytes to two consecutive ports */
 #define OUTW(port,val)                                                  \
 do {                                                                    \
@@ -273,6 +404,51 @@ do {                                                                    \
       : "eax", "memory", "cc");                                         \
 } while (0)
 
+#else /* defined(VGA_EMULATOR) */
+
+/*
+ * When built with VGA_EMULATOR, the port macros feed the software VGA
+ * model in vga_emu.c instead of the hardware, and video memory writes
+ * are routed through the model so that the map mask is respected.
+ */
+#define SET_WRITE_MASK(mask_hi_bits)                                    \
+do {                                                                    \
+    vga_emu_outw (0x03C4, ((mask_hi_bits) & 0xFF00) | 0x02);           \
+} while (0)
+
+#define OUTB(port,val)                                                  \
+do {                                                                    \
+    vga_emu_outb ((port), (val));                                       \
+} while (0)
+
+#define OUTW(port,val)                                                  \
+do {                                                                    \
+    vga_emu_outw ((port), (val));                                       \
+} while (0)
+
+#define INB(port,val)                                                   \
+do {                                                                    \
+    (val) = vga_emu_inb ((port));                                       \
+} while (0)
+
+#define REP_OUTSW(port,source,count)                                    \
+do {                                                                    \
+    const unsigned short* _src = (const unsigned short*)(source);      \
+    int _cnt;                                                           \
+    for (_cnt = (count); _cnt > 0; _cnt--)                              \
+        vga_emu_outw ((port), *_src++);                                 \
+} while (0)
+
+#define REP_OUTSB(port,source,count)                                    \
+do {                                                                    \
+    const unsigned char* _src = (const unsigned char*)(source);        \
+    int _cnt;                                                           \
+    for (_cnt = (count); _cnt > 0; _cnt--)                              \
+        vga_emu_outb ((port), *_src++);                                 \
+} while (0)
+
+#endif /* !defined(VGA_EMULATOR) */
+
 
 /*
  * set_mode_X
@@ -323,8 +499,17 @@ set_mode_X (void (*horiz_fill_fn) (int, int, unsigned char[SCROLL_X_DIM]),
     text_to_bar(t);
     */
    
-    /* One display page goes at the start of video memory. */
-    target_img = 18*IMAGE_X_WIDTH*2;
+    /* Display pages follow the status bar in video memory. */
+    page = 0;
+    target_img = PAGE_BASE;
+    shown_valid = 0;
+    /* 
+     * Until the first flip, the screen starts at address 0 (see
+     * mode_X_CRTC), which takes in the top of page 0.
+     */
+    front_page = 0;
+    old_page = queued_page = -1;
+    retrace_ns = flip_ns = 0;
 
     /* Map video memory and obtain permission for VGA port access. */
     if (open_memory_and_ports () == -1)
@@ -345,12 +530,20 @@ set_mode_X (void (*horiz_fill_fn) (int, int, unsigned char[SCROLL_X_DIM]),
     VGA_blank (1);                               /* blank the screen      */
     set_seq_regs_and_reset (mode_X_seq, 0x63);   /* sequencer registers   */
     set_CRTC_registers (mode_X_CRTC);            /* CRT control registers */
+    OUTW (0x03D4, ((vram_width / 2) << 8) | 0x13); /* row length          */
     set_attr_registers (mode_X_attr);            /* attribute registers   */
     set_graphics_registers (mode_X_graphics);    /* graphics registers    */
     fill_palette_mode_x ();			 /* palette colors        */
+    select_upload_kernel ();			 /* time copy kernels     */
     clear_screens ();				 /* zero video memory     */
     VGA_blank (0);			         /* unblank the screen    */
 
+#if defined(VGA_EMULATOR)
+    /* Take over the terminal, if frames are also shown there. */
+    if (TERM_OFF != term_colors && 0 != term_start (term_colors, term_budget))
+        return -1;
+#endif
+
     /* Return success. */
     return 0;
 }
@@ -369,12 +562,26 @@ void
 clear_mode_X ()
 {
     int i;   /* loop index for checking memory fence */
+
+    /* Flip to the last screen shown if it is still waiting for retrace. */
+    if (-1 != queued_page) {
+	wait_for_retrace ();
+	try_flip ();
+    }
+
+#if defined(VGA_EMULATOR)
+    /* Save the last mode X frame before the model leaves mode X. */
+    (void)vga_emu_write_ppm (VGA_EMU_PPM_FILE);
+    term_stop ();
+#endif
     
     /* Put VGA into text mode, restore font data, and clear screens. */
     set_text_mode_3 (1);
 
+#if !defined(VGA_EMULATOR)
     /* Unmap video memory. */
     (void)munmap (mem_image, VID_MEM_SIZE);
+#endif
 
     /* Check validity of build buffer memory fence.  Report breakage. */
     for (i = 0; i < MEM_FENCE_WIDTH; i++) {
@@ -509,6 +716,14 @@ set_view_window (int scr_x, int scr_y)
 /*
  * show_screen
  *   DESCRIPTION: Show the logical view window on the video display.
+ *                With latch-copy scrolling enabled, the part of the
+ *                new screen that was already on display is moved within
+ *                video memory, and only the rest is copied from the
+ *                build buffer (see scroll_with_latches).  With pixel
+ *                panning enabled, the screen is laid out in video memory
+ *                from the nearest multiple of four pixels to the left of
+ *                the view, and the attribute controller shifts the display
+ *                by the other zero to three pixels.
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
@@ -518,40 +733,334 @@ set_view_window (int scr_x, int scr_y)
 void
 show_screen ()
 {
-    unsigned char* addr;  /* source address for copy             */
-    int p_off;            /* plane offset of first display plane */
-    int i;		  /* loop index over video planes        */
+    unsigned char* img[4]; /* build buffer image of each display plane */
+    int lx;                /* logical x of pixels at display address 0  */
+    int n;                 /* bytes per row copied to each plane        */
+    int i;		   /* loop index over video planes              */
+    int r;		   /* loop index over rows                      */
 
     /* 
-     * Calculate offset of build buffer plane to be mapped into plane 0 
-     * of display.
+     * Choose the layout of the screen.  Without pixel panning, display
+     * address 0 holds the leftmost four pixels of the view.  With it,
+     * the view starts up to three pixels into the first address, and
+     * rows then need one more address unless the view is aligned.
      */
-    p_off = (3 - (show_x & 3));
+    lx = (pixel_pan ? (show_x & ~3) : show_x);
+    n = SCROLL_X_WIDTH + (lx != show_x);
 
-    /* Switch to the other target screen in video memory. */
-    target_img ^= 0x4000;
+    /* 
+     * Calculate the address of the build buffer image of each display
+     * plane.  Logical pixel x is stored at address x / 4 in build buffer
+     * plane (3 - x % 4), since the planes are in reverse order.
+     */
+    for (i = 0; i < 4; i++) {
+	img[i] = img3 + (3 - ((lx + i) & 3)) * SCROLL_SIZE + 
+		 ((lx + i) >> 2) + show_y * SCROLL_X_WIDTH;
+    }
 
-    /* Calculate the source address. */
-    addr = img3 + (show_x >> 2) + show_y * SCROLL_X_WIDTH;
+    /* 
+     * Switch to the next target screen in video memory.  When flips are
+     * synchronized with retrace, it must be a page that is neither on
+     * the screen nor about to be (see free_page).
+     */
+    shown_img = target_img;
+    page = (retrace_sync ? free_page () : (page + 1) % NUM_PAGES);
+    target_img = PAGE_BASE + page * PAGE_STRIDE;
 
     /* Draw to each plane in the video memory. */
-    for (i = 0; i < 4; i++) {
-	SET_WRITE_MASK (1 << (i + 8));
-	copy_image (addr + ((p_off - i + 4) & 3) * SCROLL_SIZE + (p_off < i), 
-	            target_img);
-    //my code
-    if (bar){
-        copy_status_bar(bar+(i*BAR_SIZE/4));
+    if (!latch_scroll || !scroll_with_latches (img, lx, n, shown_img)) {
+	for (i = 0; i < 4; i++) {
+	    SET_WRITE_MASK (1 << (i + 8));
+	    if (SCROLL_X_WIDTH == vram_width) {
+		copy_image (img[i], target_img);
+	    } else {
+		for (r = 0; r < SCROLL_Y_DIM; r++)
+		    copy_image_part (img[i] + r * SCROLL_X_WIDTH, 
+				     target_img + r * vram_width, n);
+	    }
+	    //my code
+	    if (bar_upload){
+		copy_status_bar(bar+(i*BAR_SIZE/4));
+	    }
+	}
+    } else {
+	scroll_stats.latch_shows++;
     }
+    scroll_stats.shows++;
+    if (bar_upload) {
+	bar_stats.uploads++;
+	bar_upload = 0;
     }
 
+    /* The new screen is the source for the next latch-copy scroll. */
+    shown_valid = 1;
+    shown_x = lx;
+    shown_y = show_y;
+    shown_n = n;
+    n_dirty_x = n_dirty_y = dirty_all = 0;
+
 
     /* 
-     * Change the VGA registers to point the top left of the screen
-     * to the video memory that we just filled.
+     * Point the top left of the screen to the video memory that we just
+     * filled.  When flips are synchronized with retrace, the page instead
+     * waits to be flipped to once a retrace has begun since the last flip
+     * (see try_flip), replacing any page still waiting, so that showing
+     * a screen does not itself wait for retrace.
      */
-    OUTW (0x03D4, (target_img & 0xFF00) | 0x0C);
-    OUTW (0x03D4, ((target_img & 0x00FF) << 8) | 0x0D);
+    if (!retrace_sync) {
+	flip_page (page, (show_x - lx) << 1);
+	return;
+    }
+    if (-1 != queued_page)
+	retrace_stats.replaced++;
+    queued_page = page;
+    queued_pan = (show_x - lx) << 1;
+    try_flip ();
+}
+
+
+/*
+ * flip_page
+ *   DESCRIPTION: Point the top left of the screen to a page in video 
+ *                memory.  The CRTC reads the start address when vertical
+ *                retrace begins, so the page flipped from stays on the
+ *                screen until then.  Every page starts at the same low
+ *                byte, so the CRTC can never read a half-written address.
+ *                In 256-color modes, the pixel panning register counts
+ *                half pixels.  Panning is reset at the line compare
+ *                (attribute mode control bit 5), so the status bar is
+ *                never panned.
+ *   INPUTS: pg -- the page
+ *           pan -- value for the pixel panning register
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes the start address (and panning) registers; 
+ *                 under the emulator, shows the screen on the terminal
+ */   
+static void
+flip_page (int pg, int pan)
+{
+    unsigned short addr = PAGE_BASE + pg * PAGE_STRIDE; /* page offset */
+
+    OUTW (0x03D4, (addr & 0xFF00) | 0x0C);
+    OUTW (0x03D4, ((addr & 0x00FF) << 8) | 0x0D);
+    if (pixel_pan)
+	set_pixel_panning (pan);
+    old_page = front_page;
+    front_page = pg;
+    if (retrace_sync) {
+	flip_ns = retrace_clock_ns ();
+	retrace_stats.flips++;
+    }
+
+#if defined(VGA_EMULATOR)
+    /* Show the new screen on the terminal too, if asked. */
+    term_show ();
+#endif
+}
+
+
+/*
+ * try_flip
+ *   DESCRIPTION: Flip to the page waiting for a flip, if any, once a
+ *                vertical retrace has begun since the last flip, so that
+ *                the start address changes at most once a frame.  A flip
+ *                waits for a retrace if none has been seen for ANCHOR_NS
+ *                (or ever), to learn when they begin (see retrace_since).
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: may flip pages
+ */   
+static void
+try_flip ()
+{
+    note_retrace ();
+    if (-1 == queued_page)
+	return;
+    if (0 == retrace_ns || ANCHOR_NS < retrace_clock_ns () - retrace_ns)
+	wait_for_retrace ();
+    if (retrace_since (flip_ns)) {
+	flip_page (queued_page, queued_pan);
+	queued_page = -1;
+    }
+}
+
+
+/*
+ * page_busy
+ *   DESCRIPTION: Tell whether a page may be on the screen or waiting to
+ *                be: the page flipped to last, the page flipped from
+ *                until a retrace has begun since that flip, and the page
+ *                waiting for a flip.
+ *   INPUTS: pg -- the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the page must not be drawn into, 0 if it may be
+ *   SIDE EFFECTS: none
+ */   
+static int
+page_busy (int pg)
+{
+    note_retrace ();
+    return (pg == front_page || pg == queued_page ||
+	    (pg == old_page && !retrace_since (flip_ns)));
+}
+
+
+/*
+ * free_page
+ *   DESCRIPTION: Choose the page to draw next when flips are synchronized
+ *                with retrace, flipping first to any page waiting if its
+ *                retrace has come.  Only if every other page is busy--
+ *                when screens are shown faster than the display shows 
+ *                them--does this wait for retrace, which frees the page
+ *                flipped from.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the page
+ *   SIDE EFFECTS: may flip pages and wait for retrace
+ */   
+static int
+free_page ()
+{
+    int i;  /* loop index over other pages */
+
+    try_flip ();
+    while (1) {
+	for (i = 1; i < NUM_PAGES; i++) {
+	    if (!page_busy ((page + i) % NUM_PAGES))
+		return ((page + i) % NUM_PAGES);
+	}
+	wait_for_retrace ();
+	try_flip ();
+    }
+}
+
+
+/*
+ * set_retrace_sync
+ *   DESCRIPTION: Enable or disable synchronization of page flips in 
+ *                show_screen with vertical retrace.
+ *   INPUTS: enable -- non-zero to flip at most once a frame, never 
+ *                     drawing into a page that may be on the screen
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+set_retrace_sync (int enable)
+{
+    retrace_sync = enable;
+}
+
+
+/*
+ * get_retrace_stats
+ *   DESCRIPTION: Get statistics on page flips synchronized with vertical
+ *                retrace and the time spent waiting for retrace.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+get_retrace_stats (retrace_stats_t* stats)
+{
+    *stats = retrace_stats;
+}
+
+
+/*
+ * set_latch_scroll
+ *   DESCRIPTION: Enable or disable latch-copy scrolling in show_screen.
+ *   INPUTS: enable -- non-zero to move retained screen data within 
+ *                     video memory rather than copying it again
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+set_latch_scroll (int enable)
+{
+    latch_scroll = enable;
+}
+
+
+/*
+ * set_pixel_pan
+ *   DESCRIPTION: Enable or disable hardware pixel panning in show_screen.
+ *                Must be called before set_mode_X, which sets the length
+ *                of rows in video memory accordingly.
+ *   INPUTS: enable -- non-zero to lay out screens in video memory at
+ *                     four-pixel boundaries and pan for the rest
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+set_pixel_pan (int enable)
+{
+    pixel_pan = enable;
+    vram_width = IMAGE_X_WIDTH + (enable ? 2 : 0);
+}
+
+
+/*
+ * get_scroll_stats
+ *   DESCRIPTION: Get statistics on video memory traffic in show_screen.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+get_scroll_stats (scroll_stats_t* stats)
+{
+    *stats = scroll_stats;
+}
+
+
+/*
+ * set_terminal_display
+ *   DESCRIPTION: Show each frame on the ANSI terminal on stdout as well
+ *                as in video memory, or stop doing so.  Must be called
+ *                before set_mode_X, which takes over the terminal.
+ *   INPUTS: colors -- colors used, or TERM_OFF for no terminal display
+ *           budget -- most bytes written to the terminal for one frame
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, or -1 if terminal display is asked for
+ *                 but needs the VGA emulator
+ *   SIDE EFFECTS: none
+ */   
+int
+set_terminal_display (term_colors_t colors, unsigned int budget)
+{
+#if defined(VGA_EMULATOR)
+    term_colors = colors;
+    term_budget = budget;
+    return 0;
+#else
+    return (TERM_OFF == colors ? 0 : -1);
+#endif
+}
+
+
+/*
+ * get_terminal_stats
+ *   DESCRIPTION: Get statistics on frames shown on the terminal.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics (all zero without terminal display)
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+get_terminal_stats (term_stats_t* stats)
+{
+#if defined(VGA_EMULATOR)
+    term_get_stats (stats);
+#else
+    (void)memset (stats, 0, sizeof (*stats));
+#endif
 }
 
 
@@ -570,7 +1079,18 @@ clear_screens ()
     SET_WRITE_MASK (0x0F00);
 
     /* Set 64kB to zero (times four planes = 256kB). */
+#if !defined(VGA_EMULATOR)
     memset (mem_image, 0, MODE_X_MEM_SIZE);
+#else
+    vga_emu_fill (0, 0, MODE_X_MEM_SIZE);
+#endif
+
+    /* 
+     * The screen on display is gone, so it can't be scrolled, and the
+     * status bar must be copied again.
+     */
+    shown_valid = 0;
+    bar_upload = (NULL != bar);
 }
 
 
@@ -582,6 +1102,15 @@ clear_screens ()
  */
 #if !defined(TEXT_RESTORE_PROGRAM)
 
+/* 
+ * cost model for scroll_view_to: the time to draw a row, a column, or
+ * the whole view, measured by calibrate_scroll_costs; until then, the
+ * number of pixels
+ */
+static scroll_costs_t scroll_costs = {
+    SCROLL_X_DIM, SCROLL_Y_DIM, SCROLL_X_DIM * SCROLL_Y_DIM, 0, 0, 0
+};
+
 
 /*
  * draw_vert_line
@@ -599,18 +1128,45 @@ clear_screens ()
  */   
 int
 draw_vert_line (int x)
+{
+    /* Check whether requested line falls in the logical view window. */
+    if (x < 0 || x >= SCROLL_X_DIM)
+	return -1;
+
+    /* Record the line for latch-copy scrolling. */
+    record_vert_line (x + show_x);
+
+    /* Draw the whole line. */
+    draw_column (x, 0, SCROLL_Y_DIM);
+
+    /* Return success. */
+    return 0;
+}
+
+
+/*
+ * draw_column
+ *   DESCRIPTION: Draw part of a vertical map line into the build buffer.
+ *   INPUTS: x -- the 0-based pixel column number of the line within the
+ *                logical view window (must be valid)
+ *           first -- the 0-based pixel row number of the first pixel to
+ *                    be drawn within the logical view window
+ *           n -- the number of pixels to be drawn (first + n must not
+ *                exceed SCROLL_Y_DIM)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: draws into the build buffer
+ */   
+static void
+draw_column (int x, int first, int n)
 {
     unsigned char buf[SCROLL_Y_DIM]; /* buffer for graphical image of line */
     unsigned char* addr;             /* address of first pixel in build    */
    				     /*     buffer (without plane offset)  */
     int i;			     /* loop index over pixels             */
-    
-    /* Check whether requested line falls in the logical view window. */
-    if (x < 0 || x >= SCROLL_X_DIM)
-	return -1;
 
-    /* Get the image of the line. */
-    (*vert_line_fn) (x+show_x, show_y, buf);
+    /* Get the image of the line, starting at the first pixel wanted. */
+    (*vert_line_fn) (x+show_x, show_y + first, buf);
 
     int xplane = (3 - ((x+show_x) & 3));
 
@@ -618,7 +1174,7 @@ draw_vert_line (int x)
     int largeColumn = x >> 2; // make sure right shift doesn't update x
 
     /* Calculate starting address of first pixel to write to in build buffer. */
-    addr = img3 + (xplane*SCROLL_SIZE) + (show_x >> 2) + (show_y * SCROLL_X_WIDTH); // addr = address of plane containing collumn x
+    addr = img3 + (xplane*SCROLL_SIZE) + (show_x >> 2) + ((show_y + first) * SCROLL_X_WIDTH); // addr = address of plane containing collumn x
     addr += largeColumn; // addr = address of first pixel to write to in column x
 
     if (((x+show_x) & 3) < (show_x & 3)) // accounts for the dont care gap in buffer (COULD BE WRONG)
@@ -628,13 +1184,10 @@ draw_vert_line (int x)
 
     // loops through the 4 planes, after the 4 incrementing the offset into the planes and looping through the 4 again
     /* Copy image data into appropriate planes in build buffer. */
-    for (i = 0; i < SCROLL_Y_DIM; i++) { 
+    for (i = 0; i < n; i++) { 
         *addr = buf[i]; 
         addr += SCROLL_X_WIDTH; // move to pixel in next row of column x
     }
-
-    /* Return success. */
-    return 0;
 }
 
 
@@ -655,36 +1208,68 @@ draw_vert_line (int x)
  */   
 int
 draw_horiz_line (int y)
+{
+    /* Check whether requested line falls in the logical view window. */
+    if (y < 0 || y >= SCROLL_Y_DIM)
+	return -1;
+
+    /* Record the line for latch-copy scrolling. */
+    record_horiz_line (y + show_y);
+
+    /* Draw the line. */
+    return draw_horiz_band (y, 1);
+}
+
+
+/*
+ * draw_horiz_band
+ *   DESCRIPTION: Draw a band of horizontal map lines into the build buffer
+ *                without recording them for latch-copy scrolling (see 
+ *                mark_view_drawn).  Each line's pixels lie in bytes of
+ *                the build buffer that no other line of the view uses, so
+ *                several threads may draw separate bands at once, as long
+ *                as nothing else changes the view or the build buffer.
+ *   INPUTS: first -- the 0-based pixel row number of the first line to be
+ *                    drawn within the logical view window
+ *           n -- the number of lines to be drawn
+ *   OUTPUTS: none
+ *   RETURN VALUE: Returns 0 on success.  If any line is outside of the 
+ *                 valid SCROLL range, the function returns -1 without
+ *                 drawing.
+ *   SIDE EFFECTS: draws into the build buffer
+ */   
+int
+draw_horiz_band (int first, int n)
 {
     unsigned char buf[SCROLL_X_DIM]; /* buffer for graphical image of line */
     unsigned char* addr;             /* address of first pixel in build    */
    				     /*     buffer (without plane offset)  */
     int p_off;                       /* offset of plane of first pixel     */
+    int y;                           /* logical row of line being drawn    */
     int i;			     /* loop index over pixels             */
     
-    /* Check whether requested line falls in the logical view window. */
-    if (y < 0 || y >= SCROLL_Y_DIM)
+    /* Check whether requested lines fall in the logical view window. */
+    if (first < 0 || n < 0 || first + n > SCROLL_Y_DIM)
 	return -1;
 
-    /* Adjust y to the logical row value. */
-    y += show_y;
+    for (y = first + show_y; y < first + n + show_y; y++) {
+	/* Get the image of the line. */
+	(*horiz_line_fn) (show_x, y, buf);
 
-    /* Get the image of the line. */
-    (*horiz_line_fn) (show_x, y, buf);
+	/* Calculate starting address in build buffer. */
+	addr = img3 + (show_x >> 2) + y * SCROLL_X_WIDTH; // addr = address of start of row y in plane 3
 
-    /* Calculate starting address in build buffer. */
-    addr = img3 + (show_x >> 2) + y * SCROLL_X_WIDTH; // addr = address of start of row y in plane 3
+	/* Calculate plane offset of first pixel. */
+	p_off = (3 - (show_x & 3)); 
 
-    /* Calculate plane offset of first pixel. */
-    p_off = (3 - (show_x & 3)); 
-
-    // loops through the 4 planes, after the 4 incrementing the offset into the planes and looping through the 4 again
-    /* Copy image data into appropriate planes in build buffer. */
-    for (i = 0; i < SCROLL_X_DIM; i++) { 
-        addr[p_off * SCROLL_SIZE] = buf[i]; 
-	if (--p_off < 0) { // resets when <0 instead of == (show_x&3) because this will account for dont care
-	    p_off = 3;
-	    addr++;
+	// loops through the 4 planes, after the 4 incrementing the offset into the planes and looping through the 4 again
+	/* Copy image data into appropriate planes in build buffer. */
+	for (i = 0; i < SCROLL_X_DIM; i++) { 
+	    addr[p_off * SCROLL_SIZE] = buf[i]; 
+	    if (--p_off < 0) { // resets when <0 instead of == (show_x&3) because this will account for dont care
+		p_off = 3;
+		addr++;
+	    }
 	}
     }
 
@@ -692,7 +1277,179 @@ draw_horiz_line (int y)
     return 0;
 }
 
-#endif /* !defined(TEXT_RESTORE_PROGRAM) */
+
+/*
+ * mark_view_drawn
+ *   DESCRIPTION: Record every horizontal line of the logical view window
+ *                as drawn for latch-copy scrolling, exactly as drawing
+ *                each with draw_horiz_line would have; used after the
+ *                whole view is drawn in bands with draw_horiz_band.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+mark_view_drawn ()
+{
+    int y; /* loop index over lines */
+
+    for (y = 0; y < SCROLL_Y_DIM; y++)
+	record_horiz_line (y + show_y);
+}
+
+
+/*
+ * record_horiz_line
+ *   DESCRIPTION: Record a horizontal line as drawn since the screen was
+ *                last shown, for latch-copy scrolling.
+ *   INPUTS: y -- logical row of the line
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+static void
+record_horiz_line (int y)
+{
+    if (n_dirty_y < SCROLL_Y_DIM)
+	dirty_y[n_dirty_y++] = y;
+    else
+	dirty_all = 1;
+}
+
+
+/*
+ * record_vert_line
+ *   DESCRIPTION: Record a vertical line as drawn since the screen was
+ *                last shown, for latch-copy scrolling.
+ *   INPUTS: x -- logical column of the line
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+static void
+record_vert_line (int x)
+{
+    if (n_dirty_x < SCROLL_X_DIM)
+	dirty_x[n_dirty_x++] = x;
+    else
+	dirty_all = 1;
+}
+
+
+/*
+ * scroll_view_to
+ *   DESCRIPTION: Move the logical view window, drawing the lines exposed
+ *                along both axes: first the rows exposed, across the full
+ *                width, and then the columns exposed, but only over the
+ *                rows that were already in view, so that no pixel in the
+ *                corner where the two strips cross is drawn twice.  If 
+ *                the cost model (see calibrate_scroll_costs) says that
+ *                the strips would cost at least as much as drawing the
+ *                whole view (which the caller may draw in parallel 
+ *                bands), draws nothing and leaves the whole view to the
+ *                caller.
+ *   INPUTS: (scr_x,scr_y) -- new upper left pixel of the view window
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if the view has been drawn, or 1 if the caller must
+ *                 draw the whole view
+ *   SIDE EFFECTS: changes the view window; draws into the build buffer
+ */   
+int
+scroll_view_to (int scr_x, int scr_y)
+{
+    int dx = scr_x - show_x;  /* columns moved right             */
+    int dy = scr_y - show_y;  /* rows moved down                 */
+    int ax = abs (dx);        /* columns exposed                 */
+    int ay = abs (dy);        /* rows exposed                    */
+    int c0, c1;               /* rows over which to draw columns */
+    int i;                    /* loop index over lines           */
+
+    set_view_window (scr_x, scr_y);
+    if (0 == ax && 0 == ay)
+	return 0;
+    if (SCROLL_X_DIM <= ax || SCROLL_Y_DIM <= ay ||
+	(unsigned long long)ay * scroll_costs.row_ns + 
+	(unsigned long long)ax * scroll_costs.col_ns >= 
+	scroll_costs.whole_ns) {
+	scroll_costs.redraws++;
+	return 1;
+    }
+    scroll_costs.strips++;
+
+    /* Draw the rows exposed, including the corner. */
+    for (i = 0; i < ay; i++)
+	(void)draw_horiz_line (0 < dy ? SCROLL_Y_DIM - 1 - i : i);
+
+    /* Draw the columns exposed over the remaining rows. */
+    c0 = (0 > dy ? ay : 0);
+    c1 = (0 < dy ? SCROLL_Y_DIM - ay : SCROLL_Y_DIM);
+    for (i = 0; i < ax; i++) {
+	record_vert_line ((0 < dx ? SCROLL_X_DIM - 1 - i : i) + show_x);
+	draw_column (0 < dx ? SCROLL_X_DIM - 1 - i : i, c0, c1 - c0);
+    }
+    return 0;
+}
+
+
+/*
+ * calibrate_scroll_costs
+ *   DESCRIPTION: Measure the costs used by scroll_view_to by drawing the
+ *                whole view twice, once as rows and once as columns, and
+ *                timing each.  An untimed pass first warms the caches,
+ *                as they are warm during play.  A whole view is taken to
+ *                cost as much as drawing whole_rows rows one after
+ *                another: SCROLL_Y_DIM if one thread draws it, but fewer
+ *                if several draw it in bands at once.  The view is left
+ *                fully drawn.
+ *   INPUTS: whole_rows -- rows drawn one after another by the thread
+ *                         that draws the most when drawing a whole view
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: draws the whole view into the build buffer
+ */   
+void
+calibrate_scroll_costs (int whole_rows)
+{
+    struct timespec t0, t1, t2; /* times around each pass */
+    int i;                      /* loop index over lines  */
+
+    for (i = 0; i < SCROLL_Y_DIM; i++)
+	(void)draw_horiz_line (i);
+    (void)clock_gettime (CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < SCROLL_Y_DIM; i++)
+	(void)draw_horiz_line (i);
+    (void)clock_gettime (CLOCK_MONOTONIC, &t1);
+    for (i = 0; i < SCROLL_X_DIM; i++)
+	(void)draw_vert_line (i);
+    (void)clock_gettime (CLOCK_MONOTONIC, &t2);
+
+    scroll_costs.row_ns = ((t1.tv_sec - t0.tv_sec) * 1000000000LL + 
+			   t1.tv_nsec - t0.tv_nsec) / SCROLL_Y_DIM + 1;
+    scroll_costs.col_ns = ((t2.tv_sec - t1.tv_sec) * 1000000000LL + 
+			   t2.tv_nsec - t1.tv_nsec) / SCROLL_X_DIM + 1;
+    scroll_costs.whole_ns = (unsigned long long)whole_rows * 
+			    scroll_costs.row_ns;
+    scroll_costs.calibrated = 1;
+}
+
+
+/*
+ * get_scroll_costs
+ *   DESCRIPTION: Get the cost model of scroll_view_to and the choices that
+ *                it has made.
+ *   INPUTS: none
+ *   OUTPUTS: costs -- the costs and counts
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+get_scroll_costs (scroll_costs_t* costs)
+{
+    *costs = scroll_costs;
+}
+
+#endif /* !defined(TEXT_RESTORE_PROGRAM) */
 
 
 /*
@@ -707,6 +1464,7 @@ draw_horiz_line (int y)
 static int
 open_memory_and_ports ()
 {
+#if !defined(VGA_EMULATOR)
     int mem_fd;  /* file descriptor for physical memory image */
 
     /* Obtain permission to access ports 0x03C0 through 0x03DA. */
@@ -731,6 +1489,11 @@ open_memory_and_ports ()
     /* Close /dev/mem file descriptor and return success. */
     (void)close (mem_fd);
     return 0;
+#else /* defined(VGA_EMULATOR) */
+    /* The model needs no permissions; just start from a clean state. */
+    vga_emu_reset ();
+    return 0;
+#endif /* !defined(VGA_EMULATOR) */
 }
 
 
@@ -751,6 +1514,7 @@ VGA_blank (int blank_bit)
      */
     blank_bit = ((blank_bit & 1) << 5);
 
+#if !defined(VGA_EMULATOR)
     asm volatile (
 	"movb $0x01,%%al         /* Set sequencer index to 1. */       ;"
 	"movw $0x03C4,%%dx                                             ;"
@@ -766,6 +1530,12 @@ VGA_blank (int blank_bit)
 	"movb $0x20,%%al                                               ;"
 	"outb %%al,(%%dx)                                               "
       : : "g" (blank_bit) : "eax", "edx", "memory");
+#else /* defined(VGA_EMULATOR) */
+    vga_emu_outb (0x03C4, 0x01);
+    vga_emu_outb (0x03C5, (vga_emu_inb (0x03C5) & 0xDF) | blank_bit);
+    (void)vga_emu_inb (0x03DA);
+    vga_emu_outb (0x03C0, 0x20);
+#endif /* !defined(VGA_EMULATOR) */
 }
 
 
@@ -833,9 +1603,13 @@ static void
 set_attr_registers (unsigned char table[NUM_ATTR_REGS * 2])
 {
     /* Reset attribute register to write index next rather than data. */
+#if !defined(VGA_EMULATOR)
     asm volatile (
 	"inb (%%dx),%%al"
       : : "d" (0x03DA) : "eax", "memory");
+#else
+    (void)vga_emu_inb (0x03DA);
+#endif
     REP_OUTSB (0x03C0, table, NUM_ATTR_REGS * 2);
 }
 
@@ -919,7 +1693,7 @@ fill_palette_mode_x ()
  *   RETURN VALUE: none
  *   SIDE EFFECTS: changes the palette color at index "index"
  */   
-void set_palette_color (unsigned char color[3], unsigned char index)
+void set_palette_color (const unsigned char color[3], unsigned char index)
 {
     /* Start writing at color index. */
     OUTB (0x03C8, index);
@@ -993,11 +1767,18 @@ write_font_data ()
     OUTW (0x3CE, 0x0204);
 
     /* Copy font data from array into video memory. */
+#if !defined(VGA_EMULATOR)
     for (i = 0, fonts = mem_image; i < 256; i++) {
 	for (j = 0; j < 16; j++)
 	    fonts[j] = font_data[i][j];
 	fonts += 32; /* skip 16 bytes between characters */
     }
+#else
+    (void)j;
+    (void)fonts;
+    for (i = 0; i < 256; i++)
+	vga_emu_write (i * 32, font_data[i], 16);
+#endif
 
     /* Prepare VGA for text mode. */
     OUTW (0x3C4, 0x0302);
@@ -1033,20 +1814,337 @@ set_text_mode_3 (int clear_scr)
     set_attr_registers (text_attr);              /* attribute registers     */
     set_graphics_registers (text_graphics);      /* graphics registers      */
     fill_palette_text ();			 /* palette colors          */
+#if !defined(VGA_EMULATOR)
     if (clear_scr) {				 /* clear screens if needed */
 	txt_scr = (unsigned long*)(mem_image + 0x18000); 
 	for (i = 0; i < 8192; i++)
 	    *txt_scr++ = 0x07200720;
     }
+#else
+    /* The text screen lies outside of the modeled memory window. */
+    (void)txt_scr;
+    (void)i;
+#endif
     write_font_data ();                          /* copy fonts to video mem */
     VGA_blank (0);			         /* unblank the screen      */
 }
 
 
+/*
+ * select_upload_kernel
+ *   DESCRIPTION: Time the available copy kernels on video memory and
+ *                use the fastest for copy_image and copy_status_bar.
+ *                Must be called while the screen is blanked and before
+ *                clear_screens, as the probe writes garbage into the
+ *                first display page.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: overwrites plane 0 of the first display page
+ */   
+static void
+select_upload_kernel ()
+{
+#if !defined(VGA_EMULATOR)
+    SET_WRITE_MASK (0x0100);
+    upload_fn = upload_kernel_fn 
+		    (upload_probe (mem_image + target_img, build, SCROLL_SIZE));
+#else
+    /* The model's planes are ordinary memory; time kernels on scratch. */
+    static unsigned char scratch[SCROLL_SIZE];
+
+    upload_fn = upload_kernel_fn (upload_probe (scratch, build, SCROLL_SIZE));
+    vga_emu_set_copy_fn (upload_fn);
+#endif
+}
+
+
+/*
+ * retrace_clock_ns
+ *   DESCRIPTION: Read the clock used to time retrace waits.  Under the
+ *                emulator, this is the model's (possibly simulated)
+ *                display clock.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: time in nanoseconds
+ *   SIDE EFFECTS: none
+ */   
+static unsigned long long
+retrace_clock_ns ()
+{
+#if !defined(VGA_EMULATOR)
+    struct timespec ts; /* current time */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    return vga_emu_now ();
+#endif
+}
+
+
+/*
+ * wait_for_retrace
+ *   DESCRIPTION: Wait for the start of the next vertical retrace by 
+ *                polling bit 3 of input status #1 (0x3DA).  If a retrace
+ *                is already in progress, it may be nearly over, so we
+ *                first wait for it to end.  Records when the retrace
+ *                began, from which retrace_since predicts the next.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates retrace wait statistics
+ */   
+static void
+wait_for_retrace ()
+{
+    unsigned long long start; /* time at which wait started */
+    unsigned long long wait;  /* length of wait             */
+    unsigned char status;     /* input status #1 value      */
+
+    start = retrace_clock_ns ();
+    do {
+        INB (0x03DA, status);
+    } while (0 != (status & 0x08));
+    do {
+        INB (0x03DA, status);
+    } while (0 == (status & 0x08));
+    retrace_ns = retrace_clock_ns ();
+    wait = retrace_ns - start;
+
+    if (0 == retrace_stats.waits || wait < retrace_stats.min_ns)
+        retrace_stats.min_ns = wait;
+    if (wait > retrace_stats.max_ns)
+        retrace_stats.max_ns = wait;
+    retrace_stats.total_ns += wait;
+    retrace_stats.waits++;
+}
+
+
+/*
+ * note_retrace
+ *   DESCRIPTION: Read input status #1 once, without waiting, and if the
+ *                display is in vertical retrace, take it as the last
+ *                retrace seen.  The retrace began up to SYNC_NS before,
+ *                so retraces predicted from it come late, never early.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: may move the retrace from which others are predicted
+ */   
+static void
+note_retrace ()
+{
+    unsigned char status; /* input status #1 value */
+
+    INB (0x03DA, status);
+    if (0 != (status & 0x08))
+	retrace_ns = retrace_clock_ns ();
+}
+
+
+/*
+ * retrace_since
+ *   DESCRIPTION: Tell whether a vertical retrace has surely begun since a
+ *                given time, counting FRAME_NS per frame (plus the
+ *                FRAME_SLACK allowance) from the last retrace seen, which
+ *                may be no older than ANCHOR_NS.
+ *   INPUTS: t -- the time (on retrace_clock_ns)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if a retrace has begun since t, or 0 if not (or if
+ *                 it cannot be told)
+ *   SIDE EFFECTS: none
+ */   
+static int
+retrace_since (unsigned long long t)
+{
+    unsigned long long now = retrace_clock_ns (); /* current time       */
+    unsigned long long k;  /* frames from the retrace seen to the next */
+
+    if (0 == retrace_ns || ANCHOR_NS < now - retrace_ns)
+	return 0;
+    if (t + SYNC_NS < retrace_ns)
+	return 1;
+    k = (t < retrace_ns ? 1 : (t - retrace_ns) / FRAME_NS + 1);
+    return (now >= retrace_ns + k * FRAME_NS + k * FRAME_NS / FRAME_SLACK);
+}
+
+
+/*
+ * scroll_with_latches
+ *   DESCRIPTION: Draw the new screen into video memory by moving the data
+ *                that it shares with the screen on display, then copying
+ *                only the remaining data from the build buffer.  In write
+ *                mode 1, each byte read from video memory loads the four
+ *                planes' bytes into the VGA latches, and each byte written
+ *                stores all four, so a retained row moves at four pixels
+ *                per byte without crossing the bus to system memory.
+ *
+ *                Because all four planes move together, the layout must
+ *                have moved horizontally by a multiple of four pixels
+ *                (always true with pixel panning); otherwise (or if no
+ *                screen is on display, or too many lines were drawn to
+ *                track), the function does nothing and returns 0.  
+ *                Retained rows and columns that were redrawn in the build
+ *                buffer since the last show are copied from the build 
+ *                buffer.
+ *   INPUTS: img -- build buffer image of each display plane
+ *           lx -- logical x of the pixels at display address 0
+ *           n -- bytes per row in each plane
+ *           src_img -- offset of the screen on display in video memory
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the screen was drawn, 0 if not
+ *   SIDE EFFECTS: writes target_img screen and the status bar in video
+ *                 memory; leaves write mode 0 selected
+ */   
+static int
+scroll_with_latches (unsigned char* img[4], int lx, int n, 
+		     unsigned short src_img)
+{
+    unsigned char keep[SCROLL_Y_DIM];     /* 1 for rows retained         */
+    unsigned char redo[SCROLL_X_DIM + 4]; /* 1 for columns from build    */
+    int dx, dy;           /* motion of layout in addresses and rows       */
+    int x0, x1;           /* range of retained addresses within a row     */
+    int r, x;             /* loop indices over rows and columns           */
+    int start;            /* start of a run of columns to copy            */
+    int i;                /* loop index over planes and drawn lines       */
+
+    /* Check that the screen on display can be moved into the new one. */
+    if (!shown_valid || dirty_all)
+	return 0;
+    dx = lx - shown_x;
+    dy = show_y - shown_y;
+    if (0 != (dx & 3) || dx <= -SCROLL_X_DIM || dx >= SCROLL_X_DIM ||
+	dy <= -SCROLL_Y_DIM || dy >= SCROLL_Y_DIM)
+	return 0;
+    dx /= 4;
+
+    /* Find rows retained from the display, less those drawn since. */
+    for (r = 0; r < SCROLL_Y_DIM; r++)
+	keep[r] = (r + dy >= 0 && r + dy < SCROLL_Y_DIM);
+    for (i = 0; i < n_dirty_y; i++) {
+	r = dirty_y[i] - show_y;
+	if (r >= 0 && r < SCROLL_Y_DIM)
+	    keep[r] = 0;
+    }
+
+    /* Find columns not retained from the display, plus those drawn. */
+    x0 = (dx < 0 ? -dx : 0);
+    x1 = (shown_n - dx < n ? shown_n - dx : n);
+    for (x = 0; x < 4 * n; x++)
+	redo[x] = ((x >> 2) < x0 || (x >> 2) >= x1);
+    for (i = 0; i < n_dirty_x; i++) {
+	x = dirty_x[i] - lx;
+	if (x >= 0 && x < 4 * n)
+	    redo[x] = 1;
+    }
+
+    /* Move the retained rows with latch copies in write mode 1. */
+    SET_WRITE_MASK (0x0F00);
+    OUTW (0x03CE, 0x4105);
+    for (r = 0; r < SCROLL_Y_DIM; r++) {
+	if (keep[r] && x0 < x1)
+	    latch_copy (target_img + r * vram_width + x0, 
+			src_img + (r + dy) * vram_width + x0 + dx, x1 - x0);
+    }
+    OUTW (0x03CE, 0x4005);
+
+    /* 
+     * Copy the other rows and columns from the build buffer.  Pixel x of
+     * a row is at address x / 4 of plane x % 4, so runs of columns to
+     * copy are found separately for each plane.
+     */
+    for (i = 0; i < 4; i++) {
+	SET_WRITE_MASK (1 << (i + 8));
+	for (r = 0; r < SCROLL_Y_DIM; r++) {
+	    if (!keep[r]) {
+		copy_image_part (img[i] + r * SCROLL_X_WIDTH,
+				 target_img + r * vram_width, n);
+		continue;
+	    }
+	    for (x = i; x < 4 * n; ) {
+		if (!redo[x]) {
+		    x += 4;
+		    continue;
+		}
+		for (start = x; x < 4 * n && redo[x]; x += 4);
+		copy_image_part (img[i] + r * SCROLL_X_WIDTH + (start >> 2),
+				 target_img + r * vram_width + (start >> 2),
+				 (x - start) >> 2);
+	    }
+	}
+	if (bar_upload)
+	    copy_status_bar (bar + (i * BAR_SIZE / 4));
+    }
+
+    return 1;
+}
+
+
+/*
+ * set_pixel_panning
+ *   DESCRIPTION: Write the attribute controller's horizontal pixel 
+ *                panning register (0x13).
+ *   INPUTS: val -- register value (twice the pixel shift in mode X)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: resets the attribute controller flip-flop to index
+ */   
+static void
+set_pixel_panning (unsigned char val)
+{
+    unsigned char junk; /* input status value (unused) */
+
+    /* Reading input status #1 makes the next attribute write an index. */
+    INB (0x03DA, junk);
+    (void)junk;
+
+    /* Keep the palette address source bit (0x20) set to keep the display. */
+    OUTB (0x03C0, 0x33);
+    OUTB (0x03C0, val);
+}
+
+
+/*
+ * latch_copy
+ *   DESCRIPTION: Copy bytes within video memory through the VGA latches.
+ *                Write mode 1 must be selected, and the map mask should 
+ *                enable all four planes, in which case each byte copied
+ *                moves four pixels.
+ *   INPUTS: dst -- destination offset in video memory
+ *           src -- source offset in video memory
+ *           n -- number of bytes (addresses) to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: loads the latches; writes video memory
+ */   
+static void
+latch_copy (unsigned short dst, unsigned short src, int n)
+{
+#if !defined(VGA_EMULATOR)
+    volatile unsigned char* vmem = mem_image; /* video memory window */
+    int i;                                    /* loop index          */
+
+    for (i = 0; i < n; i++)
+	vmem[dst + i] = vmem[src + i];
+#else
+    unsigned char ignored = 0; /* host data (unused in write mode 1) */
+    int i;                     /* loop index over bytes              */
+
+    for (i = 0; i < n; i++) {
+	(void)vga_emu_read (src + i);
+	vga_emu_write (dst + i, &ignored, 1);
+    }
+#endif
+    scroll_stats.latched += 4 * n;
+}
+
+
 /*
  * copy_image
  *   DESCRIPTION: Copy one plane of a screen from the build buffer to the 
- *                video memory.
+ *                video memory.  Only the SCROLL_SIZE bytes of the plane
+ *                that are displayed above the status bar are copied.
  *   INPUTS: img -- a pointer to a single screen plane in the build buffer
  *           scr_addr -- the destination offset in video memory
  *   OUTPUTS: none
@@ -1056,19 +2154,30 @@ set_text_mode_3 (int clear_scr)
 static void
 copy_image (unsigned char* img, unsigned short scr_addr)
 {
-    /* 
-     * memcpy is actually probably good enough here, and is usually
-     * implemented using ISA-specific features like those below,
-     * but the code here provides an example of x86 string moves
-     */
-    asm volatile (
-        "cld                                                 ;"
-       	"movl $16000,%%ecx                                   ;"
-       	"rep movsb    # copy ECX bytes from M[ESI] to M[EDI]  "
-      : /* no outputs */
-      : "S" (img), "D" (mem_image + scr_addr) 
-      : "eax", "ecx", "memory"
-    );
+    copy_image_part (img, scr_addr, SCROLL_SIZE);
+}
+
+
+/*
+ * copy_image_part
+ *   DESCRIPTION: Copy bytes of one plane of a screen from the build 
+ *                buffer to the video memory.
+ *   INPUTS: img -- a pointer to the first byte in the build buffer
+ *           scr_addr -- the destination offset in video memory
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: copies from the build buffer to video memory
+ */   
+static void
+copy_image_part (unsigned char* img, unsigned short scr_addr, int n)
+{
+#if !defined(VGA_EMULATOR)
+    (*upload_fn) (mem_image + scr_addr, img, n);
+#else
+    vga_emu_write (scr_addr, img, n);
+#endif
+    scroll_stats.uploaded += n;
 }
 
 /*
@@ -1082,43 +2191,72 @@ copy_image (unsigned char* img, unsigned short scr_addr)
 static void
 copy_status_bar (unsigned char* bar)
 {
-    /* 
-     * memcpy is actually probably good enough here, and is usually
-     * implemented using ISA-specific features like those below,
-     * but the code here provides an example of x86 string moves
-     */
-    asm volatile (
-        "cld                                                 ;"
-       	"movl $0x05A0,%%ecx                                   ;" // x5A0 = 18*320/4
-       	"rep movsb    # copy ECX bytes from M[ESI] to M[EDI]  "
-      : /* no outputs */
-      : "S" (bar), "D" (mem_image)
-      : "eax", "ecx", "memory"
-    );
+    int r; /* loop index over rows */
+
+    /* Rows are longer in video memory when pixel panning is used. */
+    if (IMAGE_X_WIDTH != vram_width) {
+	for (r = 0; r < BAR_SIZE / 4 / IMAGE_X_WIDTH; r++) {
+#if !defined(VGA_EMULATOR)
+	    (*upload_fn) (mem_image + r * vram_width, bar + r * IMAGE_X_WIDTH,
+			  IMAGE_X_WIDTH);
+#else
+	    vga_emu_write (r * vram_width, bar + r * IMAGE_X_WIDTH, 
+			   IMAGE_X_WIDTH);
+#endif
+	}
+	bar_stats.uploaded += BAR_SIZE / 4;
+	return;
+    }
+
+#if !defined(VGA_EMULATOR)
+    (*upload_fn) (mem_image, bar, BAR_SIZE / 4);
+#else
+    vga_emu_write (0, bar, BAR_SIZE / 4);
+#endif
+    bar_stats.uploaded += BAR_SIZE / 4;
 }
 
 
 /*
  * text_to_bar
- *   DESCRIPTION: write a string to the status bar
- *   INPUTS: str -- string to write to bar
+ *   DESCRIPTION: write a string to the status bar.  The bar image is
+ *                rendered again only if the text shown changes.
+ *   INPUTS: str -- string to write to bar (only the first BAR_CHARS
+ *                  characters are shown)
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: writes the string to the status bar
+ *   SIDE EFFECTS: writes the string to the status bar image; marks the
+ *                 bar for copying to video memory by show_screen
  */   
 void text_to_bar (const char * str){
-    char copy[41];
-    strcpy(copy,str);
-    char * curr = copy;
-    int i = 0;
-    while ((*curr)!='\0'){
-        i++;
-        curr++;
-    }
-    if (i <= 41){
-        copy[i] = 0;
-        bar = text_to_image(copy);
-    }
+    bar_stats.updates++;
+
+    /* Nothing to do if the bar already shows this text. */
+    if (bar && 0 == strncmp (str, bar_text, BAR_CHARS))
+        return;
+
+    strncpy (bar_text, str, BAR_CHARS);
+    bar_text[BAR_CHARS] = '\0';
+    text_to_planes (bar_text, bar_image);
+    bar = bar_image;
+    bar_upload = 1;
+    bar_stats.renders++;
+}
+
+
+/*
+ * get_bar_stats
+ *   DESCRIPTION: Get statistics on status bar rendering and copying.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+void
+get_bar_stats (bar_stats_t* stats)
+{
+    *stats = bar_stats;
+    stats->allocations = text_alloc_count ();
 }
 
 
@@ -1152,3 +2290,154 @@ main ()
 }
 
 #endif
+
+
+#if defined(UPLOAD_BENCH_PROGRAM)
+
+/*
+ * bench_fill_horiz, bench_fill_vert -- line callbacks for "upload-bench"
+ *   DESCRIPTION: Produce blank lines; set_mode_X requires callbacks, but
+ *                the benchmark never draws.
+ *   INPUTS: (x,y) -- ignored
+ *   OUTPUTS: buf -- filled with color 0
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+static void
+bench_fill_horiz (int x, int y, unsigned char buf[SCROLL_X_DIM])
+{
+    memset (buf, 0, SCROLL_X_DIM);
+}
+
+static void
+bench_fill_vert (int x, int y, unsigned char buf[SCROLL_Y_DIM])
+{
+    memset (buf, 0, SCROLL_Y_DIM);
+}
+
+
+/*
+ * main -- for the "upload-bench" program
+ *   DESCRIPTION: Enter mode X, which times every copy kernel on video
+ *                memory while the screen is blanked, return to text
+ *                mode, and report the rate of each kernel.
+ *   INPUTS: none (command line arguments are ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, 3 in panic scenarios
+ */   
+int
+main ()
+{
+    if (0 != set_mode_X (bench_fill_horiz, bench_fill_vert))
+        return 3;
+    clear_mode_X ();
+    upload_report (stdout);
+    return 0;
+}
+
+#endif /* defined(UPLOAD_BENCH_PROGRAM) */
+
+
+#if defined(FLIP_CHECK_PROGRAM)
+
+#define CHECK_SHOWS   20000  /* screens shown for each frame length      */
+#define CHECK_TICK_NS 1000     /* simulated time taken by each clock read  */
+
+static unsigned long long sim_ns; /* simulated time */
+
+
+/*
+ * check_clock -- simulated display clock for "flip-check"
+ *   DESCRIPTION: Advance the simulated time a little with each read, so
+ *                that polling for retrace comes to an end.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: simulated time in nanoseconds
+ *   SIDE EFFECTS: advances the simulated time
+ */   
+static uint64_t
+check_clock ()
+{
+    return (sim_ns += CHECK_TICK_NS);
+}
+
+
+/*
+ * check_fill_horiz, check_fill_vert -- line callbacks for "flip-check"
+ *   DESCRIPTION: Produce lines of a color that depends on the position,
+ *                so that scrolling changes the screen.
+ *   INPUTS: (x,y) -- logical position of the line
+ *   OUTPUTS: buf -- the line
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */   
+static void
+check_fill_horiz (int x, int y, unsigned char buf[SCROLL_X_DIM])
+{
+    memset (buf, y & 0xFF, SCROLL_X_DIM);
+}
+
+static void
+check_fill_vert (int x, int y, unsigned char buf[SCROLL_Y_DIM])
+{
+    memset (buf, x & 0xFF, SCROLL_Y_DIM);
+}
+
+
+/*
+ * main -- for the "flip-check" program
+ *   DESCRIPTION: Show screens with flips synchronized with retrace on
+ *                the VGA model, with simulated displays whose frames are
+ *                a little shorter than, as long as, and a little longer
+ *                than FRAME_NS (within FRAME_SLACK), spacing the screens
+ *                from well under a frame to more than one apart, and
+ *                check that no page is ever drawn into while the CRTC
+ *                is showing it.
+ *   INPUTS: none (command line arguments are ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if no page on display was drawn into, 1 if one was,
+ *                 3 in panic situations
+ */   
+int
+main ()
+{
+    static const uint64_t frame[3] = {
+	FRAME_NS - FRAME_NS / (2 * FRAME_SLACK), VGA_EMU_FRAME_NS,
+	FRAME_NS + FRAME_NS / (2 * FRAME_SLACK)
+    };
+    retrace_stats_t before, after; /* flips and waits for one display */
+    unsigned long writes;          /* writes into pages on display    */
+    unsigned long bad = 0;         /* ...for all frame lengths        */
+    int i, j;                      /* loop indices                    */
+
+    srand (1);
+    set_retrace_sync (1);
+    for (i = 0; i < 3; i++) {
+	sim_ns = 0;
+	vga_emu_set_clock (check_clock, frame[i]);
+	if (0 != set_mode_X (check_fill_horiz, check_fill_vert))
+	    return 3;
+	vga_emu_watch_display (1);
+	get_retrace_stats (&before);
+	for (j = 0; j < CHECK_SHOWS; j++) {
+	    (void)scroll_view_to (j % 64, (j / 64) % 64);
+	    show_screen ();
+	    sim_ns += 500000 + rand () % 20000000;
+	}
+	/* Text mode restores the font over the pages; stop watching first. */
+	writes = vga_emu_shown_writes ();
+	vga_emu_watch_display (0);
+	clear_mode_X ();
+	get_retrace_stats (&after);
+	printf ("frame %llu ns: %lu flips, %lu screens replaced, %lu waits; "
+		"%lu writes into a page on display\n",
+		(unsigned long long)frame[i], after.flips - before.flips,
+		after.replaced - before.replaced, after.waits - before.waits,
+		writes);
+	bad += writes;
+    }
+    vga_emu_set_clock (NULL, 0);
+    return (0 == bad ? 0 : 1);
+}
+
+#endif /* defined(FLIP_CHECK_PROGRAM) */
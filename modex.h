@@ -136,10 +136,136 @@ extern int draw_horiz_line (int y);
 /* draw a vertical line at horizontal pixel x within the logical view window */
 extern int draw_vert_line (int x);
 
+/* 
+ * draw n horizontal lines from pixel first within the logical view window
+ * without recording them as drawn; separate bands may be drawn by several
+ * threads at once
+ */
+extern int draw_horiz_band (int first, int n);
+
+/* record all lines of the logical view window as drawn (after bands) */
+extern void mark_view_drawn ();
+
+/* 
+ * move the logical view window, drawing the rows and columns exposed
+ * (each pixel once); returns 1 without drawing if the cost model says
+ * that drawing the whole view would be cheaper, or 0 if the view is drawn
+ */
+extern int scroll_view_to (int scr_x, int scr_y);
+
+/* cost model for scroll_view_to, and the choices that it has made */
+typedef struct {
+    unsigned int  row_ns;     /* time to draw one row (ns)               */
+    unsigned int  col_ns;     /* time to draw one column (ns)            */
+    unsigned long long whole_ns; /* time to draw a whole view (ns)       */
+    int           calibrated; /* costs measured (else pixel counts)      */
+    unsigned long strips;     /* moves drawn as exposed strips           */
+    unsigned long redraws;    /* moves left for a whole redraw           */
+} scroll_costs_t;
+
+/* 
+ * draw the whole logical view window by rows and again by columns,
+ * timing both to calibrate the cost model of scroll_view_to; a whole
+ * view costs as much as whole_rows rows (fewer than SCROLL_Y_DIM when
+ * it is drawn by several threads at once)
+ */
+extern void calibrate_scroll_costs (int whole_rows);
+
+/* get the cost model of scroll_view_to and counts of its choices */
+extern void get_scroll_costs (scroll_costs_t* costs);
+
+/* 
+ * statistics on page flips synchronized with vertical retrace, and on
+ * the (rare) waits for retrace when no page was free to draw into
+ */
+typedef struct {
+    unsigned long      flips;    /* page flips synchronized with retrace */
+    unsigned long      replaced; /* screens replaced before a flip       */
+    unsigned long      waits;    /* waits for retrace                    */
+    unsigned long long total_ns; /* total wait time                      */
+    unsigned long long min_ns;   /* shortest wait                        */
+    unsigned long long max_ns;   /* longest wait                         */
+} retrace_stats_t;
+
+/* 
+ * synchronize page flips in show_screen with vertical retrace if enable:
+ * a screen shown waits for a flip at most once a frame, and show_screen
+ * waits for retrace only when no page is free to draw into
+ */
+extern void set_retrace_sync (int enable);
+
+/* get statistics on retrace waits */
+extern void get_retrace_stats (retrace_stats_t* stats);
+
+/* statistics on video memory traffic for the scrolling region */
+typedef struct {
+    unsigned long      shows;       /* calls to show_screen              */
+    unsigned long      latch_shows; /* shows drawn with latch copies     */
+    unsigned long long uploaded;    /* bytes copied from the build buffer */
+    unsigned long long latched;     /* bytes moved within video memory   */
+} scroll_stats_t;
+
+/* 
+ * move data retained on screen within video memory when scrolling rather
+ * than copying it from the build buffer again if enable
+ */
+extern void set_latch_scroll (int enable);
+
+/* 
+ * use the pixel panning register for view x coordinates that are not 
+ * multiples of four if enable; must be called before set_mode_X
+ */
+extern void set_pixel_pan (int enable);
+
+/* get statistics on video memory traffic in show_screen */
+extern void get_scroll_stats (scroll_stats_t* stats);
+
+/* colors used to show frames on an ANSI terminal as well as the VGA */
+typedef enum {
+    TERM_OFF,           /* no terminal display                        */
+    TERM_256_COLOR,     /* xterm 256-color palette                    */
+    TERM_TRUE_COLOR     /* 24-bit color                               */
+} term_colors_t;
+
+/* statistics on frames shown on the terminal */
+typedef struct {
+    int                scale;   /* frame pixels per cell column (1-4)   */
+    int                cols;    /* cells per row                        */
+    int                rows;    /* rows of cells                        */
+    unsigned long      frames;  /* frames with any cell changed         */
+    unsigned long      limited; /* frames cut short by the byte budget  */
+    unsigned long long cells;   /* cells written                        */
+    unsigned long long bytes;   /* bytes written                        */
+    unsigned int       max_bytes; /* most bytes written for one frame   */
+} term_stats_t;
+
+/* 
+ * also show each frame, status bar included, on the ANSI terminal on
+ * stdout, in half-block cells, writing at most budget bytes per frame;
+ * must be called before set_mode_X; returns -1 if terminal display is
+ * not available (it needs the VGA emulator), or 0 on success
+ */
+extern int set_terminal_display (term_colors_t colors, unsigned int budget);
+
+/* get statistics on frames shown on the terminal */
+extern void get_terminal_stats (term_stats_t* stats);
+
+/* statistics on status bar rendering and copying */
+typedef struct {
+    unsigned long updates;     /* calls to text_to_bar                   */
+    unsigned long renders;     /* bar images rendered (text changed)     */
+    unsigned long uploads;     /* bar images copied to video memory      */
+    unsigned long allocations; /* image buffers allocated by text.c      */
+    unsigned long long uploaded; /* bytes copied to video memory         */
+} bar_stats_t;
+
+/* get statistics on status bar rendering and copying */
+extern void get_bar_stats (bar_stats_t* stats);
+
 // takes a string and writes it to the bar
 void text_to_bar (const char * str);
 
 // sets a palette color to RGB value color
-void set_palette_color (unsigned char color[3], unsigned char index);
+void set_palette_color (const unsigned char color[3], unsigned char index);
 
 #endif /* MODEX_H */
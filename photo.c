@@ -37,6 +37,7 @@
 
 
 #include <string.h>
+#include <unistd.h>
 
 #include "assert.h"
 #include "modex.h"
@@ -79,12 +80,14 @@ struct image_t {
 /* file-scope variables */
 
 /* 
- * The room currently shown on the screen.  This value is not known to 
- * the mode X code, but is needed when filling buffers in callbacks from 
- * that code (fill_horiz_buffer/fill_vert_buffer).  The value is set 
- * by calling prep_room.
+ * The scene (room photo and objects) currently shown on the screen.  This
+ * value is not known to the mode X code, but is needed when filling buffers
+ * in callbacks from that code (fill_horiz_buffer/fill_vert_buffer).  The
+ * value is set by calling prep_scene.  Scenes are snapshots taken by 
+ * get_room_scene, so the callbacks never look at the world itself, which
+ * may be changing in another thread.
  */
-static const room_t* cur_room = NULL; 
+static const scene_t* cur_scene = NULL; 
 
 
 /* 
@@ -106,7 +109,7 @@ void
 fill_horiz_buffer (int x, int y, unsigned char buf[SCROLL_X_DIM])
 {
     int            idx;   /* loop index over pixels in the line          */ 
-    object_t*      obj;   /* loop index over objects in the current room */
+    int            obj;   /* loop index over objects in the scene        */
     int            imgx;  /* loop index over pixels in object image      */ 
     int            yoff;  /* y offset into object image                  */ 
     uint8_t        pixel; /* pixel from object image                     */
@@ -115,8 +118,8 @@ fill_horiz_buffer (int x, int y, unsigned char buf[SCROLL_X_DIM])
     int32_t        obj_y; /* object y position                           */
     const image_t* img;   /* object image                                */
 
-    /* Get pointer to current photo of current room. */
-    view = room_photo (cur_room);
+    /* Get pointer to photo of current scene. */
+    view = cur_scene->view;
 
     /* Loop over pixels in line. */
     for (idx = 0; idx < SCROLL_X_DIM; idx++) {
@@ -124,12 +127,11 @@ fill_horiz_buffer (int x, int y, unsigned char buf[SCROLL_X_DIM])
 		    view->img[view->hdr.width * y + x + idx] : 0);
     }
 
-    /* Loop over objects in the current room. */
-    for (obj = room_contents_iterate (cur_room); NULL != obj;
-    	 obj = obj_next (obj)) {
-	obj_x = obj_get_x (obj);
-	obj_y = obj_get_y (obj);
-	img = obj_image (obj);
+    /* Loop over objects in the current scene. */
+    for (obj = 0; cur_scene->n_objs > obj; obj++) {
+	obj_x = cur_scene->obj[obj].x;
+	obj_y = cur_scene->obj[obj].y;
+	img = cur_scene->obj[obj].img;
 
         /* Is object outside of the line we're drawing? */
 	if (y < obj_y || y >= obj_y + img->hdr.height ||
@@ -184,7 +186,7 @@ void
 fill_vert_buffer (int x, int y, unsigned char buf[SCROLL_Y_DIM])
 {
     int            idx;   /* loop index over pixels in the line          */ 
-    object_t*      obj;   /* loop index over objects in the current room */
+    int            obj;   /* loop index over objects in the scene        */
     int            imgy;  /* loop index over pixels in object image      */ 
     int            xoff;  /* x offset into object image                  */ 
     uint8_t        pixel; /* pixel from object image                     */
@@ -193,8 +195,8 @@ fill_vert_buffer (int x, int y, unsigned char buf[SCROLL_Y_DIM])
     int32_t        obj_y; /* object y position                           */
     const image_t* img;   /* object image                                */
 
-    /* Get pointer to current photo of current room. */
-    view = room_photo (cur_room);
+    /* Get pointer to photo of current scene. */
+    view = cur_scene->view;
 
     /* Loop over pixels in line. */
     for (idx = 0; idx < SCROLL_Y_DIM; idx++) {
@@ -202,12 +204,11 @@ fill_vert_buffer (int x, int y, unsigned char buf[SCROLL_Y_DIM])
 		    view->img[view->hdr.width * (y + idx) + x] : 0);
     }
 
-    /* Loop over objects in the current room. */
-    for (obj = room_contents_iterate (cur_room); NULL != obj;
-    	 obj = obj_next (obj)) {
-	obj_x = obj_get_x (obj);
-	obj_y = obj_get_y (obj);
-	img = obj_image (obj);
+    /* Loop over objects in the current scene. */
+    for (obj = 0; cur_scene->n_objs > obj; obj++) {
+	obj_x = cur_scene->obj[obj].x;
+	obj_y = cur_scene->obj[obj].y;
+	img = cur_scene->obj[obj].img;
 
         /* Is object outside of the line we're drawing? */
 	if (x < obj_x || x >= obj_x + img->hdr.width ||
@@ -303,25 +304,182 @@ photo_width (const photo_t* p)
 
 
 /* 
- * prep_room
- *   DESCRIPTION: Prepare a new room for display.  You might want to set
- *                up the VGA palette registers according to the color
- *                palette that you chose for this room.
- *   INPUTS: r -- pointer to the new room
+ * touch_pages
+ *   DESCRIPTION: Read one byte from every page of a buffer, so that the
+ *                pages are mapped before they are needed.
+ *   INPUTS: buf -- the buffer
+ *           len -- length of the buffer in bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: len
+ *   SIDE EFFECTS: may fault pages in
+ */
+static size_t
+touch_pages (const uint8_t* buf, size_t len)
+{
+    const volatile uint8_t* v = buf;    /* reads cannot be dropped */
+    long page = sysconf (_SC_PAGESIZE); /* page size in bytes      */
+    size_t i;                           /* index over pages        */
+
+    for (i = 0; len > i; i += page) {
+	(void)v[i];
+    }
+    if (0 < len) {
+	(void)v[len - 1];
+    }
+    return len;
+}
+
+
+/* 
+ * prefault_image
+ *   DESCRIPTION: Fault in the pixel data of an object image.
+ *   INPUTS: im -- object image pointer
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes of pixel data touched
+ *   SIDE EFFECTS: may fault pages in
+ */
+size_t
+prefault_image (const image_t* im)
+{
+    return touch_pages (im->img, (size_t)im->hdr.width * im->hdr.height);
+}
+
+
+/* 
+ * prefault_photo
+ *   DESCRIPTION: Fault in the pixel data of a room photo.
+ *   INPUTS: p -- room photo pointer
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes of pixel data touched
+ *   SIDE EFFECTS: may fault pages in
+ */
+size_t
+prefault_photo (const photo_t* p)
+{
+    return touch_pages (p->img, (size_t)p->hdr.width * p->hdr.height);
+}
+
+
+/* 
+ * free_obj_image
+ *   DESCRIPTION: Free an object image read by read_obj_image.
+ *   INPUTS: im -- object image pointer (may be NULL)
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: changes recorded cur_room for this file
+ *   SIDE EFFECTS: frees the image
  */
 void
-prep_room (const room_t* r)
+free_obj_image (image_t* im)
 {
-    /* Record the current room. */
-    cur_room = r;
-	photo_t * photo = room_photo(r);
-	int i;
-	for (i = 0; i < 192; i++){
-		set_palette_color((photo->palette)[i],i+64);
+    if (NULL != im) {
+	free (im->img);
+	free (im);
+    }
+}
+
+
+/* 
+ * free_photo
+ *   DESCRIPTION: Free a room photo read by read_photo.
+ *   INPUTS: p -- room photo pointer (may be NULL)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frees the photo
+ */
+void
+free_photo (photo_t* p)
+{
+    if (NULL != p) {
+	free (p->img);
+	free (p);
+    }
+}
+
+
+/* 
+ * get_room_scene
+ *   DESCRIPTION: Record what a room looks like: its current photo and the
+ *                position and image of each object in it, in the order
+ *                in which they are drawn.  Objects beyond the first
+ *                MAX_SCENE_OBJECTS are left out.
+ *   INPUTS: r -- pointer to the room
+ *   OUTPUTS: s -- the scene
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+get_room_scene (const room_t* r, scene_t* s)
+{
+    const object_t* obj; /* loop index over objects in the room */
+
+    s->view = room_photo (r);
+    s->n_objs = 0;
+    for (obj = room_contents_iterate (r); NULL != obj && 
+	 MAX_SCENE_OBJECTS > s->n_objs; obj = obj_next (obj)) {
+	s->obj[s->n_objs].x = obj_get_x (obj);
+	s->obj[s->n_objs].y = obj_get_y (obj);
+	s->obj[s->n_objs].img = obj_image (obj);
+	s->n_objs++;
+    }
+}
+
+
+/* 
+ * prep_scene
+ *   DESCRIPTION: Prepare a scene for display: record it for use by the
+ *                line-filling callbacks and, for a newly entered room,
+ *                set up the VGA palette registers according to the
+ *                color palette chosen for the room photo.
+ *   INPUTS: s -- pointer to the scene (must remain valid while drawing)
+ *           palette -- non-zero to set the palette
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: changes recorded cur_scene for this file
+ */
+void
+prep_scene (const scene_t* s, int32_t palette)
+{
+    int i; /* index over photo colors */
+
+    /* Record the current scene. */
+    cur_scene = s;
+
+    /* Load the photo's colors into palette entries 64 to 255. */
+    if (palette) {
+	for (i = 0; i < 192; i++) {
+	    set_palette_color (s->view->palette[i], i + 64);
 	}
+    }
+}
+
+
+/* 
+ * read_photo_size
+ *   DESCRIPTION: Read the size of a room photo from the header of its
+ *                file, without reading its pixels.
+ *   INPUTS: fname -- file name for input
+ *   OUTPUTS: width -- width of the photo in pixels
+ *            height -- height of the photo in pixels
+ *   RETURN VALUE: 1 on success, or 0 if the file cannot be read or the
+ *                 photo is too large for read_photo
+ *   SIDE EFFECTS: none
+ */
+int32_t
+read_photo_size (const char* fname, uint32_t* width, uint32_t* height)
+{
+    FILE*          in;	/* input file      */
+    photo_header_t hdr;	/* the file header */
+    int32_t        ok;	/* header is good  */
+
+    if (NULL == (in = fopen (fname, "rb"))) {
+	return 0;
+    }
+    ok = (1 == fread (&hdr, sizeof (hdr), 1, in) &&
+	  MAX_PHOTO_WIDTH >= hdr.width && MAX_PHOTO_HEIGHT >= hdr.height);
+    (void)fclose (in);
+    *width = hdr.width;
+    *height = hdr.height;
+    return ok;
 }
 
 
@@ -548,7 +706,13 @@ read_photo (const char* fname)
 		}
 	}
 
-	rewind(in); // I think this resets the filestream pointer back to the start of the file
+	/* Go back to the first pixel (just past the header) for a second pass. */
+	if (0 != fseek (in, sizeof (p->hdr), SEEK_SET)) {
+		free (p->img);
+		free (p);
+		(void)fclose (in);
+		return NULL;
+	}
 
 	// writes image data of returned photo
 	for (y = p->hdr.height; y-- > 0; ) {
@@ -560,7 +724,7 @@ read_photo (const char* fname)
 					(void)fclose (in);
 				return NULL;
 			}
-			p->img[p->hdr.width * y + x-2] = determinePaletteValue(pixel,p->palette,octree4);
+			p->img[p->hdr.width * y + x] = determinePaletteValue(pixel,p->palette,octree4);
 		} 
     }
 
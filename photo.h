@@ -38,6 +38,7 @@
 #define PHOTO_H
 
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "types.h"
@@ -64,10 +65,23 @@ struct Node {
 };
 
 
-/* Fill a buffer with the pixels for a horizontal line of current room. */
+/* most objects drawn in one scene (the inventory can hold them all) */
+#define MAX_SCENE_OBJECTS 64
+
+/* a room as it is drawn: its photo and a snapshot of its objects */
+typedef struct {
+    const photo_t* view;            /* room photo                    */
+    int32_t        n_objs;          /* number of objects             */
+    struct {
+	int32_t        x, y;        /* position of object in photo   */
+	const image_t* img;         /* object image                  */
+    } obj[MAX_SCENE_OBJECTS];       /* objects, in drawing order     */
+} scene_t;
+
+/* Fill a buffer with the pixels for a horizontal line of current scene. */
 extern void fill_horiz_buffer (int x, int y, unsigned char buf[SCROLL_X_DIM]);
 
-/* Fill a buffer with the pixels for a vertical line of current room. */
+/* Fill a buffer with the pixels for a vertical line of current scene. */
 extern void fill_vert_buffer (int x, int y, unsigned char buf[SCROLL_Y_DIM]);
 
 /* Get height of object image in pixels. */
@@ -83,10 +97,20 @@ extern uint32_t photo_height (const photo_t* p);
 extern uint32_t photo_width (const photo_t* p);
 
 /* 
- * Prepare room for display (record pointer for use by callbacks, set up
- * VGA palette, etc.). 
+ * Read every page of an object image's or room photo's pixel data so that
+ * none is first touched while drawing.  Each returns the bytes touched.
+ */
+extern size_t prefault_image (const image_t* im);
+extern size_t prefault_photo (const photo_t* p);
+
+/* Record the photo and objects of a room as a scene for drawing later. */
+extern void get_room_scene (const room_t* r, scene_t* s);
+
+/* 
+ * Prepare scene for display (record pointer for use by callbacks and, if
+ * palette is non-zero, set up VGA palette). 
  */
-extern void prep_room (const room_t* r);
+extern void prep_scene (const scene_t* s, int32_t palette);
 
 /* Read object image from a file into a dynamically allocated structure. */
 extern image_t* read_obj_image (const char* fname);
@@ -94,6 +118,14 @@ extern image_t* read_obj_image (const char* fname);
 /* Read room photo from a file into a dynamically allocated structure. */
 extern photo_t* read_photo (const char* fname);
 
+/* Read the size of a room photo from its file; returns 0 on failure. */
+extern int32_t read_photo_size (const char* fname, uint32_t* width,
+				uint32_t* height);
+
+/* Free an object image or room photo (either may be NULL). */
+extern void free_obj_image (image_t* im);
+extern void free_photo (photo_t* p);
+
 /* compare function for qsort */
 int cmpfunc (const void * a, const void * b);
 
@@ -0,0 +1,215 @@
+/*									tab:8
+ *
+ * pool.c - the pool of drawing threads
+ *
+ * Filename:	    pool.c
+ * History:
+ *	1	First written.  A persistent pool of threads that share
+ *		the drawing of a whole view in row bands.
+ */
+
+#include <pthread.h>
+
+#include "pool.h"
+
+
+/*
+ * NOTES
+ *
+ * The workers are started once and then sleep until given a batch of
+ * jobs, so a batch costs a wake-up rather than a thread creation.  Every
+ * thread in a batch, including the caller, takes the next job number
+ * from a shared counter until none remain; a thread that finishes early
+ * simply takes more jobs, which balances bands that cost more to draw
+ * (those crossing objects, say) without any planning.
+ *
+ * The caller waits until every worker has checked out of the batch, not
+ * merely until the jobs are done, so that no worker can still be looking
+ * at the counter when the next batch resets it.
+ */
+
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cv = PTHREAD_COND_INITIALIZER; /* new batch   */
+static pthread_cond_t done_cv = PTHREAD_COND_INITIALIZER; /* batch done  */
+static pthread_t worker[POOL_MAX_THREADS]; /* the worker threads          */
+static int32_t n_workers = 0;       /* workers running                    */
+static int32_t stopping = 0;        /* workers should exit                */
+static uint32_t batch = 0;          /* number of the current batch        */
+static int32_t busy = 0;            /* workers yet to finish the batch    */
+static pool_fn_t job_fn;            /* job function for the batch         */
+static void* job_arg;               /* argument for job_fn                */
+static int32_t n_jobs;              /* jobs in the batch                  */
+static int32_t next_job;            /* next job to take (atomic access)   */
+
+
+/* local functions--see function headers for details */
+static void do_jobs (pool_fn_t fn, void* arg, int32_t n);
+static void* worker_thread (void* first);
+
+
+/*
+ * do_jobs
+ *   DESCRIPTION: Take and do jobs from the current batch until none remain.
+ *   INPUTS: fn, arg -- the batch's job function and its argument
+ *           n -- number of jobs in the batch
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: whatever the jobs do
+ */
+static void
+do_jobs (pool_fn_t fn, void* arg, int32_t n)
+{
+    int32_t job; /* job taken */
+
+    while (n > (job = __atomic_fetch_add (&next_job, 1, __ATOMIC_RELAXED))) {
+	fn (arg, job);
+    }
+}
+
+
+/*
+ * worker_thread
+ *   DESCRIPTION: Help with each batch of jobs, until told to stop.
+ *   INPUTS: first -- number of the batch before the first to help with
+ *                    (the thread may start after that batch has begun)
+ *   OUTPUTS: none
+ *   RETURN VALUE: NULL
+ *   SIDE EFFECTS: none
+ */
+static void*
+worker_thread (void* first)
+{
+    uint32_t seen = (uintptr_t)first; /* last batch joined  */
+    pool_fn_t fn;                     /* batch job function */
+    void* arg;                        /* argument for fn    */
+    int32_t n;                        /* jobs in batch      */
+
+    (void)pthread_mutex_lock (&pool_lock);
+    while (1) {
+	while (seen == batch && !stopping) {
+	    (void)pthread_cond_wait (&work_cv, &pool_lock);
+	}
+	if (stopping) {
+	    break;
+	}
+	seen = batch;
+	fn = job_fn;
+	arg = job_arg;
+	n = n_jobs;
+	(void)pthread_mutex_unlock (&pool_lock);
+
+	do_jobs (fn, arg, n);
+
+	(void)pthread_mutex_lock (&pool_lock);
+	if (0 == --busy) {
+	    (void)pthread_cond_signal (&done_cv);
+	}
+    }
+    (void)pthread_mutex_unlock (&pool_lock);
+    return NULL;
+}
+
+
+/*
+ * start_pool
+ *   DESCRIPTION: Start the worker threads.
+ *   INPUTS: n -- number of workers (limited to POOL_MAX_THREADS)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 if the workers cannot be started
+ *   SIDE EFFECTS: none
+ */
+int32_t
+start_pool (int32_t n)
+{
+    if (POOL_MAX_THREADS < n) {
+	n = POOL_MAX_THREADS;
+    }
+    stopping = 0;
+    for (n_workers = 0; n > n_workers; n_workers++) {
+	if (0 != pthread_create (&worker[n_workers], NULL, worker_thread,
+				 (void*)(uintptr_t)batch)) {
+	    stop_pool (NULL);
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+
+/*
+ * stop_pool
+ *   DESCRIPTION: Stop the worker threads.
+ *   INPUTS: ignore -- ignored (so that it may serve as a cleanup function)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: later batches are done by the caller alone
+ */
+void
+stop_pool (void* ignore)
+{
+    int32_t i; /* index over workers */
+
+    (void)pthread_mutex_lock (&pool_lock);
+    stopping = 1;
+    (void)pthread_cond_broadcast (&work_cv);
+    (void)pthread_mutex_unlock (&pool_lock);
+    for (i = 0; n_workers > i; i++) {
+	(void)pthread_join (worker[i], NULL);
+    }
+    n_workers = 0;
+}
+
+
+/*
+ * pool_size
+ *   DESCRIPTION: Get the number of worker threads.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: workers running
+ *   SIDE EFFECTS: none
+ */
+int32_t
+pool_size ()
+{
+    return n_workers;
+}
+
+
+/*
+ * run_in_pool
+ *   DESCRIPTION: Do a batch of jobs with the help of the workers.
+ *   INPUTS: fn -- job function, called as fn (arg, job)
+ *           arg -- argument for fn
+ *           n -- number of jobs
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: whatever the jobs do; all are done on return
+ */
+void
+run_in_pool (pool_fn_t fn, void* arg, int32_t n)
+{
+    if (0 == n_workers) {
+	__atomic_store_n (&next_job, 0, __ATOMIC_RELAXED);
+	do_jobs (fn, arg, n);
+	return;
+    }
+
+    (void)pthread_mutex_lock (&pool_lock);
+    job_fn = fn;
+    job_arg = arg;
+    n_jobs = n;
+    __atomic_store_n (&next_job, 0, __ATOMIC_RELAXED);
+    busy = n_workers;
+    batch++;
+    (void)pthread_cond_broadcast (&work_cv);
+    (void)pthread_mutex_unlock (&pool_lock);
+
+    do_jobs (fn, arg, n);
+
+    (void)pthread_mutex_lock (&pool_lock);
+    while (0 < busy) {
+	(void)pthread_cond_wait (&done_cv, &pool_lock);
+    }
+    (void)pthread_mutex_unlock (&pool_lock);
+}
@@ -0,0 +1,44 @@
+/*									tab:8
+ *
+ * pool.h - header file for the pool of drawing threads
+ *
+ * Filename:	    pool.h
+ * History:
+ *	1	First written.  A persistent pool of threads that share
+ *		the drawing of a whole view in row bands.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+
+#include <stdint.h>
+
+
+#define POOL_MAX_THREADS 7 /* most worker threads (the caller also works) */
+
+/* a job: fn (arg, job) for job from 0 to the number of jobs less one */
+typedef void (*pool_fn_t) (void* arg, int32_t job);
+
+/*
+ * Start n worker threads (at most POOL_MAX_THREADS; 0 starts none, and
+ * run_in_pool then does all of the jobs itself).  Returns 0 on success,
+ * or -1 if the threads cannot be started, in which case none run.
+ */
+extern int32_t start_pool (int32_t n);
+
+/* Stop the worker threads.  (Usable as a cleanup function.) */
+extern void stop_pool (void* ignore);
+
+/* Get the number of worker threads running. */
+extern int32_t pool_size (void);
+
+/*
+ * Do jobs 0 to n_jobs - 1 by calling fn (arg, job) for each, sharing the
+ * jobs between the calling thread and the workers, and return once all
+ * are done.  Jobs may run in any order and at the same time, so they must
+ * not write the same memory.  Only one thread may call at a time.
+ */
+extern void run_in_pool (pool_fn_t fn, void* arg, int32_t n_jobs);
+
+#endif /* POOL_H */
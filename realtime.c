@@ -0,0 +1,175 @@
+/*									tab:8
+ *
+ * realtime.c - the low-jitter real-time mode
+ *
+ * Filename:	    realtime.c
+ * History:
+ *	1	First written.  Real-time scheduling, CPU affinity, and
+ *		locked, pre-faulted memory for steady tick deadlines.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "realtime.h"
+#include "world.h"
+
+
+/*
+ * NOTES
+ *
+ * Ticks are missed for two reasons that have nothing to do with the work
+ * in a tick: the game is descheduled in favor of some other process, or
+ * it stops on a page fault.  SCHED_FIFO takes care of the first, since a
+ * real-time thread runs whenever it is ready, ahead of every ordinary
+ * process; pinning to chosen CPUs keeps the game away from CPUs busy with
+ * interrupts or other work, and keeps its caches warm.
+ *
+ * For the second, every room photo and object image is read through once
+ * and then all memory is locked, so that none of it is paged out later.
+ * Only memory mapped at that time is locked.  Locking future mappings
+ * too would populate the whole stack of every thread started later, and
+ * under a small RLIMIT_MEMLOCK would make starting those threads fail.
+ *
+ * Scheduling and affinity are set for the calling thread; the threads
+ * started afterward (drawing helpers, render thread, input) inherit both.
+ * All run at the same priority, so none can starve the game loop for
+ * longer than its own turn at the CPU.
+ */
+
+
+static realtime_stats_t rt_stats;  /* what was obtained            */
+static struct rusage start_usage;  /* resource usage at start      */
+
+
+/* local functions--see function headers for details */
+static int32_t parse_cpu_list (const char* s, cpu_set_t* set);
+
+
+/*
+ * parse_cpu_list
+ *   DESCRIPTION: Parse a list of CPU numbers and ranges, such as "0,2-3".
+ *   INPUTS: s -- the list
+ *   OUTPUTS: set -- the CPUs listed
+ *   RETURN VALUE: number of CPUs listed, or -1 if the list is malformed
+ *   SIDE EFFECTS: none
+ */
+static int32_t
+parse_cpu_list (const char* s, cpu_set_t* set)
+{
+    char* end;      /* end of a number       */
+    long  first;    /* first CPU in a range  */
+    long  last;     /* last CPU in a range   */
+
+    CPU_ZERO (set);
+    while (1) {
+	first = strtol (s, &end, 10);
+	if (end == s || 0 > first) {
+	    return -1;
+	}
+	last = first;
+	if ('-' == *end) {
+	    s = end + 1;
+	    last = strtol (s, &end, 10);
+	    if (end == s || first > last) {
+		return -1;
+	    }
+	}
+	if (CPU_SETSIZE <= last) {
+	    return -1;
+	}
+	for (; last >= first; first++) {
+	    CPU_SET (first, set);
+	}
+	if ('\0' == *end) {
+	    return CPU_COUNT (set);
+	}
+	if (',' != *end) {
+	    return -1;
+	}
+	s = end + 1;
+    }
+}
+
+
+/*
+ * start_realtime
+ *   DESCRIPTION: Set CPU affinity and real-time scheduling for the calling
+ *                thread, fault in the world's photos and images, and lock
+ *                memory.
+ *   INPUTS: priority -- SCHED_FIFO priority
+ *           cpus -- list of CPUs to run on, or NULL for any
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0, or -1 if cpus is malformed (nothing is changed)
+ *   SIDE EFFECTS: prints a warning for each step that fails
+ */
+int32_t
+start_realtime (int32_t priority, const char* cpus)
+{
+    cpu_set_t set;            /* CPUs allowed         */
+    struct sched_param param; /* scheduling priority  */
+    int32_t n_cpus = 0;       /* CPUs in set          */
+
+    (void)memset (&rt_stats, 0, sizeof (rt_stats));
+    if (NULL != cpus && 0 >= (n_cpus = parse_cpu_list (cpus, &set))) {
+	fprintf (stderr, "realtime: bad CPU list \"%s\"\n", cpus);
+	return -1;
+    }
+
+    if (0 < n_cpus) {
+	if (0 == sched_setaffinity (0, sizeof (set), &set)) {
+	    rt_stats.n_cpus = n_cpus;
+	} else {
+	    fprintf (stderr, "realtime: cannot set CPUs %s: %s\n", cpus,
+		     strerror (errno));
+	}
+    }
+
+    (void)memset (&param, 0, sizeof (param));
+    param.sched_priority = priority;
+    if (0 == sched_setscheduler (0, SCHED_FIFO, &param)) {
+	rt_stats.priority = priority;
+    } else {
+	fprintf (stderr, "realtime: cannot use SCHED_FIFO priority %d: %s\n",
+		 priority, strerror (errno));
+    }
+
+    rt_stats.prefaulted = prefault_world ();
+    if (0 == mlockall (MCL_CURRENT)) {
+	rt_stats.locked = 1;
+    } else {
+	fprintf (stderr, "realtime: cannot lock memory: %s\n",
+		 strerror (errno));
+    }
+
+    (void)getrusage (RUSAGE_SELF, &start_usage);
+    return 0;
+}
+
+
+/*
+ * get_realtime_stats
+ *   DESCRIPTION: Get what the real-time mode obtained and the page faults
+ *                taken since it started.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+get_realtime_stats (realtime_stats_t* stats)
+{
+    struct rusage now; /* resource usage now */
+
+    (void)getrusage (RUSAGE_SELF, &now);
+    *stats = rt_stats;
+    stats->minor_faults = now.ru_minflt - start_usage.ru_minflt;
+    stats->major_faults = now.ru_majflt - start_usage.ru_majflt;
+}
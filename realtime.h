@@ -0,0 +1,44 @@
+/*									tab:8
+ *
+ * realtime.h - header file for the low-jitter real-time mode
+ *
+ * Filename:	    realtime.h
+ * History:
+ *	1	First written.  Real-time scheduling, CPU affinity, and
+ *		locked, pre-faulted memory for steady tick deadlines.
+ */
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* what the real-time mode obtained, and page faults since */
+typedef struct {
+    int32_t priority;    /* SCHED_FIFO priority (0 if not obtained)   */
+    int32_t n_cpus;      /* CPUs allowed (0 if affinity not set)      */
+    int32_t locked;      /* memory locked                             */
+    size_t  prefaulted;  /* bytes of photos and images faulted in     */
+    long    minor_faults; /* faults served from memory since start    */
+    long    major_faults; /* faults needing I/O since start           */
+} realtime_stats_t;
+
+/*
+ * Enter the real-time mode: restrict the calling thread to the CPUs in
+ * cpus (a list such as "2,3" or "1-3"; NULL leaves affinity alone), run
+ * it under SCHED_FIFO at the given priority, fault in every room photo
+ * and object image, and lock all memory now mapped.  Call after
+ * build_world and before starting any other thread, so that the threads
+ * started later inherit the policy and the CPUs.  A step that the system
+ * refuses is reported on stderr and skipped.  Returns 0, or -1 if cpus
+ * cannot be parsed.
+ */
+extern int32_t start_realtime (int32_t priority, const char* cpus);
+
+/* Get what the real-time mode obtained and the page faults since. */
+extern void get_realtime_stats (realtime_stats_t* stats);
+
+#endif /* REALTIME_H */
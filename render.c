@@ -0,0 +1,495 @@
+/*									tab:8
+ *
+ * render.c - the render thread
+ *
+ * Filename:	    render.c
+ * History:
+ *	1	First written.  Frames are described by the game thread
+ *		and drawn and shown by a render thread.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "modex.h"
+#include "pool.h"
+#include "render.h"
+
+
+/*
+ * NOTES
+ *
+ * The game thread no longer draws.  Once per tick it describes the frame
+ * that it wants--the scene, the view window, the status bar text, and
+ * whether the whole view must be drawn--and hands the description to the
+ * render thread, which draws the view into the build buffer, writes the
+ * status bar, and shows the screen, waiting for retrace if asked.  A slow
+ * redraw or retrace wait thus delays only the next frame shown, never the
+ * handling of input.
+ *
+ * Descriptions are double-buffered: the renderer draws from one slot
+ * while the game thread fills the other.  If the game thread posts again
+ * before the renderer has taken the waiting frame, the new description
+ * replaces it, keeping its requests to draw the whole view, so that the
+ * renderer only ever draws the latest frame.
+ *
+ * The pixels themselves are not double-buffered.  The build buffer holds
+ * the view last drawn, and moving the view draws only the lines exposed
+ * (see scroll_view_to in modex.c), or the whole view if that is cheaper.
+ * Only one thread at a time may draw: the render thread once started,
+ * or otherwise (as in a benchmark) whoever posts.
+ *
+ * Drawing the whole view (on entering a room or after objects move) is
+ * split into DRAW_BANDS bands of rows, which are shared out among the
+ * drawing thread and the threads of the pool.  Each row is drawn by the
+ * same code into its own bytes of the build buffer, whichever thread
+ * draws it, so the result is identical to drawing the rows in order.
+ * The bands are fixed (not one per thread) so that threads finishing
+ * early can take more of them.
+ *
+ * Frames can be shown at their own rate, independent of the logic tick.
+ * At render_hz, the render thread wakes on its own timer and shows the
+ * latest frame, with the view window moved part of the way from the view
+ * last shown toward the frame's view, in proportion to the time since the
+ * frame was posted over the length of a logic tick.  At 60 Hz, a 20 Hz
+ * game thus scrolls in three steps per tick rather than one, at the cost
+ * of showing each view up to one tick later.  The game itself, and the
+ * frames that it posts, are unchanged, so replays still match.  A new
+ * room is never interpolated; neither is the last frame, which is shown
+ * exactly as posted when the render thread stops.  Each interpolated
+ * frame draws only the few lines exposed, well within the budget of a
+ * render period; draws that overrun it are counted, and the timer
+ * periods that they cause to be missed are skipped.
+ */
+
+
+#define DRAW_BANDS 13 /* bands of rows in a whole view (182 = 13 * 14) */
+
+
+/* frame descriptions, shared with the render thread under render_lock */
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_cv = PTHREAD_COND_INITIALIZER;
+static frame_t frames[2];          /* the two description slots           */
+static int32_t pending = -1;       /* slot posted and not yet taken, or -1 */
+static int32_t drawing = -1;       /* slot being drawn, or -1             */
+static int32_t stopping = 0;       /* render thread should exit when idle */
+static int32_t running = 0;        /* render thread has been started      */
+static pthread_t render_id;        /* the render thread                   */
+static render_stats_t render_stats;
+
+/* rate at which frames are shown (0 for each frame once, as posted) */
+static int32_t render_hz = 0;      /* frames shown per second             */
+static uint64_t tick_ns;           /* length of a logic tick              */
+static int timer_fd = -1;          /* render period timer                 */
+
+/* view currently in the build buffer (used only by the drawing thread) */
+static int32_t view_drawn = 0;     /* build buffer holds a view           */
+static int32_t drawn_x, drawn_y;   /* upper left pixel of the view drawn  */
+
+
+/* local functions--see function headers for details */
+static uint64_t now_ns (void);
+static void draw_band (void* ignore, int32_t band);
+static int32_t render_frame (const frame_t* f, int32_t x, int32_t y,
+			     int32_t fresh);
+static void* render_thread (void* ignore);
+static void* paced_render_thread (void* ignore);
+
+
+/*
+ * now_ns
+ *   DESCRIPTION: Read the monotonic clock.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: current time in nanoseconds
+ *   SIDE EFFECTS: none
+ */
+static uint64_t
+now_ns ()
+{
+    struct timespec t; /* current time */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * 1000000000ULL + t.tv_nsec);
+}
+
+
+/*
+ * draw_band
+ *   DESCRIPTION: Draw one band of rows of the view (a pool job).
+ *   INPUTS: ignore -- ignored
+ *           band -- the band (0 to DRAW_BANDS - 1)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: draws into the build buffer
+ */
+static void
+draw_band (void* ignore, int32_t band)
+{
+    int32_t first = band * SCROLL_Y_DIM / DRAW_BANDS;       /* first row */
+    int32_t end = (band + 1) * SCROLL_Y_DIM / DRAW_BANDS;   /* past last */
+
+    (void)draw_horiz_band (first, end - first);
+}
+
+
+/*
+ * render_frame
+ *   DESCRIPTION: Draw a frame into the build buffer and show it: the whole
+ *                view if the frame asks for it or it would cost less
+ *                than moving the view drawn last, and otherwise only the
+ *                lines exposed by moving the view.
+ *   INPUTS: f -- the frame (must remain valid until the next frame)
+ *           (x,y) -- upper left pixel of the view to show (the frame's
+ *                    view, or a view on the way to it)
+ *           fresh -- 1 if the frame has not been shown before, so that
+ *                    its requests to draw the whole view apply
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the whole view was drawn, 0 if not
+ *   SIDE EFFECTS: may change the palette; draws the view and status bar;
+ *                 shows the screen
+ */
+static int32_t
+render_frame (const frame_t* f, int32_t x, int32_t y, int32_t fresh)
+{
+    int32_t whole;                   /* drawing the whole view */
+
+    /* Adjust colors and photo drawing for the scene. */
+    prep_scene (&f->scene, fresh && f->new_room);
+
+    /* 
+     * Move the view, drawing only the lines exposed unless the whole
+     * view is wanted or would cost less (see calibrate_render).
+     */
+    whole = ((fresh && (f->new_room || f->redraw)) || !view_drawn);
+    if (whole) {
+	set_view_window (x, y);
+    } else {
+	whole = scroll_view_to (x, y);
+    }
+    if (whole) {
+	run_in_pool (draw_band, NULL, DRAW_BANDS);
+	mark_view_drawn ();
+    }
+    view_drawn = 1;
+    drawn_x = x;
+    drawn_y = y;
+
+    text_to_bar (f->bar);
+    show_screen ();
+    return whole;
+}
+
+
+/*
+ * render_thread
+ *   DESCRIPTION: Draw and show each frame posted, until told to stop.
+ *   INPUTS: ignore -- ignored
+ *   OUTPUTS: none
+ *   RETURN VALUE: NULL
+ *   SIDE EFFECTS: owns the build buffer and video memory while running
+ */
+static void*
+render_thread (void* ignore)
+{
+    uint64_t start; /* time at which drawing started */
+    int32_t whole;  /* the whole view was drawn      */
+
+    (void)pthread_mutex_lock (&render_lock);
+    while (1) {
+	if (-1 == pending) {
+	    if (stopping) {
+		break;
+	    }
+	    (void)pthread_cond_wait (&render_cv, &render_lock);
+	    continue;
+	}
+	drawing = pending;
+	pending = -1;
+	(void)pthread_mutex_unlock (&render_lock);
+
+	start = now_ns ();
+	whole = render_frame (&frames[drawing], frames[drawing].map_x,
+			      frames[drawing].map_y, 1);
+
+	(void)pthread_mutex_lock (&render_lock);
+	render_stats.shown++;
+	render_stats.redraws += whole;
+	hist_record (&render_stats.draw, now_ns () - start);
+	hist_record (&render_stats.latency, now_ns () -
+		     frames[drawing].posted_ns);
+	drawing = -1;
+    }
+    (void)pthread_mutex_unlock (&render_lock);
+    return NULL;
+}
+
+
+/*
+ * paced_render_thread
+ *   DESCRIPTION: Show the latest frame render_hz times per second, with
+ *                the view moved toward the frame's view over a logic tick,
+ *                until told to stop; then show the last frame as posted.
+ *   INPUTS: ignore -- ignored
+ *   OUTPUTS: none
+ *   RETURN VALUE: NULL
+ *   SIDE EFFECTS: owns the build buffer and video memory while running
+ */
+static void*
+paced_render_thread (void* ignore)
+{
+    const frame_t* f = NULL;  /* latest frame taken                 */
+    int32_t fresh = 0;        /* f has yet to be shown              */
+    int32_t from_x, from_y;   /* view shown when f was taken        */
+    int32_t x, y;             /* view to show                       */
+    int32_t done = 0;         /* showing the last frame             */
+    uint32_t shows = 0;       /* times f has been shown             */
+    uint64_t count;           /* timer expirations                  */
+    uint64_t since;           /* time since f was posted            */
+    uint64_t start;           /* time at which drawing started      */
+    uint64_t drew;            /* time taken to draw                 */
+    int32_t whole;            /* the whole view was drawn           */
+
+    while (!done) {
+	/* Wait for the next period; missed periods are skipped. */
+	if (sizeof (count) != read (timer_fd, &count, sizeof (count))) {
+	    if (EINTR == errno) {
+		continue;
+	    }
+	    count = 1;
+	}
+
+	(void)pthread_mutex_lock (&render_lock);
+	render_stats.skipped += count - 1;
+	if (-1 != pending) {
+	    if (NULL != f) {
+		hist_record (&render_stats.per_frame, shows);
+	    }
+	    drawing = pending;
+	    pending = -1;
+	    f = &frames[drawing];
+	    fresh = 1;
+	    shows = 0;
+	    from_x = drawn_x;
+	    from_y = drawn_y;
+	}
+	done = stopping;
+	(void)pthread_mutex_unlock (&render_lock);
+	if (NULL == f) {
+	    continue;
+	}
+
+	/* 
+	 * Move the view toward the frame's view.  A new room or a first
+	 * view jumps straight there, as does the last frame.
+	 */
+	start = now_ns ();
+	since = start - f->posted_ns;
+	if (done || tick_ns <= since || !view_drawn || 
+	    (fresh && f->new_room)) {
+	    x = f->map_x;
+	    y = f->map_y;
+	} else {
+	    x = from_x + (f->map_x - from_x) * (int64_t)since / 
+		(int64_t)tick_ns;
+	    y = from_y + (f->map_y - from_y) * (int64_t)since / 
+		(int64_t)tick_ns;
+	}
+	whole = render_frame (f, x, y, fresh);
+	drew = now_ns () - start;
+
+	(void)pthread_mutex_lock (&render_lock);
+	render_stats.shown++;
+	render_stats.redraws += whole;
+	render_stats.over_budget += (1000000000ULL / render_hz < drew);
+	hist_record (&render_stats.draw, drew);
+	if (fresh) {
+	    hist_record (&render_stats.latency, now_ns () - f->posted_ns);
+	}
+	(void)pthread_mutex_unlock (&render_lock);
+	fresh = 0;
+	shows++;
+    }
+    return NULL;
+}
+
+
+/*
+ * start_render_thread
+ *   DESCRIPTION: Start the render thread, which draws and shows the frames
+ *                posted from then on.
+ *   INPUTS: hz -- frames shown per second, or 0 to show each frame once,
+ *                 as soon as it is posted
+ *           tick_usec -- length of a logic tick, over which the view is
+ *                        moved from one frame's view to the next
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: only the render thread may draw while it runs
+ */
+int32_t
+start_render_thread (int32_t hz, long tick_usec)
+{
+    struct itimerspec period; /* render timer setting */
+
+    stopping = 0;
+    render_hz = hz;
+    tick_ns = tick_usec * 1000ULL;
+    if (0 == render_hz) {
+	if (0 != pthread_create (&render_id, NULL, render_thread, NULL)) {
+	    return -1;
+	}
+	running = 1;
+	return 0;
+    }
+
+    /* Start a timer that expires once per render period. */
+    if (-1 == (timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC))) {
+	return -1;
+    }
+    period.it_interval.tv_sec = 0;
+    period.it_interval.tv_nsec = 1000000000L / render_hz;
+    period.it_value = period.it_interval;
+    if (0 != timerfd_settime (timer_fd, 0, &period, NULL) ||
+	0 != pthread_create (&render_id, NULL, paced_render_thread, NULL)) {
+	(void)close (timer_fd);
+	timer_fd = -1;
+	return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+
+/*
+ * stop_render_thread
+ *   DESCRIPTION: Let the render thread show the last frame posted, then
+ *                stop it.  Does nothing if it is not running.
+ *   INPUTS: ignore -- ignored (so that it may serve as a cleanup function)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frames posted afterward are drawn by the caller
+ */
+void
+stop_render_thread (void* ignore)
+{
+    if (!running) {
+	return;
+    }
+    (void)pthread_mutex_lock (&render_lock);
+    stopping = 1;
+    (void)pthread_cond_signal (&render_cv);
+    (void)pthread_mutex_unlock (&render_lock);
+    (void)pthread_join (render_id, NULL);
+    running = 0;
+    if (-1 != timer_fd) {
+	(void)close (timer_fd);
+	timer_fd = -1;
+    }
+}
+
+
+/*
+ * calibrate_render
+ *   DESCRIPTION: Measure the costs that decide whether moving the view
+ *                draws the lines exposed or the whole view, drawing the
+ *                given room.  A whole view is drawn in DRAW_BANDS bands
+ *                shared among the drawing thread and the pool, so it
+ *                costs only the rows of the bands drawn by the thread
+ *                drawing the most.
+ *   INPUTS: r -- a room to draw (the first room shown, so that its
+ *                photo is in the caches afterward)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: sets up the palette; draws into the build buffer
+ */
+void
+calibrate_render (const room_t* r)
+{
+    static scene_t scene;   /* scene drawn (kept for the fill callbacks) */
+    int32_t threads = pool_size () + 1;                  /* drawing bands */
+    int32_t rounds = (DRAW_BANDS + threads - 1) / threads;  /* bands each */
+    int32_t rows = (SCROLL_Y_DIM + DRAW_BANDS - 1) / DRAW_BANDS; /* a band */
+
+    get_room_scene (r, &scene);
+    prep_scene (&scene, 1);
+    calibrate_scroll_costs (rounds * rows < SCROLL_Y_DIM ? 
+			    rounds * rows : SCROLL_Y_DIM);
+}
+
+
+/*
+ * post_frame
+ *   DESCRIPTION: Hand a frame to the render thread to be drawn and shown,
+ *                replacing any frame that it has yet to take.  Without a
+ *                render thread, draw and show the frame now.
+ *   INPUTS: f -- the frame (copied; posted_ns is ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: wakes the render thread
+ */
+void
+post_frame (const frame_t* f)
+{
+    uint64_t posted = now_ns (); /* time of handover            */
+    int32_t slot;                /* slot to fill                */
+    int32_t whole;               /* the whole view was drawn    */
+    int32_t new_room = 0;        /* requests of replaced frame  */
+    int32_t redraw = 0;
+
+    (void)pthread_mutex_lock (&render_lock);
+    render_stats.posted++;
+    if (!running) {
+	(void)pthread_mutex_unlock (&render_lock);
+	frames[0] = *f;
+	frames[0].posted_ns = posted;
+	whole = render_frame (&frames[0], frames[0].map_x, frames[0].map_y, 1);
+	(void)pthread_mutex_lock (&render_lock);
+	render_stats.shown++;
+	render_stats.redraws += whole;
+	hist_record (&render_stats.draw, now_ns () - posted);
+	hist_record (&render_stats.latency, now_ns () - posted);
+	(void)pthread_mutex_unlock (&render_lock);
+	return;
+    }
+
+    /*
+     * Fill the slot not being drawn.  A frame still waiting there is
+     * replaced, but its latency counts from when it was first posted.
+     */
+    if (-1 != pending) {
+	slot = pending;
+	render_stats.merged++;
+	new_room = frames[slot].new_room;
+	redraw = frames[slot].redraw;
+	posted = frames[slot].posted_ns;
+    } else {
+	slot = (0 == drawing ? 1 : 0);
+    }
+    frames[slot] = *f;
+    frames[slot].new_room |= new_room;
+    frames[slot].redraw |= redraw;
+    frames[slot].posted_ns = posted;
+    pending = slot;
+    (void)pthread_cond_signal (&render_cv);
+    (void)pthread_mutex_unlock (&render_lock);
+}
+
+
+/*
+ * get_render_stats
+ *   DESCRIPTION: Get statistics on the frames drawn.
+ *   INPUTS: none
+ *   OUTPUTS: stats -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+get_render_stats (render_stats_t* stats)
+{
+    (void)pthread_mutex_lock (&render_lock);
+    *stats = render_stats;
+    (void)pthread_mutex_unlock (&render_lock);
+}
@@ -0,0 +1,83 @@
+/*									tab:8
+ *
+ * render.h - header file for the render thread
+ *
+ * Filename:	    render.h
+ * History:
+ *	1	First written.  Frames are described by the game thread
+ *		and drawn and shown by a render thread.
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+
+#include <stdint.h>
+
+#include "hist.h"
+#include "photo.h"
+
+
+#define FRAME_BAR_LEN 40 /* characters on the status bar */
+
+/*
+ * Everything needed to draw and show one frame.  The renderer keeps the
+ * view last drawn in the build buffer, so moving the view only draws the
+ * lines exposed; new_room and redraw mark the whole view dirty.
+ */
+typedef struct {
+    scene_t  scene;                  /* room photo and objects        */
+    int32_t  map_x, map_y;           /* upper left pixel of view      */
+    int32_t  new_room;               /* room changed: set palette too */
+    int32_t  redraw;                 /* objects moved: draw all lines */
+    char     bar[FRAME_BAR_LEN + 1]; /* status bar text               */
+    uint64_t posted_ns;              /* time handed over (set by post) */
+} frame_t;
+
+/* statistics on frames drawn */
+typedef struct {
+    unsigned long posted;  /* frames handed to the renderer           */
+    unsigned long shown;   /* frames drawn and shown                  */
+    unsigned long merged;  /* frames replaced by a later one unshown  */
+    unsigned long redraws; /* frames with the whole view drawn        */
+    unsigned long over_budget; /* draws longer than a render period   */
+    unsigned long skipped; /* render periods missed by late draws     */
+    hist_t draw;           /* time to draw and show a frame (ns)      */
+    hist_t latency;        /* time from handover until first shown (ns) */
+    hist_t per_frame;      /* times each frame was shown (paced only)  */
+} render_stats_t;
+
+/*
+ * Start the render thread, which then owns the build buffer and video
+ * memory; call after set_mode_X.  With hz of 0, each frame is shown once,
+ * as soon as it is posted; otherwise frames are shown hz times a second,
+ * with the view moved toward each new frame's view over tick_usec.
+ * Returns 0 on success, -1 on failure.
+ */
+extern int32_t start_render_thread (int32_t hz, long tick_usec);
+
+/*
+ * Wait for the render thread to show the last frame posted, then stop
+ * it.  Does nothing if it is not running.  (Usable as a cleanup function.)
+ */
+extern void stop_render_thread (void* ignore);
+
+/*
+ * Measure the costs of moving the view by drawing room r, allowing for
+ * whole views being drawn in bands by the pool; call after set_mode_X and
+ * start_pool, and before the first frame is posted.
+ */
+extern void calibrate_render (const room_t* r);
+
+/*
+ * Hand a frame to the render thread, without waiting for it to be drawn.
+ * A frame not yet taken by the renderer is replaced (keeping its requests
+ * to redraw).  Without a render thread, draws and shows the frame before
+ * returning.
+ */
+extern void post_frame (const frame_t* f);
+
+/* Get statistics on frames drawn. */
+extern void get_render_stats (render_stats_t* stats);
+
+#endif /* RENDER_H */
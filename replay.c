@@ -0,0 +1,274 @@
+/*									tab:8
+ *
+ * replay.c - recording and replaying game input
+ *
+ * Filename:	    replay.c
+ * History:
+ *	1	First written.  Records the random seed and every command
+ *		with its tick so that a game can be replayed exactly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+
+
+/*
+ * NOTES
+ *
+ * Everything that changes the state of the game is either a command or a
+ * call to rand, and rand is only called while carrying out commands.  A
+ * recording of the seed and of each command, with the tick at which it
+ * was carried out, is thus enough to play the same game again.  The
+ * recording is a text file:
+ *
+ *     seed 1318612345
+ *     12 up
+ *     40 typed get pizza
+ *     97 quit
+ *
+ * Each command line gives the tick, the command name (see cmd_name), and,
+ * for typed commands, the typed text.  Blank lines and lines starting
+ * with '#' are ignored.
+ *
+ * Replay puts the commands back into the input queue at their ticks, so
+ * they are carried out by the same code as commands from the keyboard.
+ * Timed events such as status message expiry count the same ticks, so
+ * they happen at the same points in the game, too.
+ */
+
+
+/* names of commands in recordings, indexed by cmd_t */
+static const char* const cmd_name[NUM_COMMANDS] = {
+    "none", "right", "left", "up", "down",
+    "move-left", "enter", "move-right", "typed", "quit"
+};
+
+/* a recorded command */
+typedef struct {
+    unsigned long tick; /* tick at which the command was carried out */
+    cmd_t cmd;          /* the command                               */
+    char* typed;        /* typed command (CMD_TYPED only)            */
+} replay_cmd_t;
+
+static FILE* record_file = NULL;      /* recording in progress, if any */
+static replay_cmd_t* replay = NULL;   /* commands loaded for replay    */
+static int32_t replay_len = 0;        /* number of commands loaded     */
+static int32_t replay_next = 0;       /* next command to queue         */
+
+
+/*
+ * find_command
+ *   DESCRIPTION: Look up a command by the name used in recordings.
+ *   INPUTS: name -- the name
+ *   OUTPUTS: none
+ *   RETURN VALUE: the command, or NUM_COMMANDS if the name is unknown
+ *   SIDE EFFECTS: none
+ */
+cmd_t
+find_command (const char* name)
+{
+    cmd_t c; /* index over commands */
+
+    for (c = CMD_NONE + 1; NUM_COMMANDS > c; c++) {
+	if (0 == strcmp (name, cmd_name[c])) {
+	    break;
+	}
+    }
+    return c;
+}
+
+
+/*
+ * start_recording
+ *   DESCRIPTION: Create a recording and write the random seed to it.
+ *   INPUTS: fname -- name of the file
+ *           seed -- random seed used for the game
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: creates or replaces the file
+ */
+int32_t
+start_recording (const char* fname, unsigned int seed)
+{
+    if (NULL == (record_file = fopen (fname, "w"))) {
+	return -1;
+    }
+
+    /* Write each line as it is recorded, in case the game crashes. */
+    (void)setvbuf (record_file, NULL, _IOLBF, 0);
+    fprintf (record_file, "# adventure input recording\nseed %u\n", seed);
+    return 0;
+}
+
+
+/*
+ * record_command
+ *   DESCRIPTION: Record a command carried out at a given tick.
+ *   INPUTS: tick -- ticks executed before the command was carried out
+ *           cmd -- the command
+ *           typed -- the typed command (used for CMD_TYPED only)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes a line to the recording
+ */
+void
+record_command (unsigned long tick, cmd_t cmd, const char* typed)
+{
+    if (NULL == record_file || CMD_NONE == cmd || NUM_COMMANDS <= cmd) {
+	return;
+    }
+    if (CMD_TYPED == cmd) {
+	fprintf (record_file, "%lu %s %s\n", tick, cmd_name[cmd], typed);
+    } else {
+	fprintf (record_file, "%lu %s\n", tick, cmd_name[cmd]);
+    }
+}
+
+
+/*
+ * stop_recording
+ *   DESCRIPTION: Finish the recording, if any.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: closes the file
+ */
+void
+stop_recording ()
+{
+    if (NULL != record_file) {
+	(void)fclose (record_file);
+	record_file = NULL;
+    }
+}
+
+
+/*
+ * load_replay
+ *   DESCRIPTION: Read a recording to be replayed.
+ *   INPUTS: fname -- name of the file
+ *   OUTPUTS: seed -- random seed of the recorded game
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: allocates the recorded commands; prints a message to
+ *                 stderr on failure
+ */
+int32_t
+load_replay (const char* fname, unsigned int* seed)
+{
+    FILE* f;              /* the recording                 */
+    char line[200];       /* one line of the recording     */
+    int32_t lnum;         /* line number                   */
+    int32_t have_seed;    /* seed line has been read       */
+    unsigned long tick;   /* tick of command               */
+    unsigned long last;   /* tick of previous command      */
+    char name[20];        /* command name                  */
+    int32_t len;          /* characters parsed in line     */
+    char* text;           /* typed text                    */
+    replay_cmd_t* grown;  /* larger command array          */
+    int32_t cap;          /* size of command array         */
+    cmd_t c;              /* recorded command              */
+
+    if (NULL == (f = fopen (fname, "r"))) {
+	perror (fname);
+	return -1;
+    }
+    have_seed = 0;
+    last = 0;
+    cap = 0;
+    for (lnum = 1; NULL != fgets (line, sizeof (line), f); lnum++) {
+	line[strcspn (line, "\r\n")] = '\0';
+	if ('\0' == line[0] || '#' == line[0]) {
+	    continue;
+	}
+	if (!have_seed) {
+	    if (1 != sscanf (line, "seed %u", seed)) {
+		break;
+	    }
+	    have_seed = 1;
+	    continue;
+	}
+	if (2 != sscanf (line, "%lu %19s%n", &tick, name, &len) ||
+	    tick < last) {
+	    break;
+	}
+	if (NUM_COMMANDS == (c = find_command (name))) {
+	    break;
+	}
+	text = NULL;
+	if (CMD_TYPED == c) {
+	    if (' ' == line[len]) {
+		len++;
+	    }
+	    if (MAX_TYPED_LEN < strlen (&line[len]) ||
+		NULL == (text = strdup (&line[len]))) {
+		break;
+	    }
+	}
+	if (replay_len == cap) {
+	    cap = (0 == cap ? 256 : 2 * cap);
+	    if (NULL == (grown = realloc (replay, cap * sizeof (*replay)))) {
+		free (text);
+		break;
+	    }
+	    replay = grown;
+	}
+	replay[replay_len].tick = tick;
+	replay[replay_len].cmd = c;
+	replay[replay_len].typed = text;
+	replay_len++;
+	last = tick;
+    }
+    if (!feof (f) || !have_seed) {
+	fprintf (stderr, "%s:%d: bad recording\n", fname, lnum);
+	(void)fclose (f);
+	return -1;
+    }
+    (void)fclose (f);
+    replay_next = 0;
+    return 0;
+}
+
+
+/*
+ * replay_commands
+ *   DESCRIPTION: Queue the recorded commands for all ticks up to and
+ *                including a given tick.
+ *   INPUTS: tick -- ticks executed so far
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if recorded commands remain, 0 if all are queued
+ *   SIDE EFFECTS: adds commands to the input queue
+ */
+int32_t
+replay_commands (unsigned long tick)
+{
+    while (replay_len > replay_next && tick >= replay[replay_next].tick) {
+	queue_command (replay[replay_next].cmd, replay[replay_next].typed);
+	replay_next++;
+    }
+    return (replay_len > replay_next);
+}
+
+
+/*
+ * get_replay_command
+ *   DESCRIPTION: Get one of the commands loaded for replay, so that a
+ *                recording can be played without the input queue.
+ *   INPUTS: idx -- number of the command, from 0
+ *   OUTPUTS: cmd -- the command
+ *            typed -- the typed command (CMD_TYPED only; else NULL)
+ *   RETURN VALUE: 1 if there is such a command, or 0 if not
+ *   SIDE EFFECTS: none
+ */
+int32_t
+get_replay_command (int32_t idx, cmd_t* cmd, const char** typed)
+{
+    if (0 > idx || replay_len <= idx) {
+	return 0;
+    }
+    *cmd = replay[idx].cmd;
+    *typed = replay[idx].typed;
+    return 1;
+}
@@ -0,0 +1,61 @@
+/*									tab:8
+ *
+ * replay.h - header file for recording and replaying game input
+ *
+ * Filename:	    replay.h
+ * History:
+ *	1	First written.  Records the random seed and every command
+ *		with its tick so that a game can be replayed exactly.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+
+#include <stdint.h>
+
+#include "input.h"
+
+
+/*
+ * Look up a command by the name used in recordings ("up", "move-left",
+ * "typed", and so on); returns NUM_COMMANDS if the name is unknown.
+ */
+extern cmd_t find_command (const char* name);
+
+/*
+ * Start recording into a file, beginning with the random seed.  Returns
+ * 0 on success, or -1 (with errno set) on failure.
+ */
+extern int32_t start_recording (const char* fname, unsigned int seed);
+
+/*
+ * Record a command carried out at a tick; for CMD_TYPED, typed is the
+ * typed command handled.  Does nothing when not recording.
+ */
+extern void record_command (unsigned long tick, cmd_t cmd, const char* typed);
+
+/* Finish recording and close the file. */
+extern void stop_recording (void);
+
+/*
+ * Load a recording for replay, returning its random seed.  Returns 0 on
+ * success, or -1 on failure after printing a message.
+ */
+extern int32_t load_replay (const char* fname, unsigned int* seed);
+
+/*
+ * Add the recorded commands for all ticks up to and including tick to the
+ * input queue.  Returns 1 while recorded commands remain, or 0 once all
+ * have been queued.
+ */
+extern int32_t replay_commands (unsigned long tick);
+
+/*
+ * Get recorded command number idx (from 0), and for CMD_TYPED its typed
+ * text, without queueing it.  Returns 1, or 0 if there is no such command.
+ */
+extern int32_t get_replay_command (int32_t idx, cmd_t* cmd, 
+				   const char** typed);
+
+#endif /* REPLAY_H */
@@ -0,0 +1,330 @@
+/*									tab:8
+ *
+ * server.c - the pre-forking session server
+ *
+ * Filename:	    server.c
+ * History:
+ *	1	First written.  One process per game, forked from a
+ *		server that has already built the world.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "input.h"
+#include "server.h"
+#include "session.h"
+#include "world.h"
+
+
+/*
+ * NOTES
+ *
+ * Reading and quantizing every room photo and object image takes far
+ * longer than playing a move.  The server reads them all once (photos
+ * are otherwise read when first shown), faults them in, and then forks a
+ * child for each connection.  The children inherit the photos and images
+ * copy-on-write; since no game ever writes to them, the pages stay
+ * shared, and each child adds only its own session, stack, and stdio
+ * buffers.  A child reports its private and shared memory to the
+ * server's stderr when its game ends, which shows whether that still
+ * holds.
+ *
+ * Each child is an ordinary headless session (see session.h), with the
+ * connection as its stdin and stdout, so a client needs nothing more
+ * than "nc -U" or "socat".  Lines are read as commands: "left", "right",
+ * "enter", and "quit" stand for the buttons, and anything else is a
+ * typed command.  After each command the child writes the new status
+ * message, if any, and the player's room, if it changed.
+ *
+ * The server starts no threads, so forking copies all of its state
+ * safely.  Children are never waited for; SA_NOCLDWAIT keeps them from
+ * becoming zombies.
+ */
+
+
+/* local functions--see function headers for details */
+static uint64_t now_ns (void);
+static void remove_socket (void* path);
+static void read_memory (long* private_kb, long* shared_kb);
+static cmd_t parse_command (char* line, const char** typed);
+static void serve_session (int fd, unsigned int seed, unsigned long number,
+			   uint64_t accepted);
+
+
+/*
+ * now_ns
+ *   DESCRIPTION: Read the monotonic clock.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: current time in nanoseconds
+ *   SIDE EFFECTS: none
+ */
+static uint64_t
+now_ns ()
+{
+    struct timespec t; /* current time */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * 1000000000ULL + t.tv_nsec);
+}
+
+
+/*
+ * remove_socket
+ *   DESCRIPTION: Remove the server's socket (a cleanup function).
+ *   INPUTS: path -- path of the socket
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: unlinks the socket
+ */
+static void
+remove_socket (void* path)
+{
+    (void)unlink (path);
+}
+
+
+/*
+ * read_memory
+ *   DESCRIPTION: Get the resident memory of the calling process that is
+ *                private to it and that is shared with other processes.
+ *   INPUTS: none
+ *   OUTPUTS: private_kb -- private resident kilobytes (-1 if unknown)
+ *            shared_kb -- shared resident kilobytes (-1 if unknown)
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void
+read_memory (long* private_kb, long* shared_kb)
+{
+    FILE* f;       /* memory map summary of the process */
+    char line[80]; /* one line of the summary           */
+    char kind[20]; /* Private or Shared                 */
+    long kb;       /* kilobytes on line                 */
+
+    *private_kb = *shared_kb = -1;
+    if (NULL == (f = fopen ("/proc/self/smaps_rollup", "r"))) {
+	return;
+    }
+    *private_kb = *shared_kb = 0;
+    while (NULL != fgets (line, sizeof (line), f)) {
+	if (2 != sscanf (line, "%19[A-Za-z]_%*[A-Za-z]: %ld", kind, &kb)) {
+	    continue;
+	}
+	if (0 == strcmp (kind, "Private")) {
+	    *private_kb += kb;
+	} else if (0 == strcmp (kind, "Shared")) {
+	    *shared_kb += kb;
+	}
+    }
+    (void)fclose (f);
+}
+
+
+/*
+ * parse_command
+ *   DESCRIPTION: Turn a line sent by a client into a command.
+ *   INPUTS: line -- the line (without its newline)
+ *   OUTPUTS: typed -- the typed command (CMD_TYPED only)
+ *   RETURN VALUE: the command, or CMD_NONE for an empty line
+ *   SIDE EFFECTS: truncates line to the longest typed command
+ */
+static cmd_t
+parse_command (char* line, const char** typed)
+{
+    if ('\0' == *line) {
+	return CMD_NONE;
+    }
+    if (0 == strcmp (line, "left")) {
+	return CMD_MOVE_LEFT;
+    }
+    if (0 == strcmp (line, "enter")) {
+	return CMD_ENTER;
+    }
+    if (0 == strcmp (line, "right")) {
+	return CMD_MOVE_RIGHT;
+    }
+    if (0 == strcmp (line, "quit")) {
+	return CMD_QUIT;
+    }
+    if (MAX_TYPED_LEN < strlen (line)) {
+	line[MAX_TYPED_LEN] = '\0';
+    }
+    *typed = line;
+    return CMD_TYPED;
+}
+
+
+/*
+ * serve_session
+ *   DESCRIPTION: Play one game over a connection, in a forked child, and
+ *                report its start-up time and memory to stderr.
+ *   INPUTS: fd -- the connection
+ *           seed -- random seed for the game
+ *           number -- number of the game (from 0)
+ *           accepted -- time at which the connection was accepted
+ *   OUTPUTS: none
+ *   RETURN VALUE: does not return
+ *   SIDE EFFECTS: replaces stdin and stdout with the connection; exits
+ */
+static void
+serve_session (int fd, unsigned int seed, unsigned long number,
+	       uint64_t accepted)
+{
+    session_t* s;           /* the game                       */
+    double ready_ms;        /* time from accept to first move */
+    char line[256];         /* line sent by the client        */
+    char* end;              /* end of line                    */
+    cmd_t cmd;              /* command sent                   */
+    const char* typed;      /* typed command sent             */
+    const room_t* was;      /* room before the command        */
+    unsigned long messages; /* messages before the command    */
+    long private_kb;        /* memory private to the child    */
+    long shared_kb;         /* memory shared with the server  */
+
+    if (-1 == dup2 (fd, 0) || -1 == dup2 (fd, 1)) {
+	_exit (3);
+    }
+    (void)close (fd);
+    (void)signal (SIGPIPE, SIG_IGN);
+    if (NULL == (s = new_session (seed))) {
+	printf ("Out of memory.\n");
+	exit (3);
+    }
+    ready_ms = (now_ns () - accepted) / 1e6;
+
+    printf ("Game %lu.  Commands are left, right, enter, quit, or a verb "
+	    "and an object.\n", number);
+    printf ("You are in %s.\n> ", room_name (s->where));
+    (void)fflush (stdout);
+    while (!s->over && NULL != fgets (line, sizeof (line), stdin)) {
+	if (NULL != (end = strpbrk (line, "\r\n"))) {
+	    *end = '\0';
+	}
+	if (CMD_NONE != (cmd = parse_command (line, &typed))) {
+	    was = s->where;
+	    messages = s->messages;
+	    (void)session_command (s, cmd, typed);
+	    if (messages != s->messages) {
+		printf ("%s\n", s->status);
+	    }
+	    if (CMD_QUIT == cmd) {
+		printf ("Quitter!\n");
+	    } else if (NULL == s->where) {
+		printf ("You won!\n");
+	    } else if (was != s->where) {
+		printf ("You are in %s.\n", room_name (s->where));
+	    }
+	}
+	if (!s->over) {
+	    printf ("> ");
+	}
+	(void)fflush (stdout);
+    }
+
+    read_memory (&private_kb, &shared_kb);
+    fprintf (stderr, "server: game %lu (pid %d) ready in %.2f ms, played "
+	     "%lu commands; %ld kB private, %ld kB shared\n", number,
+	     (int)getpid (), ready_ms, s->commands, private_kb, shared_kb);
+    free_session (s);
+    exit (0);
+}
+
+
+/*
+ * run_server
+ *   DESCRIPTION: Serve games on a Unix domain socket, forking a child to
+ *                play each connection's game.
+ *   INPUTS: path -- path of the socket
+ *           seed -- random seed for the first game
+ *   OUTPUTS: none
+ *   RETURN VALUE: -1 if the socket cannot be set up or accept fails;
+ *                 otherwise does not return
+ *   SIDE EFFECTS: creates the socket (removed on SIGINT); prints progress
+ *                 to stderr
+ */
+int32_t
+run_server (const char* path, unsigned int seed)
+{
+    struct sockaddr_un addr; /* address of the socket          */
+    struct sigaction sa;     /* reaping of finished children   */
+    struct stat st;          /* existing file at path          */
+    int sock;                /* listening socket               */
+    int fd;                  /* accepted connection            */
+    unsigned long number;    /* number of the next game        */
+    uint64_t accepted;       /* time at which fd was accepted  */
+    pid_t pid;               /* child playing the game         */
+
+    (void)memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    if (sizeof (addr.sun_path) <= strlen (path)) {
+	fprintf (stderr, "server: socket path too long\n");
+	return -1;
+    }
+    (void)strcpy (addr.sun_path, path);
+
+    /* Replace a socket left by an earlier server, but nothing else. */
+    if (0 == lstat (path, &st) && S_ISSOCK (st.st_mode)) {
+	(void)unlink (path);
+    }
+
+    sa.sa_handler = SIG_DFL;
+    sa.sa_flags = SA_NOCLDWAIT;
+    (void)sigemptyset (&sa.sa_mask);
+    if (-1 == sigaction (SIGCHLD, &sa, NULL) ||
+	-1 == (sock = socket (AF_UNIX, SOCK_STREAM, 0))) {
+	perror ("server");
+	return -1;
+    }
+    if (-1 == bind (sock, (struct sockaddr*)&addr, sizeof (addr))) {
+	perror (path);
+	(void)close (sock);
+	return -1;
+    }
+
+    push_cleanup (remove_socket, (void*)path); {
+
+	if (-1 == listen (sock, SOMAXCONN)) {
+	    perror (path);
+	} else {
+	    fprintf (stderr, "server: listening on %s; each game shares %zu "
+		     "bytes of photos and images\n", path, prefault_world ());
+	    for (number = 0; 1; ) {
+		if (-1 == (fd = accept (sock, NULL, NULL))) {
+		    if (EINTR == errno) {
+			continue;
+		    }
+		    perror ("server: accept");
+		    break;
+		}
+		accepted = now_ns ();
+		if (0 == (pid = fork ())) {
+		    /* The child must not remove the server's socket. */
+		    pop_cleanup (0);
+		    (void)close (sock);
+		    serve_session (fd, seed + number, number, accepted);
+		}
+		if (-1 == pid) {
+		    perror ("server: fork");
+		} else {
+		    number++;
+		}
+		(void)close (fd);
+	    }
+	}
+	(void)close (sock);
+
+    } pop_cleanup (1);
+
+    return -1;
+}
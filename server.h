@@ -0,0 +1,27 @@
+/*									tab:8
+ *
+ * server.h - header file for the pre-forking session server
+ *
+ * Filename:	    server.h
+ * History:
+ *	1	First written.  One process per game, forked from a
+ *		server that has already built the world.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+
+#include <stdint.h>
+
+
+/*
+ * Serve games on a Unix domain socket at path, forking a child with its
+ * own session for each connection; the connection becomes the child's
+ * stdin and stdout.  Game n (from 0) is played with seed + n.  Call
+ * after build_world and before starting any thread.  Runs until killed;
+ * returns -1 if the socket cannot be set up or accept fails.
+ */
+extern int32_t run_server (const char* path, unsigned int seed);
+
+#endif /* SERVER_H */
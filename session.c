@@ -0,0 +1,151 @@
+/*									tab:8
+ *
+ * session.c - headless game sessions
+ *
+ * Filename:	    session.c
+ * History:
+ *	1	First written.  Games played without a screen, any number
+ *		to a process, each with its own world.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "session.h"
+#include "world.h"
+
+
+/*
+ * NOTES
+ *
+ * A session holds everything that one game changes: its world (rooms,
+ * objects, flags, photo swaps, and random numbers) and the player's room
+ * and messages.  Nothing that a session changes is shared, so sessions
+ * need no locks; any number may be played by one thread, taking turns,
+ * or by many threads, one session each at a time.
+ *
+ * The view and the status bar belong to the screen, not to the game, so
+ * a session has neither.  Scrolling commands do nothing, and the last
+ * status message is kept rather than shown.
+ */
+
+
+/* local functions--see function headers for details */
+static void keep_status (void* arg, const char* msg);
+
+
+/*
+ * keep_status
+ *   DESCRIPTION: Keep a status message for a session (the world's status
+ *                function).
+ *   INPUTS: arg -- the session
+ *           msg -- the message
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: replaces the session's last message
+ */
+static void
+keep_status (void* arg, const char* msg)
+{
+    session_t* s = arg; /* the session */
+
+    (void)strncpy (s->status, msg, STATUS_MSG_LEN);
+    s->status[STATUS_MSG_LEN] = '\0';
+    s->messages++;
+}
+
+
+/*
+ * new_session
+ *   DESCRIPTION: Start a headless game.
+ *   INPUTS: seed -- random seed for the game
+ *   OUTPUTS: none
+ *   RETURN VALUE: the session, or NULL if memory runs out
+ *   SIDE EFFECTS: dynamically allocates the session and its world
+ */
+session_t*
+new_session (unsigned int seed)
+{
+    session_t* s; /* the new session */
+
+    if (NULL == (s = calloc (1, sizeof (*s)))) {
+	return NULL;
+    }
+    if (NULL == (s->world = new_world (seed, keep_status, s))) {
+	free (s);
+	return NULL;
+    }
+    s->where = start_in_room (s->world);
+    return s;
+}
+
+
+/*
+ * free_session
+ *   DESCRIPTION: End a headless game.
+ *   INPUTS: s -- the session (may be NULL)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frees the session and its world
+ */
+void
+free_session (session_t* s)
+{
+    if (NULL != s) {
+	free_world (s->world);
+	free (s);
+    }
+}
+
+
+/*
+ * session_command
+ *   DESCRIPTION: Carry out a command in a headless game.
+ *   INPUTS: s -- the session
+ *           cmd -- the command
+ *           typed -- the typed command (CMD_TYPED only)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the game is over, 0 if not
+ *   SIDE EFFECTS: plays the game
+ */
+int32_t
+session_command (session_t* s, cmd_t cmd, const char* typed)
+{
+    cmd_id_t verb; /* command for typed verb (ignored) */
+
+    if (s->over) {
+	return 1;
+    }
+    s->commands++;
+    switch (cmd) {
+	case CMD_MOVE_LEFT:  (void)try_to_move_left (&s->where);  break;
+	case CMD_ENTER:      (void)try_to_enter (&s->where);      break;
+	case CMD_MOVE_RIGHT: (void)try_to_move_right (&s->where); break;
+	case CMD_TYPED:
+	    (void)typed_command (&s->where, typed, &verb);
+	    break;
+	case CMD_QUIT: s->over = 1; break;
+	default: break;
+    }
+
+    /* If the player wins the game, their room becomes NULL. */
+    if (NULL == s->where) {
+	s->over = 1;
+    }
+    return s->over;
+}
+
+
+/*
+ * session_size
+ *   DESCRIPTION: Get the memory used by each session.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes allocated for one session and its world
+ *   SIDE EFFECTS: none
+ */
+size_t
+session_size ()
+{
+    return sizeof (session_t) + world_size ();
+}
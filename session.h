@@ -0,0 +1,56 @@
+/*									tab:8
+ *
+ * session.h - header file for headless game sessions
+ *
+ * Filename:	    session.h
+ * History:
+ *	1	First written.  Games played without a screen, any number
+ *		to a process, each with its own world.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "input.h"
+#include "status.h"
+#include "types.h"
+
+
+/*
+ * A game played without a screen, by a bot, a test, or a replay.  All of
+ * its state is here and in its world; the photos and images are shared
+ * with every other session.
+ */
+typedef struct {
+    world_t*      world;    /* the game's world                       */
+    room_t*       where;    /* player's room (NULL once the game won) */
+    int32_t       over;     /* game won or quit                       */
+    unsigned long commands; /* commands carried out                   */
+    unsigned long messages; /* status messages shown                  */
+    char          status[STATUS_MSG_LEN + 1]; /* last status message  */
+} session_t;
+
+/*
+ * Start a session, with its game played as rand would after srand (seed).
+ * Call after build_world.  Returns NULL if memory runs out.
+ */
+extern session_t* new_session (unsigned int seed);
+
+/* End a session, freeing it and its world. */
+extern void free_session (session_t* s);
+
+/*
+ * Carry out a command; for CMD_TYPED, typed is the typed command.  View
+ * scrolling commands do nothing, as there is no view.  Returns 1 once
+ * the game is over (won or quit), or 0 while it goes on.
+ */
+extern int32_t session_command (session_t* s, cmd_t cmd, const char* typed);
+
+/* Get the bytes of memory allocated for each session, with its world. */
+extern size_t session_size (void);
+
+#endif /* SESSION_H */
@@ -0,0 +1,334 @@
+/*									tab:8
+ *
+ * status.c - the published status message
+ *
+ * Filename:	    status.c
+ * History:
+ *	1	First written.  The status message is published through
+ *		a sequence lock so that readers never take a lock.
+ */
+
+#include <sched.h>
+#include <string.h>
+
+#include "status.h"
+
+
+/*
+ * NOTES
+ *
+ * The message is protected by a sequence lock.  A writer makes the
+ * sequence number odd, stores the text, and makes it even again; a
+ * reader copies the text between two reads of the sequence number and
+ * keeps the copy only if both found the same even number, since no
+ * write can then have overlapped the copy.  Writers exclude each other
+ * by the compare-and-swap that makes the number odd.  Readers take no
+ * lock, but a reader that finds a write in progress retries until it
+ * ends, so readers do wait for writers--and would wait forever for one
+ * stuck in the middle of a write.  Writes only copy a few words, and in
+ * the game they are made only by the game thread (commands and the timer
+ * that clears the message), which is also the thread that reads the
+ * message for the status bar, so the wait is short when it happens at
+ * all.
+ *
+ * Each write adds 2 to the sequence number, so half of it serves as a
+ * generation count: a reader can tell whether the message has changed
+ * since it last looked without copying anything.
+ *
+ * The text is kept in 64-bit words loaded and stored atomically (but
+ * without ordering) so that a copy overlapping a write is merely
+ * discarded, rather than a data race.
+ */
+
+
+#define STATUS_WORDS ((STATUS_MSG_LEN + 8) / 8) /* words of text, with NUL */
+
+static uint32_t status_seq = 0;             /* odd while being written */
+static uint64_t status_text[STATUS_WORDS];  /* the message             */
+
+
+/* local functions--see function headers for details */
+static void write_text (uint32_t seq, const char* msg);
+
+
+/*
+ * write_text
+ *   DESCRIPTION: Store a new message and release the sequence lock.
+ *   INPUTS: seq -- the (even) sequence number before the lock was taken
+ *           msg -- the message
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: publishes the message with the next generation
+ */
+static void
+write_text (uint32_t seq, const char* msg)
+{
+    uint64_t text[STATUS_WORDS]; /* message padded with NULs */
+    int32_t  i;                  /* index over words         */
+
+    (void)memset (text, 0, sizeof (text));
+    (void)strncpy ((char*)text, msg, STATUS_MSG_LEN);
+
+    /* Order the stores to the text after the sequence number goes odd. */
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    for (i = 0; STATUS_WORDS > i; i++) {
+	__atomic_store_n (&status_text[i], text[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n (&status_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * status_publish
+ *   DESCRIPTION: Replace the status message.
+ *   INPUTS: msg -- the new message
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: waits for any other writer to finish
+ */
+void
+status_publish (const char* msg)
+{
+    uint32_t seq; /* sequence number when the lock was taken */
+
+    seq = __atomic_load_n (&status_seq, __ATOMIC_RELAXED);
+    while (1) {
+	if (0 == (seq & 1) &&
+	    __atomic_compare_exchange_n (&status_seq, &seq, seq + 1, 1,
+					 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+	    break;
+	}
+
+	/* Another writer holds the lock; let it finish. */
+	if (0 != (seq & 1)) {
+	    (void)sched_yield ();
+	    seq = __atomic_load_n (&status_seq, __ATOMIC_RELAXED);
+	}
+    }
+    write_text (seq, msg);
+}
+
+
+/*
+ * status_clear_if
+ *   DESCRIPTION: Clear the status message if it has not changed since a
+ *                given generation.
+ *   INPUTS: gen -- the generation of the message to be cleared
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the message was cleared, 0 if not
+ *   SIDE EFFECTS: publishes an empty message if successful
+ */
+int32_t
+status_clear_if (uint32_t gen)
+{
+    uint32_t seq = gen * 2; /* sequence number of that generation */
+
+    /* If a writer is busy, the message is changing anyway. */
+    if (!__atomic_compare_exchange_n (&status_seq, &seq, seq + 1, 0,
+				      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+	return 0;
+    }
+    write_text (seq, "");
+    return 1;
+}
+
+
+/*
+ * status_generation
+ *   DESCRIPTION: Get the generation of the status message.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the generation (of the last message completely written)
+ *   SIDE EFFECTS: none
+ */
+uint32_t
+status_generation ()
+{
+    return (__atomic_load_n (&status_seq, __ATOMIC_ACQUIRE) / 2);
+}
+
+
+/*
+ * status_read
+ *   DESCRIPTION: Copy the status message.
+ *   INPUTS: none
+ *   OUTPUTS: buf -- the message (STATUS_MSG_LEN + 1 bytes)
+ *   RETURN VALUE: the generation of the message copied
+ *   SIDE EFFECTS: none
+ */
+uint32_t
+status_read (char* buf)
+{
+    uint64_t text[STATUS_WORDS]; /* copy of the message          */
+    uint32_t seq;                /* sequence number before copy  */
+    int32_t  i;                  /* index over words             */
+
+    while (1) {
+	seq = __atomic_load_n (&status_seq, __ATOMIC_ACQUIRE);
+	for (i = 0; STATUS_WORDS > i; i++) {
+	    text[i] = __atomic_load_n (&status_text[i], __ATOMIC_RELAXED);
+	}
+
+	/* Order the loads of the text before the second sequence load. */
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	if (0 == (seq & 1) &&
+	    seq == __atomic_load_n (&status_seq, __ATOMIC_RELAXED)) {
+	    break;
+	}
+    }
+    (void)memcpy (buf, text, STATUS_MSG_LEN);
+    buf[STATUS_MSG_LEN] = '\0';
+    return (seq / 2);
+}
+
+
+#if defined(STATUS_STRESS_PROGRAM)
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/*
+ * Writers publish messages made of one repeated letter, with the length
+ * given by the letter, so that any mixture of two messages is caught.
+ */
+#define STRESS_LETTERS "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+
+static int stop = 0; /* tells threads to finish (accessed atomically) */
+
+
+/*
+ * message_length
+ *   DESCRIPTION: Get the length of the stress test message for a letter.
+ *   INPUTS: idx -- index of the letter in STRESS_LETTERS
+ *   OUTPUTS: none
+ *   RETURN VALUE: message length (1 to STATUS_MSG_LEN)
+ *   SIDE EFFECTS: none
+ */
+static int32_t
+message_length (int32_t idx)
+{
+    return (1 + (idx * 7) % STATUS_MSG_LEN);
+}
+
+
+/*
+ * writer
+ *   DESCRIPTION: Publish stress test messages until told to stop.
+ *   INPUTS: arg -- the writer's number
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of messages published
+ *   SIDE EFFECTS: none
+ */
+static void*
+writer (void* arg)
+{
+    char msg[STATUS_MSG_LEN + 1]; /* message to publish  */
+    unsigned long n;              /* messages published  */
+    int32_t idx;                  /* letter index        */
+
+    for (n = 0; !__atomic_load_n (&stop, __ATOMIC_RELAXED); n++) {
+	idx = ((long)arg * 11 + n) % (sizeof (STRESS_LETTERS) - 1);
+	(void)memset (msg, STRESS_LETTERS[idx], message_length (idx));
+	msg[message_length (idx)] = '\0';
+	status_publish (msg);
+    }
+    return (void*)n;
+}
+
+
+/*
+ * reader
+ *   DESCRIPTION: Read messages until told to stop, checking each.
+ *   INPUTS: arg -- pointer to the reader's count of reads
+ *   OUTPUTS: *arg -- increased by the number of reads
+ *   RETURN VALUE: number of torn or out-of-order reads
+ *   SIDE EFFECTS: none
+ */
+static void*
+reader (void* arg)
+{
+    char buf[STATUS_MSG_LEN + 1];  /* message read               */
+    unsigned long bad;             /* torn or out-of-order reads */
+    uint32_t gen;                  /* generation read            */
+    uint32_t last;                 /* previous generation        */
+    const char* find;              /* letter in STRESS_LETTERS   */
+    int32_t len;                   /* length of message          */
+
+    for (bad = 0, last = 0; !__atomic_load_n (&stop, __ATOMIC_RELAXED);
+	 (*(unsigned long*)arg)++) {
+	gen = status_read (buf);
+	if ((int32_t)(gen - last) < 0) {
+	    bad++;
+	}
+	last = gen;
+	if ('\0' == buf[0]) {
+	    continue;
+	}
+	find = strchr (STRESS_LETTERS, buf[0]);
+	for (len = 0; buf[0] == buf[len]; len++);
+	if (NULL == find || '\0' != buf[len] ||
+	    len != message_length (find - STRESS_LETTERS)) {
+	    if (10 > bad) {
+		fprintf (stderr, "torn read: \"%s\"\n", buf);
+	    }
+	    bad++;
+	}
+    }
+    return (void*)bad;
+}
+
+
+/*
+ * main
+ *   DESCRIPTION: Run writers and readers of the status message at once
+ *                and check that no reader ever sees a torn message.
+ *   INPUTS: argc, argv -- optional numbers of writers and readers
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if every read was a whole message, 3 if not
+ *   SIDE EFFECTS: prints the results to stdout
+ */
+int
+main (int argc, char* argv[])
+{
+    int32_t n_writers = (1 < argc ? atoi (argv[1]) : 8); /* writers   */
+    int32_t n_readers = (2 < argc ? atoi (argv[2]) : 4); /* readers   */
+    pthread_t id[n_writers + n_readers];  /* thread ids             */
+    unsigned long reads[n_readers];       /* reads by each reader   */
+    unsigned long written;                /* messages published     */
+    unsigned long total;                  /* reads by all readers   */
+    unsigned long bad;                    /* torn reads             */
+    void* ret;                            /* thread return value    */
+    int32_t i;                            /* index over threads     */
+
+    if (1 > n_writers || 1 > n_readers) {
+	fputs ("usage: status-stress [writers [readers]]\n", stderr);
+	return 2;
+    }
+    for (i = 0; n_writers > i; i++) {
+	(void)pthread_create (&id[i], NULL, writer, (void*)(long)i);
+    }
+    for (i = 0; n_readers > i; i++) {
+	reads[i] = 0;
+	(void)pthread_create (&id[n_writers + i], NULL, reader, &reads[i]);
+    }
+    sleep (2);
+    __atomic_store_n (&stop, 1, __ATOMIC_RELAXED);
+    for (written = 0, i = 0; n_writers > i; i++) {
+	(void)pthread_join (id[i], &ret);
+	written += (unsigned long)ret;
+    }
+    for (total = bad = 0, i = 0; n_readers > i; i++) {
+	(void)pthread_join (id[n_writers + i], &ret);
+	bad += (unsigned long)ret;
+	total += reads[i];
+    }
+    printf ("%d writers published %lu messages; %d readers made %lu reads, "
+	    "%lu torn or out of order\n", n_writers, written, n_readers,
+	    total, bad);
+    return (0 == bad ? 0 : 3);
+}
+
+#endif /* defined(STATUS_STRESS_PROGRAM) */
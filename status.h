@@ -0,0 +1,46 @@
+/*									tab:8
+ *
+ * status.h - header file for the published status message
+ *
+ * Filename:	    status.h
+ * History:
+ *	1	First written.  The status message is published through
+ *		a sequence lock so that readers never take a lock.
+ */
+
+#ifndef STATUS_H
+#define STATUS_H
+
+
+#include <stdint.h>
+
+
+#define STATUS_MSG_LEN 40 /* maximum length of status message */
+
+/*
+ * Replace the status message (truncated to STATUS_MSG_LEN characters; an
+ * empty string means no message).  Any thread may call it at any time.
+ */
+extern void status_publish (const char* msg);
+
+/*
+ * Clear the status message, but only if it is still the message with
+ * generation gen.  Returns 1 if it was cleared, or 0 if it had changed.
+ */
+extern int32_t status_clear_if (uint32_t gen);
+
+/*
+ * Get the generation of the status message, which increases each time
+ * that the message is replaced.  Never waits.
+ */
+extern uint32_t status_generation (void);
+
+/*
+ * Copy the status message into buf (STATUS_MSG_LEN + 1 bytes), returning
+ * its generation.  The copy is always a whole message, never parts of
+ * two.  The caller takes no lock, but retries while a message is being
+ * written, so it waits for as long as the write takes.
+ */
+extern uint32_t status_read (char* buf);
+
+#endif /* STATUS_H */
@@ -0,0 +1,569 @@
+/*									tab:8
+ *
+ * term.c - the ANSI terminal display
+ *
+ * Filename:	    term.c
+ * History:
+ *	1	First written.  Shows the frames of the software VGA on an
+ *		ANSI terminal, in half-block cells.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "term.h"
+#include "vga_emu.h"
+
+
+/*
+ * NOTES
+ *
+ * Each character cell shows two frame pixels, one above the other: the
+ * upper half block (U+2580) in the foreground color over the background
+ * color.  At full scale the 320x200 frame, status bar included, takes
+ * 320 columns and 100 rows, which few windows have, so the frame is
+ * scaled down by the smallest whole factor (up to four) that fits the
+ * window, averaging the pixels behind each half cell.  Colors are sent
+ * as 24-bit values or as the nearest entry of the xterm 256-color cube
+ * and gray ramp.
+ *
+ * Over a slow link the bytes written matter far more than the time to
+ * compute them, so the terminal's contents are kept here, and only the
+ * cells that differ are written.  The cursor is moved only to skip cells
+ * (forward on the same row when it can), and colors are set only when
+ * they differ from those left by the last cell, so a run of same-colored
+ * cells costs one color change.  A cell whose halves match is a space
+ * (or a full block, if the foreground already has the color), and the
+ * lower half block is used instead of the upper when that swaps colors
+ * already set.
+ *
+ * No frame may write more than the byte budget.  When a frame reaches
+ * it, the cells not yet written stay different from what the terminal
+ * shows, so they are written with the next frame; the next frame starts
+ * from the row at which this one stopped, so that the bottom of the
+ * screen (the status bar) is not always the part left behind.
+ */
+
+
+/* largest terminal display, in cells (at a scale of one) */
+#define TERM_MAX_COLS   VGA_EMU_X_DIM
+#define TERM_MAX_ROWS   (VGA_EMU_Y_DIM / 2)
+#define TERM_MAX_SCALE  4
+
+/* smallest byte budget, and most bytes written for one cell */
+#define TERM_MIN_BUDGET 512
+#define CELL_MAX_BYTES  64
+
+/* color not set or not known */
+#define NO_COLOR        0xFFFFFFFFU
+
+/* UTF-8 encodings of the block characters */
+#define UPPER_HALF      "\342\226\200"
+#define LOWER_HALF      "\342\226\204"
+#define FULL_BLOCK      "\342\226\210"
+
+/* colors of the two halves of one character cell */
+typedef struct {
+    uint32_t top;    /* color of upper pixel */
+    uint32_t bottom; /* color of lower pixel */
+} cell_t;
+
+
+static term_colors_t colors = TERM_OFF; /* colors used, or off          */
+static unsigned int budget;             /* most bytes written per frame */
+static int scale;                       /* frame pixels per cell column */
+static int cols, rows;                  /* cells in use                 */
+static char* out;                       /* bytes for the current frame  */
+static unsigned int used;               /* bytes in out                 */
+static int next_row;                    /* row at which to start        */
+static int cur_x, cur_y;                /* cursor position (-1: unknown) */
+static uint32_t cur_fg, cur_bg;         /* colors set on the terminal   */
+static term_stats_t stats;              /* frames written               */
+
+static unsigned char frame[VGA_EMU_Y_DIM][VGA_EMU_X_DIM]; /* frame shown */
+static uint8_t rgb[256][3];             /* palette in 8-bit components  */
+static uint32_t code[256];              /* palette as terminal colors   */
+static cell_t want[TERM_MAX_ROWS][TERM_MAX_COLS];  /* cells of frame    */
+static cell_t shown[TERM_MAX_ROWS][TERM_MAX_COLS]; /* cells on terminal */
+
+
+/* local functions--see function headers for details */
+static uint32_t color_code (const uint8_t c[3]);
+static uint32_t block_color (int x, int y);
+static void read_frame (void);
+static void put_str (const char* s);
+static void put_num (unsigned int n);
+static void put_color (int layer, uint32_t color);
+static void set_colors (uint32_t fg, uint32_t bg);
+static void move_to (int x, int y);
+static void put_cell (const cell_t* c);
+static void flush_out (void);
+
+
+/*
+ * color_code
+ *   DESCRIPTION: Find the terminal color for an RGB color: the color
+ *                itself (0xRRGGBB) in 24-bit mode, or else the nearest
+ *                entry of the xterm color cube or gray ramp.
+ *   INPUTS: c -- 8-bit red, green, and blue components
+ *   OUTPUTS: none
+ *   RETURN VALUE: the terminal color
+ *   SIDE EFFECTS: none
+ */
+static uint32_t
+color_code (const uint8_t c[3])
+{
+    static const uint8_t level[6] = {0, 95, 135, 175, 215, 255};
+    int idx[3];     /* cube coordinate of each component */
+    int gray;       /* index of nearest gray (0 to 23)   */
+    int v;          /* gray value                        */
+    long cube_err;  /* squared error of nearest cube color */
+    long gray_err;  /* squared error of nearest gray       */
+    int i;          /* loop index over components        */
+
+    if (TERM_TRUE_COLOR == colors) {
+	return ((uint32_t)c[0] << 16) | ((uint32_t)c[1] << 8) | c[2];
+    }
+
+    cube_err = gray_err = 0;
+    v = (c[0] + c[1] + c[2]) / 3;
+    gray = (v < 8 ? 0 : (238 < v ? 23 : (v - 3) / 10));
+    v = 8 + 10 * gray;
+    for (i = 0; i < 3; i++) {
+	idx[i] = (48 > c[i] ? 0 : (115 > c[i] ? 1 : (c[i] - 35) / 40));
+	cube_err += (long)(c[i] - level[idx[i]]) * (c[i] - level[idx[i]]);
+	gray_err += (long)(c[i] - v) * (c[i] - v);
+    }
+    if (gray_err < cube_err) {
+	return 232 + gray;
+    }
+    return 16 + 36 * idx[0] + 6 * idx[1] + idx[2];
+}
+
+
+/*
+ * block_color
+ *   DESCRIPTION: Find the terminal color for a half cell: the average of
+ *                the scale-by-scale block of frame pixels behind it.
+ *   INPUTS: (x,y) -- upper left pixel of the block
+ *   OUTPUTS: none
+ *   RETURN VALUE: the terminal color
+ *   SIDE EFFECTS: none
+ */
+static uint32_t
+block_color (int x, int y)
+{
+    unsigned int sum[3] = {0, 0, 0}; /* component sums over block  */
+    uint8_t avg[3];                  /* average color of block    */
+    const uint8_t* c;                /* color of one pixel        */
+    int dx, dy;                      /* loop indices over block   */
+    int i;                           /* loop index over components */
+
+    if (1 == scale) {
+	return code[frame[y][x]];
+    }
+    for (dy = 0; dy < scale; dy++) {
+	for (dx = 0; dx < scale; dx++) {
+	    c = rgb[frame[y + dy][x + dx]];
+	    for (i = 0; i < 3; i++) {
+		sum[i] += c[i];
+	    }
+	}
+    }
+    for (i = 0; i < 3; i++) {
+	avg[i] = sum[i] / (scale * scale);
+    }
+    return color_code (avg);
+}
+
+
+/*
+ * read_frame
+ *   DESCRIPTION: Render the frame on display and find the colors of the
+ *                cells that show it.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: fills frame, rgb, code, and want
+ */
+static void
+read_frame ()
+{
+    uint8_t dac[3]; /* 6-bit DAC color  */
+    int x, y;       /* cell coordinates */
+    int i, j;       /* loop indices     */
+
+    vga_emu_render (frame);
+    for (i = 0; i < 256; i++) {
+	vga_emu_palette (i, dac);
+	for (j = 0; j < 3; j++) {
+	    rgb[i][j] = ((dac[j] << 2) | (dac[j] >> 4));
+	}
+	code[i] = color_code (rgb[i]);
+    }
+    for (y = 0; y < rows; y++) {
+	for (x = 0; x < cols; x++) {
+	    want[y][x].top = block_color (x * scale, 2 * y * scale);
+	    want[y][x].bottom = block_color (x * scale, (2 * y + 1) * scale);
+	}
+    }
+}
+
+
+/*
+ * put_str
+ *   DESCRIPTION: Add a string to the bytes for the current frame.
+ *   INPUTS: s -- the string
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out
+ */
+static void
+put_str (const char* s)
+{
+    while ('\0' != *s) {
+	out[used++] = *s++;
+    }
+}
+
+
+/*
+ * put_num
+ *   DESCRIPTION: Add a number, in decimal, to the bytes for the current
+ *                frame.
+ *   INPUTS: n -- the number
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out
+ */
+static void
+put_num (unsigned int n)
+{
+    char digits[10]; /* digits, last first */
+    int n_digits;    /* number of digits   */
+
+    n_digits = 0;
+    do {
+	digits[n_digits++] = '0' + n % 10;
+	n /= 10;
+    } while (0 != n);
+    while (0 < n_digits) {
+	out[used++] = digits[--n_digits];
+    }
+}
+
+
+/*
+ * put_color
+ *   DESCRIPTION: Add the parameters that select a foreground or a
+ *                background color to a color (SGR) sequence.
+ *   INPUTS: layer -- 38 for the foreground, or 48 for the background
+ *           color -- the terminal color
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out
+ */
+static void
+put_color (int layer, uint32_t color)
+{
+    put_num (layer);
+    if (TERM_TRUE_COLOR == colors) {
+	put_str (";2;");
+	put_num (color >> 16);
+	put_str (";");
+	put_num ((color >> 8) & 0xFF);
+	put_str (";");
+	put_num (color & 0xFF);
+    } else {
+	put_str (";5;");
+	put_num (color);
+    }
+}
+
+
+/*
+ * set_colors
+ *   DESCRIPTION: Set the terminal's foreground and background colors,
+ *                writing one color sequence for those that change.
+ *   INPUTS: fg -- foreground color, or NO_COLOR to leave it
+ *           bg -- background color, or NO_COLOR to leave it
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out; updates cur_fg and cur_bg
+ */
+static void
+set_colors (uint32_t fg, uint32_t bg)
+{
+    int set_fg = (NO_COLOR != fg && cur_fg != fg); /* foreground changes */
+    int set_bg = (NO_COLOR != bg && cur_bg != bg); /* background changes */
+
+    if (!set_fg && !set_bg) {
+	return;
+    }
+    put_str ("\033[");
+    if (set_fg) {
+	put_color (38, fg);
+	cur_fg = fg;
+    }
+    if (set_bg) {
+	if (set_fg) {
+	    put_str (";");
+	}
+	put_color (48, bg);
+	cur_bg = bg;
+    }
+    put_str ("m");
+}
+
+
+/*
+ * move_to
+ *   DESCRIPTION: Move the cursor to a cell, if it is not there already.
+ *   INPUTS: (x,y) -- the cell
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out; updates cur_x and cur_y
+ */
+static void
+move_to (int x, int y)
+{
+    if (y == cur_y && x == cur_x) {
+	return;
+    }
+    put_str ("\033[");
+    if (y == cur_y && x > cur_x && 0 <= cur_x) {
+	/* Skipping unchanged cells to the right is cheaper. */
+	put_num (x - cur_x);
+	put_str ("C");
+    } else {
+	put_num (y + 1);
+	put_str (";");
+	put_num (x + 1);
+	put_str ("H");
+    }
+    cur_x = x;
+    cur_y = y;
+}
+
+
+/*
+ * put_cell
+ *   DESCRIPTION: Write a cell at the cursor, with the character and the
+ *                colors that need the fewest color changes.
+ *   INPUTS: c -- the colors of the cell
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: appends to out; advances the cursor
+ */
+static void
+put_cell (const cell_t* c)
+{
+    int upper_cost; /* colors to set for an upper half block */
+    int lower_cost; /* colors to set for a lower half block  */
+
+    if (c->top == c->bottom) {
+	if (cur_bg == c->top) {
+	    put_str (" ");
+	} else if (cur_fg == c->top) {
+	    put_str (FULL_BLOCK);
+	} else {
+	    set_colors (NO_COLOR, c->top);
+	    put_str (" ");
+	}
+    } else {
+	upper_cost = (cur_fg != c->top) + (cur_bg != c->bottom);
+	lower_cost = (cur_fg != c->bottom) + (cur_bg != c->top);
+	if (lower_cost < upper_cost) {
+	    set_colors (c->bottom, c->top);
+	    put_str (LOWER_HALF);
+	} else {
+	    set_colors (c->top, c->bottom);
+	    put_str (UPPER_HALF);
+	}
+    }
+
+    /*
+     * After the last column the terminal may be waiting to wrap, so
+     * the cursor position is not known.
+     */
+    if (cols == ++cur_x) {
+	cur_x = cur_y = -1;
+    }
+}
+
+
+/*
+ * flush_out
+ *   DESCRIPTION: Write the bytes for the current frame to stdout.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes to stdout; empties out
+ */
+static void
+flush_out ()
+{
+    unsigned int done; /* bytes written */
+    ssize_t n;         /* bytes written by one call */
+
+    for (done = 0; done < used; done += n) {
+	if (0 > (n = write (1, out + done, used - done))) {
+	    if (EINTR != errno) {
+		break;
+	    }
+	    n = 0;
+	}
+    }
+    used = 0;
+}
+
+
+/*
+ * term_start
+ *   DESCRIPTION: Take over the terminal on stdout for showing frames,
+ *                choosing the smallest scale at which the frame fits the
+ *                window (one, if the window size cannot be read).
+ *   INPUTS: c -- colors to use
+ *           bytes -- most bytes to write for one frame
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, or -1 if memory runs out
+ *   SIDE EFFECTS: switches the terminal to its alternate screen and hides
+ *                 the cursor
+ */
+int32_t
+term_start (term_colors_t c, unsigned int bytes)
+{
+    struct winsize ws; /* size of the terminal window */
+    int x, y;          /* loop indices over cells     */
+
+    budget = (TERM_MIN_BUDGET > bytes ? TERM_MIN_BUDGET : bytes);
+    if (NULL == (out = malloc (budget))) {
+	return -1;
+    }
+    colors = c;
+
+    scale = 1;
+    if (0 == ioctl (1, TIOCGWINSZ, &ws) && 0 < ws.ws_col && 0 < ws.ws_row) {
+	while (TERM_MAX_SCALE > scale &&
+	       (VGA_EMU_X_DIM / scale > ws.ws_col ||
+		VGA_EMU_Y_DIM / (2 * scale) > ws.ws_row)) {
+	    scale++;
+	}
+    }
+    cols = VGA_EMU_X_DIM / scale;
+    rows = VGA_EMU_Y_DIM / (2 * scale);
+
+    for (y = 0; y < rows; y++) {
+	for (x = 0; x < cols; x++) {
+	    shown[y][x].top = shown[y][x].bottom = NO_COLOR;
+	}
+    }
+    next_row = 0;
+    cur_x = cur_y = -1;
+    cur_fg = cur_bg = NO_COLOR;
+    (void)memset (&stats, 0, sizeof (stats));
+    stats.scale = scale;
+    stats.cols = cols;
+    stats.rows = rows;
+
+    put_str ("\033[?1049h\033[?25l\033[0m\033[2J");
+    flush_out ();
+    return 0;
+}
+
+
+/*
+ * term_show
+ *   DESCRIPTION: Write the cells of the frame on display that differ from
+ *                the terminal, within the byte budget.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes to stdout
+ */
+void
+term_show ()
+{
+    int limited = 0;    /* budget reached            */
+    unsigned int cells; /* cells written             */
+    int x, y;           /* cell coordinates          */
+    int i;              /* loop index over rows      */
+
+    if (TERM_OFF == colors) {
+	return;
+    }
+    read_frame ();
+
+    cells = 0;
+    for (i = 0; rows > i && !limited; i++) {
+	y = (next_row + i) % rows;
+	for (x = 0; cols > x; x++) {
+	    if (want[y][x].top == shown[y][x].top &&
+		want[y][x].bottom == shown[y][x].bottom) {
+		continue;
+	    }
+	    if (budget < used + CELL_MAX_BYTES) {
+		limited = 1;
+		next_row = y;
+		break;
+	    }
+	    move_to (x, y);
+	    put_cell (&want[y][x]);
+	    shown[y][x] = want[y][x];
+	    cells++;
+	}
+    }
+    if (0 == cells) {
+	return;
+    }
+
+    stats.frames++;
+    stats.limited += limited;
+    stats.cells += cells;
+    stats.bytes += used;
+    if (stats.max_bytes < used) {
+	stats.max_bytes = used;
+    }
+    flush_out ();
+}
+
+
+/*
+ * term_stop
+ *   DESCRIPTION: Give the terminal back: restore its colors, cursor, and
+ *                main screen.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes to stdout; frees the output buffer
+ */
+void
+term_stop ()
+{
+    if (TERM_OFF == colors) {
+	return;
+    }
+    put_str ("\033[0m\033[?25h\033[?1049l");
+    flush_out ();
+    free (out);
+    out = NULL;
+    colors = TERM_OFF;
+}
+
+
+/*
+ * term_get_stats
+ *   DESCRIPTION: Get statistics on the frames written.
+ *   INPUTS: none
+ *   OUTPUTS: s -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+term_get_stats (term_stats_t* s)
+{
+    *s = stats;
+}
@@ -0,0 +1,42 @@
+/*									tab:8
+ *
+ * term.h - header file for the ANSI terminal display
+ *
+ * Filename:	    term.h
+ * History:
+ *	1	First written.  Shows the frames of the software VGA on an
+ *		ANSI terminal, in half-block cells.
+ */
+
+#ifndef TERM_H
+#define TERM_H
+
+
+#include <stdint.h>
+
+#include "modex.h"
+
+
+/*
+ * These functions are called by modex.c, in the build with the VGA
+ * emulator, on behalf of set_mode_X, show_screen, and clear_mode_X; see
+ * set_terminal_display in modex.h.
+ */
+
+/*
+ * Take over the terminal on stdout (alternate screen, hidden cursor),
+ * choosing a scale that fits the frame in the window.  Returns 0, or -1
+ * if memory runs out.
+ */
+extern int32_t term_start (term_colors_t c, unsigned int bytes);
+
+/* Write the cells of the frame on display that differ from the terminal. */
+extern void term_show (void);
+
+/* Give the terminal back as it was before term_start. */
+extern void term_stop (void);
+
+/* Get statistics on the frames written. */
+extern void term_get_stats (term_stats_t* s);
+
+#endif /* TERM_H */
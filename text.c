@@ -33,6 +33,7 @@
  *		Integrated original release back into main code base.
  */
 
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include "text.h"
@@ -40,6 +41,15 @@
 #define IMAGE_X_DIM     320   /* pixels; must be divisible by 4             */
 #define PRIMARY_COLOR   0x2C // color of text
 #define SECONDARY_COLOR 0x4 // color of background
+#define BAR_ROWS        18  // rows in status bar image (text plus border)
+#define BAR_CHARS       (IMAGE_X_DIM/FONT_WIDTH) // characters in status bar
+#define BAR_PLANE_ROW   (IMAGE_X_DIM/4) // bytes per row in one plane
+
+static unsigned long alloc_count; // buffers allocated by this file
+
+// colors of the two pixels in each plane for each font row byte
+static uint16_t glyph_expand[4][256];
+static int glyph_expand_ready;
 
 /*
  * text_to_image
@@ -55,6 +65,7 @@
 unsigned char* text_to_image(char* str){
     int i; int j; int k;
     unsigned char* out = (unsigned char*)malloc(18*IMAGE_X_DIM);
+    alloc_count++;
     for (k = 0; k < 320; k++){
         out[k] = SECONDARY_COLOR;
         out[17*IMAGE_X_DIM+k] = SECONDARY_COLOR;
@@ -102,6 +113,7 @@ unsigned char* text_to_image(char* str){
 unsigned char* plane_order(unsigned char* img){
     int i; int j; int k;
     unsigned char* out = (unsigned char*)malloc(18*IMAGE_X_DIM);
+    alloc_count++;
     for (i = 0; i < 4; i++){ // iterates through each plane in out
         int outpoff = i*18*IMAGE_X_DIM/4; // offset of plane to write to in out
         int planeIndex = 0; // index into plane data of out
@@ -115,6 +127,94 @@ unsigned char* plane_order(unsigned char* img){
     return out;
 }
 
+/*
+ * init_glyph_expand
+ *   DESCRIPTION: Fill the glyph expansion table.  Entry [p][b] holds the
+ *                colors of the two pixels of font row byte b that fall in
+ *                plane p: pixel p (bit 7-p) in the low byte and pixel p+4
+ *                (bit 3-p) in the high byte, which is their order in the
+ *                plane on a little-endian machine.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: fills glyph_expand
+ */  
+static void init_glyph_expand(void){
+    int p; int b;
+    for (p = 0; p < 4; p++){
+        for (b = 0; b < 256; b++){
+            glyph_expand[p][b] = 
+                (((b >> (7 - p)) & 1) ? PRIMARY_COLOR : SECONDARY_COLOR) |
+                ((((b >> (3 - p)) & 1) ? PRIMARY_COLOR : SECONDARY_COLOR) << 8);
+        }
+    }
+    glyph_expand_ready = 1;
+}
+
+/*
+ * text_to_planes
+ *   DESCRIPTION: Render a string as a status bar image directly into a
+ *                caller-owned buffer in plane order, producing the same
+ *                bytes as plane_order(text_to_image(str)).  Each 8-pixel
+ *                character row puts two pixels in each plane, so each
+ *                plane row is built from glyph_expand entries four 
+ *                characters (8 bytes) at a time and written with one
+ *                64-bit store.  Positions past the end of the string use
+ *                the blank font row 0.  The first and last rows are border.
+ *   INPUTS: str -- string to render (at most 40 characters are shown)
+ *   OUTPUTS: out -- 18*320 bytes of planar pixel data
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: fills glyph_expand on first call
+ */  
+void text_to_planes(const char* str, unsigned char* out){
+    unsigned char glyph[BAR_CHARS];   // font index of each character
+    const uint16_t* expand;           // expansion table for one plane
+    uint64_t quad;                    // four characters in one plane row
+    int len;                          // characters shown
+    int plane;                        // plane being written
+    int row;                          // font row (bar row - 1)
+    int j;                            // loop index over characters
+
+    if (!glyph_expand_ready)
+        init_glyph_expand();
+
+    for (len = 0; len < BAR_CHARS && str[len] != '\0'; len++)
+        glyph[len] = (unsigned char)str[len];
+    for (j = len; j < BAR_CHARS; j++)
+        glyph[j] = 0; // font row 0 of character 0 is blank
+
+    for (plane = 0; plane < 4; plane++){
+        expand = glyph_expand[plane];
+        memset(out, SECONDARY_COLOR, BAR_PLANE_ROW);
+        out += BAR_PLANE_ROW;
+        for (row = 0; row < FONT_HEIGHT; row++){
+            for (j = 0; j < BAR_CHARS; j += 4){
+                quad = (uint64_t)expand[font_data[glyph[j]][row]] |
+                       ((uint64_t)expand[font_data[glyph[j+1]][row]] << 16) |
+                       ((uint64_t)expand[font_data[glyph[j+2]][row]] << 32) |
+                       ((uint64_t)expand[font_data[glyph[j+3]][row]] << 48);
+                memcpy(out + 2*j, &quad, sizeof(quad));
+            }
+            out += BAR_PLANE_ROW;
+        }
+        memset(out, SECONDARY_COLOR, BAR_PLANE_ROW);
+        out += BAR_PLANE_ROW;
+    }
+}
+
+/*
+ * text_alloc_count
+ *   DESCRIPTION: Get the number of image buffers allocated by
+ *                text_to_image and plane_order.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of allocations
+ *   SIDE EFFECTS: none
+ */  
+unsigned long text_alloc_count(void){
+    return alloc_count;
+}
+
 /* 
  * These font data were read out of video memory during text mode and
  * saved here.  They could be read in the same manner at the start of a
@@ -639,3 +739,86 @@ unsigned char font_data[256][16] = {
      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
 };
 
+
+
+#if defined(TEXT_BENCH_PROGRAM)
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_RENDERS 20000 // renders timed for each renderer
+
+/*
+ * bench_now_ns
+ *   DESCRIPTION: Read CLOCK_MONOTONIC for the "text-bench" program.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: time in nanoseconds
+ *   SIDE EFFECTS: none
+ */  
+static uint64_t bench_now_ns(void){
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * main -- for the "text-bench" program
+ *   DESCRIPTION: Check that text_to_planes matches text_to_image followed
+ *                by plane_order byte for byte on a set of status bar 
+ *                strings, then time full-bar renders with each.
+ *   INPUTS: none (command line arguments are ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, 1 if the images differ
+ */  
+int main(){
+    static const char* sample[] = {
+        "East of Everitt                  north",
+        "What are you babbling about?",
+        "",
+        "0123456789012345678901234567890123456789 and more",
+        "a"
+    };
+    static unsigned char planes[BAR_ROWS*IMAGE_X_DIM];
+    unsigned char* linear;  // text_to_image result
+    unsigned char* ordered; // plane_order result
+    char str[BAR_CHARS + 1];
+    uint64_t start;
+    double old_ns, new_ns;
+    int i; int n;
+
+    n = sizeof(sample)/sizeof(sample[0]);
+    for (i = 0; i < n; i++){
+        strncpy(str, sample[i], BAR_CHARS);
+        str[BAR_CHARS] = '\0';
+        linear = text_to_image(str);
+        text_to_planes(str, planes);
+        if (0 != memcmp(linear, planes, sizeof(planes))){
+            printf("mismatch rendering \"%s\"\n", str);
+            return 1;
+        }
+        free(linear);
+    }
+
+    start = bench_now_ns();
+    for (i = 0; i < BENCH_RENDERS; i++){
+        strncpy(str, sample[i % n], BAR_CHARS);
+        str[BAR_CHARS] = '\0';
+        ordered = text_to_image(str);
+        free(ordered);
+    }
+    old_ns = (double)(bench_now_ns() - start) / BENCH_RENDERS;
+
+    start = bench_now_ns();
+    for (i = 0; i < BENCH_RENDERS; i++)
+        text_to_planes(sample[i % n], planes);
+    new_ns = (double)(bench_now_ns() - start) / BENCH_RENDERS;
+
+    printf("full status bar render (%d renders each):\n", BENCH_RENDERS);
+    printf("  text_to_image + plane_order %9.1f ns\n", old_ns);
+    printf("  text_to_planes              %9.1f ns  (%.1fx)\n", new_ns,
+           old_ns / new_ns);
+    return 0;
+}
+
+#endif /* defined(TEXT_BENCH_PROGRAM) */
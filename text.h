@@ -70,4 +70,28 @@ unsigned char* text_to_image(char* str);
  */  
 unsigned char* plane_order(unsigned char* img);
 
+/*
+ * text_to_planes
+ *   DESCRIPTION: Render a string as a status bar image directly into a
+ *                caller-owned buffer in plane order, producing the same
+ *                bytes as plane_order(text_to_image(str)) without
+ *                allocating any memory.
+ *   INPUTS: str -- string to render (at most 40 characters are shown)
+ *   OUTPUTS: out -- 18*320 bytes of planar pixel data
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */  
+void text_to_planes(const char* str, unsigned char* out);
+
+/*
+ * text_alloc_count
+ *   DESCRIPTION: Get the number of image buffers allocated by
+ *                text_to_image and plane_order.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of allocations
+ *   SIDE EFFECTS: none
+ */  
+unsigned long text_alloc_count(void);
+
 #endif /* TEXT_H */
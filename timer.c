@@ -0,0 +1,179 @@
+/*									tab:8
+ *
+ * timer.c - timed events driven by the game loop
+ *
+ * Filename:	    timer.c
+ * History:
+ *	1	First written.  A timer wheel counted in game loop ticks,
+ *		replacing the status message helper thread.
+ */
+
+#include <stddef.h>
+
+#include "timer.h"
+
+
+/*
+ * NOTES
+ *
+ * Time is counted in game loop ticks rather than read from a clock, so
+ * timed events follow the game: the loop advances the timers once per
+ * tick that it runs, and a fast replay or benchmark that runs ticks back
+ * to back sees its timers expire after the same number of ticks as a
+ * game played in real time.
+ *
+ * The timers are kept in a hashed timer wheel: a timer due at tick T is
+ * linked into slot T mod TIMER_SLOTS.  Scheduling and cancelling are a
+ * few pointer updates.  Advancing by one tick examines the timers in one
+ * slot, including those due a whole number of revolutions later, which
+ * stay put until their tick comes.  With few timers longer than a
+ * revolution (12.8 seconds), that is constant work per timer and tick.
+ *
+ * Timers are not locked and must only be used by the game loop's thread.
+ */
+
+
+#define TIMER_SLOTS 256 /* slots in the wheel (a power of two) */
+
+static tick_timer_t* wheel[TIMER_SLOTS]; /* timers, by due tick        */
+static unsigned long cur_tick = 0;       /* ticks advanced so far      */
+
+
+/* local functions--see function headers for details */
+static void link_timer (tick_timer_t* t, tick_timer_t** list);
+
+
+/*
+ * link_timer
+ *   DESCRIPTION: Add an idle timer to the front of a list.
+ *   INPUTS: t -- the timer
+ *           list -- the list (a wheel slot, or the timers expiring)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void
+link_timer (tick_timer_t* t, tick_timer_t** list)
+{
+    if (NULL != (t->next = *list)) {
+	t->next->pprev = &t->next;
+    }
+    t->pprev = list;
+    *list = t;
+}
+
+
+/*
+ * timer_schedule
+ *   DESCRIPTION: Set a timer to expire some number of ticks from now.
+ *   INPUTS: t -- the timer
+ *           ticks -- ticks until expiry (0 is treated as 1)
+ *           fn -- function to call on expiry
+ *           arg -- argument for fn
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: cancels any earlier setting of the timer
+ */
+void
+timer_schedule (tick_timer_t* t, unsigned long ticks, tick_timer_fn_t fn,
+		void* arg)
+{
+    timer_cancel (t);
+    t->due = cur_tick + (0 == ticks ? 1 : ticks);
+    t->fn = fn;
+    t->arg = arg;
+    link_timer (t, &wheel[t->due & (TIMER_SLOTS - 1)]);
+}
+
+
+/*
+ * timer_cancel
+ *   DESCRIPTION: Stop a timer from expiring.
+ *   INPUTS: t -- the timer
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: unlinks the timer from the wheel if it is pending
+ */
+void
+timer_cancel (tick_timer_t* t)
+{
+    if (NULL != t->pprev) {
+	if (NULL != (*t->pprev = t->next)) {
+	    t->next->pprev = t->pprev;
+	}
+	t->pprev = NULL;
+	t->next = NULL;
+    }
+}
+
+
+/*
+ * timer_pending
+ *   DESCRIPTION: Check whether a timer has yet to expire.
+ *   INPUTS: t -- the timer
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the timer is pending, 0 if not
+ *   SIDE EFFECTS: none
+ */
+int32_t
+timer_pending (const tick_timer_t* t)
+{
+    return (NULL != t->pprev);
+}
+
+
+/*
+ * timer_now
+ *   DESCRIPTION: Get the current tick.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: ticks advanced so far
+ *   SIDE EFFECTS: none
+ */
+unsigned long
+timer_now ()
+{
+    return cur_tick;
+}
+
+
+/*
+ * timer_advance
+ *   DESCRIPTION: Advance the clock one tick at a time up to a given tick,
+ *                running the timers that expire.
+ *   INPUTS: now -- the new current tick (earlier ticks are ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: calls the functions of expired timers
+ */
+void
+timer_advance (unsigned long now)
+{
+    tick_timer_t*  expired; /* timers due at this tick      */
+    tick_timer_t** find;    /* index over links in the slot */
+    tick_timer_t*  t;       /* timer being run              */
+
+    while (now > cur_tick) {
+	cur_tick++;
+
+	/*
+	 * Move the expired timers out of the slot before running any.
+	 * They stay pending on the expired list until run, so a function
+	 * can still cancel or reschedule one that has yet to run.
+	 */
+	expired = NULL;
+	find = &wheel[cur_tick & (TIMER_SLOTS - 1)];
+	while (NULL != (t = *find)) {
+	    if (cur_tick != t->due) {
+		find = &t->next;
+		continue;
+	    }
+	    timer_cancel (t);
+	    link_timer (t, &expired);
+	}
+	while (NULL != (t = expired)) {
+	    timer_cancel (t);
+	    t->fn (t->arg);
+	}
+    }
+}
@@ -0,0 +1,56 @@
+/*									tab:8
+ *
+ * timer.h - header file for timed events driven by the game loop
+ *
+ * Filename:	    timer.h
+ * History:
+ *	1	First written.  A timer wheel counted in game loop ticks,
+ *		replacing the status message helper thread.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+
+#include <stdint.h>
+
+
+/* function called when a timer expires, with the argument given to it */
+typedef void (*tick_timer_fn_t) (void* arg);
+
+/*
+ * A timer.  The caller owns the structure (usually a static variable) and
+ * should treat its fields as private; a zeroed structure is an idle timer.
+ */
+typedef struct tick_timer_t tick_timer_t;
+struct tick_timer_t {
+    tick_timer_t*   next;   /* next timer in the same wheel slot     */
+    tick_timer_t**  pprev;  /* link to this timer, or NULL if idle   */
+    unsigned long   due;    /* tick at which the timer expires       */
+    tick_timer_fn_t fn;     /* function to call on expiry            */
+    void*           arg;    /* argument for fn                       */
+};
+
+/*
+ * Arrange for fn (arg) to be called once ticks ticks from now (at least
+ * one), replacing any earlier setting of the timer.  Takes constant time.
+ */
+extern void timer_schedule (tick_timer_t* t, unsigned long ticks,
+			    tick_timer_fn_t fn, void* arg);
+
+/* Stop a timer if it is pending.  Takes constant time. */
+extern void timer_cancel (tick_timer_t* t);
+
+/* Returns 1 if the timer is waiting to expire, or 0 if not. */
+extern int32_t timer_pending (const tick_timer_t* t);
+
+/* Get the current tick (the number of ticks advanced so far). */
+extern unsigned long timer_now (void);
+
+/*
+ * Advance the clock to tick now, calling the function of each timer that
+ * expires on the way.  Timer functions may schedule and cancel timers.
+ */
+extern void timer_advance (unsigned long now);
+
+#endif /* TIMER_H */
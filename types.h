@@ -41,5 +41,6 @@ typedef struct image_t image_t;
 /* types defined in world.h */
 typedef struct room_t room_t;
 typedef struct object_t object_t;
+typedef struct world_t world_t;
 
 #endif /* TYPES_H */
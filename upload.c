@@ -0,0 +1,334 @@
+/*									tab:8
+ *
+ * upload.c - build buffer to video memory copy kernels
+ *
+ * Filename:	    upload.c
+ * History:
+ *	1	First written.  Selectable copy kernels for show_screen,
+ *		chosen by a startup probe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "upload.h"
+
+
+/*
+ * NOTES
+ *
+ * Every tick copies four planes of the build buffer (and the status bar)
+ * into video memory, so the copy is a fixed cost of each frame.  Which
+ * copy is fastest depends heavily on the platform: under emulation, a
+ * single REP MOVSB is translated into a native loop, while on real
+ * hardware video memory is usually mapped write-combining, where wide
+ * or non-temporal stores fill whole write-combining buffers per burst.
+ * Rather than guess, set_mode_X calls upload_probe to time each kernel
+ * on the mapped video memory itself and uses the fastest one.
+ *
+ * The SSE2 and AVX kernels are compiled with target attributes so that
+ * the rest of the program does not require those instruction sets; they
+ * are only selected when the CPU reports support for them.
+ */
+
+
+/* number of timed copies per kernel in a probe; the fastest one counts */
+#define PROBE_REPS 16
+
+
+/* local functions--see function headers for details */
+static void upload_rep_movsb (unsigned char* dst, const unsigned char* src,
+			      uint32_t n);
+static void upload_memcpy (unsigned char* dst, const unsigned char* src,
+			   uint32_t n);
+static void upload_sse2 (unsigned char* dst, const unsigned char* src,
+			 uint32_t n);
+static void upload_avx (unsigned char* dst, const unsigned char* src,
+			uint32_t n);
+static void upload_stream (unsigned char* dst, const unsigned char* src,
+			   uint32_t n);
+
+
+/* kernel table, indexed by upload_kernel_t */
+static const struct {
+    const char* name;
+    upload_fn_t fn;
+} kernel[NUM_UPLOAD_KERNELS] = {
+    {"rep movsb", upload_rep_movsb},
+    {"memcpy",    upload_memcpy},
+    {"sse2",      upload_sse2},
+    {"avx",       upload_avx},
+    {"stream",    upload_stream}
+};
+
+/* bytes per cycle measured by the last probe (0 if not run/supported) */
+static double probe_rate[NUM_UPLOAD_KERNELS];
+static uint32_t probe_len;                /* bytes per copy in last probe */
+static upload_kernel_t probe_choice = UPLOAD_REP_MOVSB;
+
+
+/*
+ * upload_rep_movsb
+ *   DESCRIPTION: Copy with a single x86 string move instruction.
+ *   INPUTS: dst -- destination address
+ *           src -- source address
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes n bytes at dst
+ */
+static void
+upload_rep_movsb (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    unsigned long cnt = n; /* full register width for the count */
+
+    asm volatile (
+        "cld                                                 ;"
+       	"rep movsb    # copy ECX bytes from M[ESI] to M[EDI]  "
+      : "+S" (src), "+D" (dst), "+c" (cnt)
+      : /* no other inputs */
+      : "memory", "cc"
+    );
+}
+
+
+/*
+ * upload_memcpy
+ *   DESCRIPTION: Copy with the C library.
+ *   INPUTS: dst -- destination address
+ *           src -- source address
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes n bytes at dst
+ */
+static void
+upload_memcpy (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    (void)memcpy (dst, src, n);
+}
+
+
+/*
+ * upload_sse2
+ *   DESCRIPTION: Copy 64 bytes per iteration with 16-byte unaligned
+ *                SSE2 loads and stores.
+ *   INPUTS: dst -- destination address
+ *           src -- source address
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes n bytes at dst
+ */
+__attribute__ ((target ("sse2"))) static void
+upload_sse2 (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    __m128i a, b, c, d; /* one 64-byte block */
+    uint32_t i;         /* offset of block   */
+
+    for (i = 0; i + 64 <= n; i += 64) {
+	a = _mm_loadu_si128 ((const __m128i*)(src + i));
+	b = _mm_loadu_si128 ((const __m128i*)(src + i + 16));
+	c = _mm_loadu_si128 ((const __m128i*)(src + i + 32));
+	d = _mm_loadu_si128 ((const __m128i*)(src + i + 48));
+	_mm_storeu_si128 ((__m128i*)(dst + i), a);
+	_mm_storeu_si128 ((__m128i*)(dst + i + 16), b);
+	_mm_storeu_si128 ((__m128i*)(dst + i + 32), c);
+	_mm_storeu_si128 ((__m128i*)(dst + i + 48), d);
+    }
+    for (; i + 16 <= n; i += 16) {
+	_mm_storeu_si128 ((__m128i*)(dst + i),
+			  _mm_loadu_si128 ((const __m128i*)(src + i)));
+    }
+    if (i < n)
+	(void)memcpy (dst + i, src + i, n - i);
+}
+
+
+/*
+ * upload_avx
+ *   DESCRIPTION: Copy 64 bytes per iteration with 32-byte unaligned
+ *                AVX loads and stores.
+ *   INPUTS: dst -- destination address
+ *           src -- source address
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes n bytes at dst
+ */
+__attribute__ ((target ("avx"))) static void
+upload_avx (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    __m256i a, b; /* one 64-byte block */
+    uint32_t i;   /* offset of block   */
+
+    for (i = 0; i + 64 <= n; i += 64) {
+	a = _mm256_loadu_si256 ((const __m256i*)(src + i));
+	b = _mm256_loadu_si256 ((const __m256i*)(src + i + 32));
+	_mm256_storeu_si256 ((__m256i*)(dst + i), a);
+	_mm256_storeu_si256 ((__m256i*)(dst + i + 32), b);
+    }
+    for (; i + 32 <= n; i += 32) {
+	_mm256_storeu_si256 ((__m256i*)(dst + i),
+			     _mm256_loadu_si256 ((const __m256i*)(src + i)));
+    }
+    if (i < n)
+	(void)memcpy (dst + i, src + i, n - i);
+}
+
+
+/*
+ * upload_stream
+ *   DESCRIPTION: Copy with 16-byte non-temporal stores, which bypass
+ *                the cache and combine into full-line bursts.  The
+ *                stores require an aligned destination, so unaligned
+ *                leading and trailing bytes are copied normally.
+ *   INPUTS: dst -- destination address
+ *           src -- source address
+ *           n -- number of bytes to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes n bytes at dst; fences the streaming stores
+ */
+__attribute__ ((target ("sse2"))) static void
+upload_stream (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    uint32_t head; /* bytes before first aligned destination address */
+    uint32_t i;    /* offset of block                                 */
+
+    head = (16 - ((unsigned long)dst & 15)) & 15;
+    if (head > n)
+	head = n;
+    (void)memcpy (dst, src, head);
+    for (i = head; i + 16 <= n; i += 16) {
+	_mm_stream_si128 ((__m128i*)(dst + i),
+			  _mm_loadu_si128 ((const __m128i*)(src + i)));
+    }
+    if (i < n)
+	(void)memcpy (dst + i, src + i, n - i);
+    _mm_sfence ();
+}
+
+
+/*
+ * upload_kernel_name
+ *   DESCRIPTION: Get the printable name of a copy kernel.
+ *   INPUTS: k -- the kernel
+ *   OUTPUTS: none
+ *   RETURN VALUE: kernel name
+ *   SIDE EFFECTS: none
+ */
+const char*
+upload_kernel_name (upload_kernel_t k)
+{
+    return kernel[k].name;
+}
+
+
+/*
+ * upload_kernel_supported
+ *   DESCRIPTION: Check whether the CPU can execute a copy kernel.
+ *   INPUTS: k -- the kernel
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if supported, 0 if not
+ *   SIDE EFFECTS: none
+ */
+int
+upload_kernel_supported (upload_kernel_t k)
+{
+    __builtin_cpu_init ();
+    switch (k) {
+	case UPLOAD_SSE2:
+	case UPLOAD_STREAM: return (0 != __builtin_cpu_supports ("sse2"));
+	case UPLOAD_AVX:    return (0 != __builtin_cpu_supports ("avx"));
+	default:            return 1;
+    }
+}
+
+
+/*
+ * upload_kernel_fn
+ *   DESCRIPTION: Get the function implementing a copy kernel.
+ *   INPUTS: k -- the kernel
+ *   OUTPUTS: none
+ *   RETURN VALUE: kernel function
+ *   SIDE EFFECTS: none
+ */
+upload_fn_t
+upload_kernel_fn (upload_kernel_t k)
+{
+    return kernel[k].fn;
+}
+
+
+/*
+ * upload_probe
+ *   DESCRIPTION: Time each supported kernel copying len bytes from src
+ *                to region.  Each kernel is run once to warm up, then
+ *                PROBE_REPS times; the fastest copy is taken as its rate.
+ *   INPUTS: region -- destination (normally mapped video memory)
+ *           src -- source (normally the build buffer)
+ *           len -- bytes per copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: the kernel with the highest rate
+ *   SIDE EFFECTS: overwrites len bytes at region; records the rates
+ *                 for upload_report
+ */
+upload_kernel_t
+upload_probe (unsigned char* region, const unsigned char* src, uint32_t len)
+{
+    upload_kernel_t k;     /* loop index over kernels     */
+    uint64_t        start; /* time stamp before one copy  */
+    uint64_t        best;  /* fewest cycles for one copy  */
+    uint64_t        t;     /* cycles for one copy         */
+    int             i;     /* loop index over repetitions */
+
+    probe_len = len;
+    probe_choice = UPLOAD_REP_MOVSB;
+    for (k = 0; NUM_UPLOAD_KERNELS > k; k++) {
+	probe_rate[k] = 0;
+	if (!upload_kernel_supported (k))
+	    continue;
+	(*kernel[k].fn) (region, src, len);
+	best = ~(uint64_t)0;
+	for (i = 0; PROBE_REPS > i; i++) {
+	    start = __rdtsc ();
+	    (*kernel[k].fn) (region, src, len);
+	    t = __rdtsc () - start;
+	    if (t < best)
+		best = t;
+	}
+	probe_rate[k] = (double)len / (0 == best ? 1 : best);
+	if (probe_rate[k] > probe_rate[probe_choice])
+	    probe_choice = k;
+    }
+    return probe_choice;
+}
+
+
+/*
+ * upload_report
+ *   DESCRIPTION: Print the rate of each kernel measured by the last
+ *                probe, marking the kernel chosen.
+ *   INPUTS: out -- stream for the report
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+upload_report (FILE* out)
+{
+    upload_kernel_t k; /* loop index over kernels */
+
+    fprintf (out, "upload kernels (%u bytes per copy):\n", probe_len);
+    for (k = 0; NUM_UPLOAD_KERNELS > k; k++) {
+	if (0 == probe_rate[k]) {
+	    fprintf (out, "  %-10s   unsupported\n", kernel[k].name);
+	} else {
+	    fprintf (out, "  %-10s %7.3f bytes/cycle%s\n", kernel[k].name,
+		     probe_rate[k], (probe_choice == k ? "  (selected)" : ""));
+	}
+    }
+}
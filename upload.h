@@ -0,0 +1,48 @@
+/*									tab:8
+ *
+ * upload.h - header file for build buffer to video memory copy kernels
+ *
+ * Filename:	    upload.h
+ * History:
+ *	1	First written.  Selectable copy kernels for show_screen,
+ *		chosen by a startup probe.
+ */
+
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+/* copy kernels available for moving planes into video memory */
+typedef enum {
+    UPLOAD_REP_MOVSB,	/* x86 string move (the original copy)     */
+    UPLOAD_MEMCPY,	/* C library memcpy                        */
+    UPLOAD_SSE2,	/* 16-byte unaligned loads and stores      */
+    UPLOAD_AVX,		/* 32-byte unaligned loads and stores      */
+    UPLOAD_STREAM,	/* 16-byte non-temporal (streaming) stores */
+    NUM_UPLOAD_KERNELS
+} upload_kernel_t;
+
+/* a copy kernel: copy n bytes from src to dst (regions do not overlap) */
+typedef void (*upload_fn_t) (unsigned char* dst, const unsigned char* src,
+			     uint32_t n);
+
+/* Get kernel name, whether the CPU supports it, and its function. */
+extern const char* upload_kernel_name (upload_kernel_t k);
+extern int upload_kernel_supported (upload_kernel_t k);
+extern upload_fn_t upload_kernel_fn (upload_kernel_t k);
+
+/*
+ * Time each supported kernel copying len bytes from src into region,
+ * record the rates, and return the fastest kernel.
+ */
+extern upload_kernel_t upload_probe (unsigned char* region,
+				     const unsigned char* src, uint32_t len);
+
+/* Print the rates (bytes per cycle) measured by the last probe. */
+extern void upload_report (FILE* out);
+
+#endif /* UPLOAD_H */
@@ -0,0 +1,240 @@
+/*									tab:8
+ *
+ * verbs.c - typed command verb lookup
+ *
+ * Filename:	    verbs.c
+ * History:
+ *	1	First written.  Verbs are looked up in a trie generated
+ *		from the verb list when the game is built.
+ */
+
+#include <ctype.h>
+
+#include "verbs.h"
+
+
+/*
+ * NOTES
+ *
+ * A typed verb matches a verb in the list below if it is a prefix of that
+ * verb at least min_len characters long (ignoring case), and the first
+ * matching verb in the list wins.  Rather than comparing the typed verb
+ * with every verb in turn, the game walks a trie with one node for every
+ * prefix of every verb, taking one step per character typed.  Each node
+ * records the command chosen by the first verb that the prefix matches.
+ *
+ * The trie is generated when the game is built: compiling this file with
+ * VERB_TABLE_PROGRAM defined yields mkverbs, which checks the verb list
+ * and writes the trie to verb_trie.h, and the Makefile runs it before
+ * compiling this file for the game.  Mistakes in the verb list thus stop
+ * the build rather than the game.  In particular, a verb with every
+ * abbreviation already matched by earlier verbs (as "an" would be after
+ * "a" with a minimum length of 1) can never be typed, and is reported.
+ */
+
+
+#if defined(VERB_TABLE_PROGRAM)
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define MAX_VERB_NODES 256 /* trie node indices must fit in a uint8_t */
+#define MAX_VERB_LEN   20  /* longest verb allowed                    */
+
+/*
+ * structure and static data used for parsing typed commands
+ *
+ * Note that the structure allows us to abbreviate commands and to create
+ * synonyms for verbs (e.g., get and grab).
+ */
+typedef struct typed_cmd_t typed_cmd_t;
+struct typed_cmd_t {
+    const char* name;	/* verb that must be typed               */
+    int32_t min_len;	/* minimum number of matching characters */
+    cmd_id_t cmd;	/* resulting command                     */
+};
+
+static const typed_cmd_t cmd_list[] = {
+    {"buy",       3, TC_BUY},
+    {"charge",    2, TC_CHARGE},
+    {"do",        2, TC_DO},
+    {"drink",     3, TC_DRINK},
+    {"drop",      2, TC_DROP},
+    {"fix",       3, TC_FIX},
+    {"flash",     5, TC_FLASH},
+    {"get",       1, TC_GET},
+    {"go",        2, TC_GO},
+    {"grab",      2, TC_GET},
+    {"install",   3, TC_INSTALL},
+    {"inventory", 1, TC_INVENTORY},
+    {"sigh",      4, TC_SIGH},
+    {"use",       3, TC_USE},
+    {"wear",      4, TC_WEAR},
+    {NULL, 0, 0}
+};
+
+/* names of commands in the generated file, indexed by cmd_id_t */
+static const char* const tc_name[NUM_TC_VALUES + 1] = {
+    "TC_BUY", "TC_CHARGE", "TC_DO", "TC_DRINK", "TC_DROP", "TC_FIX",
+    "TC_FLASH", "TC_GET", "TC_GO", "TC_INSTALL", "TC_INVENTORY", "TC_SIGH",
+    "TC_USE", "TC_WEAR", "NUM_TC_VALUES"
+};
+
+/* the trie under construction; node 0 is the empty prefix */
+static uint8_t next[MAX_VERB_NODES][26];       /* child for each letter   */
+static int32_t owner[MAX_VERB_NODES];          /* cmd_list index, or -1   */
+static char prefix[MAX_VERB_NODES][MAX_VERB_LEN + 1]; /* prefix at node   */
+static int32_t n_nodes;                        /* nodes in use            */
+
+
+/*
+ * main
+ *   DESCRIPTION: Check the verb list, build the verb trie, and write it
+ *                to stdout as C declarations.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, 3 if the verb list has mistakes
+ *   SIDE EFFECTS: prints error messages to stderr
+ */
+int
+main ()
+{
+    int32_t cnt[NUM_TC_VALUES]; /* count of synonymous commands      */
+    int32_t idx;                /* index over list of typed commands */
+    const char* name;           /* verb                              */
+    int32_t len;                /* length of verb                    */
+    int32_t pos;                /* index over characters of verb     */
+    int32_t node;               /* trie node for prefix of verb      */
+    int32_t c;                  /* letter of verb (0 to 25)          */
+    int32_t reachable;          /* some prefix of verb matches it    */
+    int32_t ret_val;            /* return value                      */
+
+    ret_val = 0;
+    (void)memset (cnt, 0, sizeof (cnt));
+    owner[0] = -1;
+    n_nodes = 1;
+
+    for (idx = 0; NULL != (name = cmd_list[idx].name); idx++) {
+	len = strlen (name);
+	if (1 > cmd_list[idx].min_len) {
+	    fprintf (stderr, "Typed command %s always matches.\n", name);
+	    ret_val = 3;
+	    continue;
+	}
+	if (cmd_list[idx].min_len > len) {
+	    fprintf (stderr, "Typed command %s can never match.\n", name);
+	    ret_val = 3;
+	    continue;
+	}
+        if (0 > cmd_list[idx].cmd || NUM_TC_VALUES <= cmd_list[idx].cmd) {
+	    fprintf (stderr, "Typed command %s has invalid command number.\n",
+		     name);
+	    ret_val = 3;
+	    continue;
+	}
+	if (MAX_VERB_LEN < len || len != strspn (name,
+		"abcdefghijklmnopqrstuvwxyz")) {
+	    fprintf (stderr, "Typed command %s must be at most %d lowercase "
+		     "letters.\n", name, MAX_VERB_LEN);
+	    ret_val = 3;
+	    continue;
+	}
+	cnt[cmd_list[idx].cmd]++;
+
+	/*
+	 * Add the verb's prefixes to the trie.  Those long enough to match
+	 * the verb and not matched by an earlier verb now choose this one.
+	 */
+	reachable = 0;
+	for (node = 0, pos = 0; len > pos; pos++) {
+	    c = name[pos] - 'a';
+	    if (0 == next[node][c]) {
+		if (MAX_VERB_NODES == n_nodes) {
+		    fputs ("Too many typed command prefixes.\n", stderr);
+		    return 3;
+		}
+		next[node][c] = n_nodes;
+		owner[n_nodes] = -1;
+		(void)memcpy (prefix[n_nodes], name, pos + 1);
+		n_nodes++;
+	    }
+	    node = next[node][c];
+	    if (cmd_list[idx].min_len <= pos + 1 && -1 == owner[node]) {
+		owner[node] = idx;
+		reachable = 1;
+	    }
+	}
+	if (!reachable) {
+	    fprintf (stderr, "Typed command %s is shadowed by %s.\n", name,
+		     cmd_list[owner[node]].name);
+	    ret_val = 3;
+	}
+    }
+
+    /* Check that every typed command can be issued with some string. */
+    for (idx = 0; NUM_TC_VALUES > idx; idx++) {
+        if (0 == cnt[idx]) {
+	    fprintf (stderr, "%s has no valid command strings.\n", tc_name[idx]);
+	    ret_val = 3;
+	}
+    }
+    if (0 != ret_val) {
+	return ret_val;
+    }
+
+    /* Write the trie. */
+    printf ("/* verb_trie.h - generated by mkverbs from verbs.c; "
+	    "do not edit */\n\n#define VERB_NODES %d\n\n"
+	    "/* child of each node for each letter; 0 for none */\n"
+	    "static const uint8_t verb_next[VERB_NODES][26] = {\n", n_nodes);
+    for (node = 0; n_nodes > node; node++) {
+	printf ("    /* \"%s\" */\n    {", prefix[node]);
+	for (c = 0; 26 > c; c++) {
+	    printf ("%s%d", (0 == c ? "" : ", "), next[node][c]);
+	}
+	printf ("}%s\n", (n_nodes - 1 > node ? "," : ""));
+    }
+    printf ("};\n\n/* command matched at each node */\n"
+	    "static const cmd_id_t verb_cmd[VERB_NODES] = {\n");
+    for (node = 0; n_nodes > node; node++) {
+	printf ("    %s%s /* \"%s\" */\n", (-1 == owner[node] ?
+		tc_name[NUM_TC_VALUES] : tc_name[cmd_list[owner[node]].cmd]),
+		(n_nodes - 1 > node ? "," : ""), prefix[node]);
+    }
+    printf ("};\n");
+
+    return 0;
+}
+
+#else /* !defined(VERB_TABLE_PROGRAM) */
+
+#include "verb_trie.h"
+
+
+/*
+ * find_verb
+ *   DESCRIPTION: Look up a typed verb by walking the verb trie.
+ *   INPUTS: verb -- the typed verb (need not be NUL-terminated)
+ *           len -- number of characters in the verb
+ *   OUTPUTS: none
+ *   RETURN VALUE: the command, or NUM_TC_VALUES if no verb matches
+ *   SIDE EFFECTS: none
+ */
+cmd_id_t
+find_verb (const char* verb, int32_t len)
+{
+    int32_t node; /* trie node for characters seen */
+    int32_t pos;  /* index over typed characters   */
+    int32_t c;    /* letter typed (0 to 25)        */
+
+    for (node = 0, pos = 0; len > pos; pos++) {
+	c = tolower ((unsigned char)verb[pos]) - 'a';
+	if (0 > c || 26 <= c || 0 == (node = verb_next[node][c])) {
+	    return NUM_TC_VALUES;
+	}
+    }
+    return verb_cmd[node];
+}
+
+#endif /* defined(VERB_TABLE_PROGRAM) */
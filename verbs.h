@@ -0,0 +1,47 @@
+/*									tab:8
+ *
+ * verbs.h - header file for typed command verb lookup
+ *
+ * Filename:	    verbs.h
+ * History:
+ *	1	First written.  Verbs are looked up in a trie generated
+ *		from the verb list when the game is built.
+ */
+
+#ifndef VERBS_H
+#define VERBS_H
+
+
+#include <stdint.h>
+
+
+/*
+ * typed commands; several verbs can map to the same command (e.g., get
+ * and grab), and verbs can be abbreviated (see the verb list in verbs.c)
+ */
+typedef enum { /* TC = typed command */
+    TC_BUY,
+    TC_CHARGE,
+    TC_DO,
+    TC_DRINK,
+    TC_DROP,
+    TC_FIX,
+    TC_FLASH,
+    TC_GET,
+    TC_GO,
+    TC_INSTALL,
+    TC_INVENTORY,
+    TC_SIGH,
+    TC_USE,
+    TC_WEAR,
+    NUM_TC_VALUES
+} cmd_id_t;
+
+/*
+ * Look up a typed verb of len characters (not necessarily NUL-terminated),
+ * ignoring case.  Takes time proportional to len, however many verbs there
+ * are.  Returns the command, or NUM_TC_VALUES if no verb matches.
+ */
+extern cmd_id_t find_verb (const char* verb, int32_t len);
+
+#endif /* VERBS_H */
@@ -0,0 +1,694 @@
+/*									tab:8
+ *
+ * vga_emu.c - software model of the VGA used by the mode X code
+ *
+ * Filename:	    vga_emu.c
+ * History:
+ *	1	First written.  Models the subset of the VGA used by the
+ *		mode X code so that it can run without video hardware.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "vga_emu.h"
+
+
+/*
+ * NOTES
+ *
+ * Only the features used by modex.c are modeled.  In particular, video
+ * memory is always treated as the 64kB window at 0xA0000 (the graphics
+ * miscellaneous register setting used by mode X), host writes use write
+ * mode 0 with all bits enabled or write mode 1 (graphics mode register
+ * 0x05), and the display is always rendered as 256-color mode X: four
+ * pixels per address, one per plane.  As on the VGA, every host read
+ * loads the four latches from the addressed byte of each plane; write
+ * mode 1 stores the latches, ignoring the host data, which lets the
+ * mode X code copy four pixels per byte within video memory.
+ * Writes to addresses outside the window (for example, the text screen
+ * at 0xB8000 written when returning to text mode) are discarded.
+ *
+ * Display timing is modeled only as far as input status #1 reports it:
+ * the current scan line is derived from a clock (real time by default),
+ * and the vertical retrace and display disabled bits are set when that
+ * scan line falls in the retrace or blanking intervals.  Replacing the
+ * clock with a simulated one, e.g., one that advances a fixed amount per
+ * call, makes retrace waits deterministic, and the frame period may be
+ * changed with it to stand in for a monitor whose timing differs from
+ * the nominal.
+ *
+ * The rendered frame uses the start address registers as written, but
+ * the CRTC itself reads them only when vertical retrace begins.  When
+ * asked (vga_emu_watch_display), the model also keeps the start address
+ * that the CRTC last read, by checking the clock before every register
+ * and memory write, and counts the writes into the rows on display.
+ * Drawing synchronized with retrace should never make one.
+ */
+
+
+/* register counts for each VGA controller */
+#define NUM_SEQ_REGS   8
+#define NUM_CRTC_REGS 32
+#define NUM_GFX_REGS  16
+#define NUM_ATTR_REGS 32
+
+/* planar video memory */
+static unsigned char vram[4][VGA_EMU_PLANE_SIZE];
+
+/* register file */
+static uint8_t seq_reg[NUM_SEQ_REGS];   /* sequencer (0x3C4/0x3C5)        */
+static uint8_t seq_idx;
+static uint8_t crtc_reg[NUM_CRTC_REGS]; /* CRT controller (0x3D4/0x3D5)   */
+static uint8_t crtc_idx;
+static uint8_t gfx_reg[NUM_GFX_REGS];   /* graphics (0x3CE/0x3CF)         */
+static uint8_t gfx_idx;
+static uint8_t attr_reg[NUM_ATTR_REGS]; /* attribute (0x3C0/0x3C1)        */
+static uint8_t attr_idx;
+static int     attr_is_data;            /* attribute index/data flip-flop */
+static uint8_t misc_out;                /* miscellaneous output (0x3C2)   */
+static uint8_t latch[4];                /* one byte per plane from reads  */
+
+/* function used to copy host writes into each enabled plane */
+static void default_copy (unsigned char* dst, const unsigned char* src,
+			  uint32_t n);
+static void (*copy_fn) (unsigned char*, const unsigned char*, uint32_t) =
+    default_copy;
+
+/* clock from which display timing is derived */
+static uint64_t monotonic_now (void);
+static uint64_t (*now_fn) (void) = monotonic_now;
+static uint64_t frame_ns = VGA_EMU_FRAME_NS;  /* length of a frame      */
+
+/* start address read by the CRTC, and writes into the rows it shows */
+static void latch_start (void);
+static void watch_write (uint32_t addr, uint32_t n);
+static int      watching;               /* keep track of the display      */
+static uint64_t retraces;               /* retraces begun when last seen  */
+static uint16_t shown_start;            /* start address read at retrace  */
+static unsigned long shown_writes;      /* writes into rows on display    */
+
+/* DAC palette: 6-bit RGB per color, with auto-incrementing indices */
+static uint8_t dac[256][3];
+static uint8_t dac_w_idx, dac_w_comp;
+static uint8_t dac_r_idx, dac_r_comp;
+
+
+/*
+ * default_copy
+ *   DESCRIPTION: Copy bytes into a plane with memcpy.
+ *   INPUTS: dst -- destination in a plane
+ *           src -- bytes written by the host
+ *           n -- number of bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes video memory
+ */
+static void
+default_copy (unsigned char* dst, const unsigned char* src, uint32_t n)
+{
+    (void)memcpy (dst, src, n);
+}
+
+
+/*
+ * vga_emu_set_copy_fn
+ *   DESCRIPTION: Replace the function used to copy host writes into
+ *                each enabled plane.
+ *   INPUTS: fn -- copy function, or NULL to restore memcpy
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+vga_emu_set_copy_fn (void (*fn) (unsigned char*, const unsigned char*,
+				 uint32_t))
+{
+    copy_fn = (NULL == fn ? default_copy : fn);
+}
+
+
+/*
+ * monotonic_now
+ *   DESCRIPTION: Default clock for display timing.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: CLOCK_MONOTONIC time in nanoseconds
+ *   SIDE EFFECTS: none
+ */
+static uint64_t
+monotonic_now ()
+{
+    struct timespec ts; /* current time */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/*
+ * vga_emu_set_clock
+ *   DESCRIPTION: Replace the clock from which display timing is derived,
+ *                and the length of a frame on that clock.
+ *   INPUTS: now_ns -- clock returning nanoseconds, or NULL to restore
+ *                     CLOCK_MONOTONIC
+ *           frame -- length of a frame in nanoseconds, or 0 to restore
+ *                    VGA_EMU_FRAME_NS
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+vga_emu_set_clock (uint64_t (*now_ns) (void), uint64_t frame)
+{
+    now_fn = (NULL == now_ns ? monotonic_now : now_ns);
+    frame_ns = (0 == frame ? VGA_EMU_FRAME_NS : frame);
+}
+
+
+/*
+ * vga_emu_watch_display
+ *   DESCRIPTION: Start or stop keeping track of the start address read
+ *                by the CRTC at each vertical retrace, and counting the
+ *                writes into the rows that it shows.  Starting clears
+ *                the count and takes the current start address as read.
+ *   INPUTS: on -- non-zero to start, 0 to stop
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: reads the clock before every later register and memory
+ *                 write while watching
+ */
+void
+vga_emu_watch_display (int on)
+{
+    watching = 0;
+    if (on) {
+	latch_start ();
+	shown_start = vga_emu_start_addr ();
+	shown_writes = 0;
+	watching = 1;
+    }
+}
+
+
+/*
+ * vga_emu_shown_writes
+ *   DESCRIPTION: Get the number of memory writes into rows on display
+ *                since vga_emu_watch_display started watching.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the number of writes
+ *   SIDE EFFECTS: none
+ */
+unsigned long
+vga_emu_shown_writes ()
+{
+    return shown_writes;
+}
+
+
+/*
+ * latch_start
+ *   DESCRIPTION: Bring the start address read by the CRTC up to date: if
+ *                a vertical retrace has begun since the clock was last
+ *                checked, the CRTC has read the registers as they are
+ *                now, since every write to them checks the clock first.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: may change the start address on display
+ */
+static void
+latch_start ()
+{
+    uint64_t vrs = frame_ns * VGA_EMU_VRS_LINE / VGA_EMU_FRAME_LINES;
+    uint64_t n = (vga_emu_now () + frame_ns - vrs) / frame_ns;
+
+    if (n != retraces) {
+	retraces = n;
+	shown_start = vga_emu_start_addr ();
+    }
+}
+
+
+/*
+ * watch_write
+ *   DESCRIPTION: Count a memory write if it reaches the rows on display,
+ *                from the start address read by the CRTC to the line
+ *                compare.
+ *   INPUTS: addr -- offset of first byte written
+ *           n -- number of bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: may count a write into the display
+ */
+static void
+watch_write (uint32_t addr, uint32_t n)
+{
+    uint32_t rows;  /* rows shown above the split screen */
+    uint32_t end;   /* end of the addresses shown        */
+
+    if (!watching || 0 == n)
+	return;
+    latch_start ();
+    rows = (vga_emu_line_compare () + 1) / ((crtc_reg[0x09] & 0x1F) + 1);
+    end = shown_start + rows * crtc_reg[0x13] * 2;
+    if (addr < end && shown_start < addr + n)
+	shown_writes++;
+}
+
+
+/*
+ * vga_emu_now
+ *   DESCRIPTION: Read the clock from which display timing is derived.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: time in nanoseconds
+ *   SIDE EFFECTS: advances a simulated clock, if one is installed
+ */
+uint64_t
+vga_emu_now ()
+{
+    return (*now_fn) ();
+}
+
+
+/*
+ * vga_emu_reset
+ *   DESCRIPTION: Clear video memory and all registers.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: discards all emulated VGA state
+ */
+void
+vga_emu_reset ()
+{
+    memset (vram, 0, sizeof (vram));
+    memset (seq_reg, 0, sizeof (seq_reg));
+    memset (crtc_reg, 0, sizeof (crtc_reg));
+    memset (gfx_reg, 0, sizeof (gfx_reg));
+    memset (attr_reg, 0, sizeof (attr_reg));
+    memset (latch, 0, sizeof (latch));
+    memset (dac, 0, sizeof (dac));
+    seq_idx = crtc_idx = gfx_idx = attr_idx = 0;
+    attr_is_data = 0;
+    misc_out = 0;
+    dac_w_idx = dac_w_comp = dac_r_idx = dac_r_comp = 0;
+}
+
+
+/*
+ * vga_emu_outb
+ *   DESCRIPTION: Write a byte to an emulated VGA port.
+ *   INPUTS: port -- port number (0x3C0 through 0x3DA)
+ *           val -- value written
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates the register file; writes to unmodeled ports
+ *                 are ignored
+ */
+void
+vga_emu_outb (uint16_t port, uint8_t val)
+{
+    switch (port) {
+	case 0x03C0:
+	    /* Attribute controller alternates between index and data. */
+	    if (attr_is_data) {
+		attr_reg[attr_idx % NUM_ATTR_REGS] = val;
+	    } else {
+		attr_idx = (val & 0x1F);
+	    }
+	    attr_is_data = !attr_is_data;
+	    break;
+	case 0x03C2: misc_out = val; break;
+	case 0x03C4: seq_idx = (val % NUM_SEQ_REGS); break;
+	case 0x03C5: seq_reg[seq_idx] = val; break;
+	case 0x03C7: dac_r_idx = val; dac_r_comp = 0; break;
+	case 0x03C8: dac_w_idx = val; dac_w_comp = 0; break;
+	case 0x03C9:
+	    dac[dac_w_idx][dac_w_comp] = (val & 0x3F);
+	    if (3 == ++dac_w_comp) {
+		dac_w_comp = 0;
+		dac_w_idx++;
+	    }
+	    break;
+	case 0x03CE: gfx_idx = (val % NUM_GFX_REGS); break;
+	case 0x03CF: gfx_reg[gfx_idx] = val; break;
+	case 0x03D4: crtc_idx = (val % NUM_CRTC_REGS); break;
+	case 0x03D5:
+	    if (watching)
+		latch_start ();
+	    crtc_reg[crtc_idx] = val;
+	    break;
+	default: break;
+    }
+}
+
+
+/*
+ * vga_emu_outw
+ *   DESCRIPTION: Write two bytes to two consecutive emulated VGA ports,
+ *                as the OUTW instruction does (index in the low byte,
+ *                data in the high byte).
+ *   INPUTS: port -- first port number
+ *           val -- low byte goes to port, high byte to port + 1
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates the register file
+ */
+void
+vga_emu_outw (uint16_t port, uint16_t val)
+{
+    vga_emu_outb (port, val & 0xFF);
+    vga_emu_outb (port + 1, val >> 8);
+}
+
+
+/*
+ * vga_emu_inb
+ *   DESCRIPTION: Read a byte from an emulated VGA port.
+ *   INPUTS: port -- port number
+ *   OUTPUTS: none
+ *   RETURN VALUE: register value, or 0xFF for unmodeled ports
+ *   SIDE EFFECTS: reading 0x3DA resets the attribute flip-flop and
+ *                 reads the display timing clock; reading 0x3C9 
+ *                 advances the DAC read index
+ */
+uint8_t
+vga_emu_inb (uint16_t port)
+{
+    uint8_t  val;
+    uint64_t line; /* current scan line for input status #1 */
+
+    switch (port) {
+	case 0x03C1: return attr_reg[attr_idx % NUM_ATTR_REGS];
+	case 0x03C5: return seq_reg[seq_idx];
+	case 0x03C9:
+	    val = dac[dac_r_idx][dac_r_comp];
+	    if (3 == ++dac_r_comp) {
+		dac_r_comp = 0;
+		dac_r_idx++;
+	    }
+	    return val;
+	case 0x03CC: return misc_out;
+	case 0x03CF: return gfx_reg[gfx_idx];
+	case 0x03D5: return crtc_reg[crtc_idx];
+	case 0x03DA:
+	    attr_is_data = 0;
+	    line = (vga_emu_now () % frame_ns) * VGA_EMU_FRAME_LINES / frame_ns;
+	    val = 0;
+	    if (VGA_EMU_BLANK_LINE <= line)
+		val |= 0x01; /* display disabled */
+	    if (VGA_EMU_VRS_LINE <= line && VGA_EMU_VRE_LINE > line)
+		val |= 0x08; /* vertical retrace */
+	    return val;
+	default: return 0xFF;
+    }
+}
+
+
+/*
+ * vga_emu_read
+ *   DESCRIPTION: Read a byte from the video memory window.  The byte at
+ *                the address in every plane is loaded into the latches,
+ *                and the byte from the plane selected by the graphics
+ *                read map select register (0x04) is returned.
+ *   INPUTS: addr -- offset of the byte from the start of the window
+ *   OUTPUTS: none
+ *   RETURN VALUE: byte read, or 0xFF beyond the window
+ *   SIDE EFFECTS: loads the latches
+ */
+uint8_t
+vga_emu_read (uint32_t addr)
+{
+    int p;	/* loop index over planes */
+
+    if (VGA_EMU_PLANE_SIZE <= addr)
+	return 0xFF;
+    for (p = 0; p < 4; p++)
+	latch[p] = vram[p][addr];
+    return latch[gfx_reg[4] & 3];
+}
+
+
+/*
+ * vga_emu_write
+ *   DESCRIPTION: Write a sequence of bytes into the video memory window.
+ *                In write mode 0, each byte is stored at the same address
+ *                in every plane enabled by the sequencer map mask.  In
+ *                write mode 1, the latches are stored instead, and the
+ *                values of the bytes are ignored.
+ *   INPUTS: addr -- offset of first byte from the start of the window
+ *           src -- bytes to write
+ *           n -- number of bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes video memory; bytes beyond the window are dropped
+ */
+void
+vga_emu_write (uint32_t addr, const unsigned char* src, uint32_t n)
+{
+    int p;	/* loop index over planes */
+
+    if (VGA_EMU_PLANE_SIZE <= addr)
+	return;
+    if (VGA_EMU_PLANE_SIZE - addr < n)
+	n = VGA_EMU_PLANE_SIZE - addr;
+    watch_write (addr, n);
+    for (p = 0; p < 4; p++) {
+	if (0 == (seq_reg[2] & (1 << p)))
+	    continue;
+	if (1 == (gfx_reg[5] & 3))
+	    memset (&vram[p][addr], latch[p], n);
+	else
+	    (*copy_fn) (&vram[p][addr], src, n);
+    }
+}
+
+
+/*
+ * vga_emu_fill
+ *   DESCRIPTION: Fill part of the video memory window with a byte value,
+ *                respecting the sequencer map mask.
+ *   INPUTS: addr -- offset of first byte from the start of the window
+ *           val -- value to write
+ *           n -- number of bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes video memory; bytes beyond the window are dropped
+ */
+void
+vga_emu_fill (uint32_t addr, unsigned char val, uint32_t n)
+{
+    int p;	/* loop index over planes */
+
+    if (VGA_EMU_PLANE_SIZE <= addr)
+	return;
+    if (VGA_EMU_PLANE_SIZE - addr < n)
+	n = VGA_EMU_PLANE_SIZE - addr;
+    watch_write (addr, n);
+    for (p = 0; p < 4; p++) {
+	if (seq_reg[2] & (1 << p))
+	    memset (&vram[p][addr], val, n);
+    }
+}
+
+
+/*
+ * vga_emu_start_addr
+ *   DESCRIPTION: Get the display start address (CRTC 0x0C/0x0D).
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: start address
+ *   SIDE EFFECTS: none
+ */
+uint16_t
+vga_emu_start_addr ()
+{
+    return ((crtc_reg[0x0C] << 8) | crtc_reg[0x0D]);
+}
+
+
+/*
+ * vga_emu_line_compare
+ *   DESCRIPTION: Get the 10-bit line compare value, which is split
+ *                across CRTC registers 0x18, 0x07 (bit 4), and 0x09
+ *                (bit 6).
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: scan line after which display restarts at address 0
+ *   SIDE EFFECTS: none
+ */
+uint16_t
+vga_emu_line_compare ()
+{
+    return (crtc_reg[0x18] | (((crtc_reg[0x07] >> 4) & 1) << 8) |
+	    (((crtc_reg[0x09] >> 6) & 1) << 9));
+}
+
+
+/*
+ * vga_emu_pixel_pan
+ *   DESCRIPTION: Get the attribute controller's horizontal pixel panning
+ *                register (0x13).  In 256-color modes, the number of
+ *                pixels shifted is half of the register value.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: horizontal pixel panning register value
+ *   SIDE EFFECTS: none
+ */
+uint8_t
+vga_emu_pixel_pan ()
+{
+    return (attr_reg[0x13] & 0x0F);
+}
+
+
+/*
+ * vga_emu_map_mask
+ *   DESCRIPTION: Get the sequencer map mask (planes enabled for writes).
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: map mask in bits 0-3
+ *   SIDE EFFECTS: none
+ */
+uint8_t
+vga_emu_map_mask ()
+{
+    return (seq_reg[2] & 0x0F);
+}
+
+
+/*
+ * vga_emu_plane
+ *   DESCRIPTION: Get read access to one plane of video memory.
+ *   INPUTS: plane -- plane number (0-3)
+ *   OUTPUTS: none
+ *   RETURN VALUE: pointer to the VGA_EMU_PLANE_SIZE bytes of the plane
+ *   SIDE EFFECTS: none
+ */
+const unsigned char*
+vga_emu_plane (int plane)
+{
+    return vram[plane & 3];
+}
+
+
+/*
+ * vga_emu_palette
+ *   DESCRIPTION: Get the 6-bit RGB value of a DAC palette entry.
+ *   INPUTS: index -- palette index
+ *   OUTPUTS: rgb -- red, green, and blue intensities (0-63)
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+vga_emu_palette (uint8_t index, uint8_t rgb[3])
+{
+    rgb[0] = dac[index][0];
+    rgb[1] = dac[index][1];
+    rgb[2] = dac[index][2];
+}
+
+
+/*
+ * vga_emu_render
+ *   DESCRIPTION: Produce the frame seen on the monitor as palette indices.
+ *                Scan lines are generated as the CRTC does: rows start
+ *                at the start address and advance by the offset register
+ *                after each group of (maximum scan line + 1) scan lines.
+ *                After the line compare scan line, the display restarts
+ *                at address 0, and pixel panning is reset if the
+ *                attribute mode control register requests it.
+ *   INPUTS: none
+ *   OUTPUTS: frame -- the visible frame, including the split-screen area
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+vga_emu_render (unsigned char frame[VGA_EMU_Y_DIM][VGA_EMU_X_DIM])
+{
+    uint32_t addr;      /* address of first byte of current row  */
+    int      row_scans; /* scan lines per row                    */
+    int      row_scan;  /* scan line within current row          */
+    int      offset;    /* address difference between rows       */
+    int      lc;        /* line compare scan line                */
+    int      pan;       /* pixel shift from horizontal panning   */
+    int      scan;      /* loop index over scan lines            */
+    int      x, y;      /* loop indices over frame pixels        */
+    int      p;         /* panned pixel position within the row  */
+
+    addr = vga_emu_start_addr ();
+    row_scans = (crtc_reg[0x09] & 0x1F) + 1;
+    offset = crtc_reg[0x13] * 2;
+    lc = vga_emu_line_compare ();
+    pan = ((vga_emu_pixel_pan () >> 1) & 3);
+
+    for (scan = 0, row_scan = 0, y = 0; y < VGA_EMU_Y_DIM; scan++) {
+	/* Emit a frame row on the first scan line of each row. */
+	if (0 == row_scan) {
+	    for (x = 0; x < VGA_EMU_X_DIM; x++) {
+		p = x + pan;
+		frame[y][x] = vram[p & 3][(addr + (p >> 2)) &
+					  (VGA_EMU_PLANE_SIZE - 1)];
+	    }
+	    y++;
+	}
+
+	/* The split screen starts after the line compare scan line. */
+	if (scan == lc) {
+	    addr = 0;
+	    row_scan = 0;
+	    if (attr_reg[0x10] & 0x20)
+		pan = 0;
+	    continue;
+	}
+
+	if (row_scans == ++row_scan) {
+	    row_scan = 0;
+	    addr += offset;
+	}
+    }
+}
+
+
+/*
+ * vga_emu_write_ppm
+ *   DESCRIPTION: Render the visible frame and write it as a binary PPM
+ *                image, converting 6-bit DAC colors to 8 bits.
+ *   INPUTS: fname -- name of the output file
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, -1 on failure
+ *   SIDE EFFECTS: creates or overwrites the file
+ */
+int
+vga_emu_write_ppm (const char* fname)
+{
+    static unsigned char frame[VGA_EMU_Y_DIM][VGA_EMU_X_DIM];
+    FILE*         out;    /* output file                  */
+    unsigned char rgb[3]; /* 8-bit color of one pixel     */
+    uint8_t*      c;      /* 6-bit DAC color of one pixel */
+    int           x, y;   /* loop indices over pixels     */
+    int           i;      /* loop index over components   */
+
+    vga_emu_render (frame);
+    if (NULL == (out = fopen (fname, "wb"))) {
+	perror ("open PPM output");
+	return -1;
+    }
+    fprintf (out, "P6\n%d %d\n255\n", VGA_EMU_X_DIM, VGA_EMU_Y_DIM);
+    for (y = 0; y < VGA_EMU_Y_DIM; y++) {
+	for (x = 0; x < VGA_EMU_X_DIM; x++) {
+	    c = dac[frame[y][x]];
+	    for (i = 0; i < 3; i++)
+		rgb[i] = ((c[i] << 2) | (c[i] >> 4));
+	    if (1 != fwrite (rgb, sizeof (rgb), 1, out)) {
+		(void)fclose (out);
+		return -1;
+	    }
+	}
+    }
+    return (0 == fclose (out) ? 0 : -1);
+}
@@ -0,0 +1,98 @@
+/*									tab:8
+ *
+ * vga_emu.h - header file for the software VGA device model
+ *
+ * Filename:	    vga_emu.h
+ * History:
+ *	1	First written.  Models the subset of the VGA used by the
+ *		mode X code so that it can run without video hardware.
+ */
+
+#ifndef VGA_EMU_H
+#define VGA_EMU_H
+
+
+#include <stdint.h>
+
+
+/*
+ * The model keeps four 64kB planes (256kB of planar video memory) and
+ * a register file for the sequencer, CRTC, graphics, and attribute
+ * controllers plus the DAC palette.  Port writes made by modex.c land
+ * in the register file; writes into the 64kB host window at 0xA0000
+ * are routed to the planes selected by the sequencer map mask.
+ *
+ * VGA_EMU_X_DIM and VGA_EMU_Y_DIM give the size of the rendered frame,
+ * which includes the split-screen status bar below the line compare.
+ */
+#define VGA_EMU_PLANE_SIZE  65536
+#define VGA_EMU_X_DIM       320
+#define VGA_EMU_Y_DIM       200
+
+/*
+ * Display timing of mode X: 449 scan lines per frame at about 70 Hz,
+ * with vertical blanking from scan line 400 and vertical retrace
+ * (the sync pulse reported by bit 3 of input status #1) on scan lines
+ * 412 and 413.
+ */
+#define VGA_EMU_FRAME_NS    14268000ULL
+#define VGA_EMU_FRAME_LINES 449
+#define VGA_EMU_BLANK_LINE  400
+#define VGA_EMU_VRS_LINE    412
+#define VGA_EMU_VRE_LINE    414
+
+/* file written by clear_mode_X with the last frame shown in mode X */
+#define VGA_EMU_PPM_FILE    "screen.ppm"
+
+
+/* reset all memory and registers to zero */
+extern void vga_emu_reset (void);
+
+/*
+ * clock used to derive display timing (nanoseconds); defaults to
+ * CLOCK_MONOTONIC, but may be replaced by a simulated clock, with a
+ * frame length other than VGA_EMU_FRAME_NS (0 for the default)
+ */
+extern void vga_emu_set_clock (uint64_t (*now_ns) (void), uint64_t frame);
+extern uint64_t vga_emu_now (void);
+
+/*
+ * keep track of the start address read by the CRTC at each retrace, and
+ * count the memory writes into the rows that it shows (which drawing
+ * synchronized with retrace should never make)
+ */
+extern void vga_emu_watch_display (int on);
+extern unsigned long vga_emu_shown_writes (void);
+
+/* port access */
+extern void vga_emu_outb (uint16_t port, uint8_t val);
+extern void vga_emu_outw (uint16_t port, uint16_t val);
+extern uint8_t vga_emu_inb (uint16_t port);
+
+/*
+ * host writes into the video memory window (offset from 0xA0000); the
+ * copy function used for each plane defaults to memcpy, but may be
+ * replaced with the upload kernel chosen by modex.c
+ */
+extern void vga_emu_set_copy_fn (void (*fn) (unsigned char*,
+					      const unsigned char*, uint32_t));
+extern void vga_emu_write (uint32_t addr, const unsigned char* src,
+			   uint32_t n);
+
+/* host read from the video memory window; loads the latches */
+extern uint8_t vga_emu_read (uint32_t addr);
+extern void vga_emu_fill (uint32_t addr, unsigned char val, uint32_t n);
+
+/* register file and memory inspection */
+extern uint16_t vga_emu_start_addr (void);
+extern uint16_t vga_emu_line_compare (void);
+extern uint8_t vga_emu_pixel_pan (void);
+extern uint8_t vga_emu_map_mask (void);
+extern const unsigned char* vga_emu_plane (int plane);
+extern void vga_emu_palette (uint8_t index, uint8_t rgb[3]);
+
+/* render the visible frame as palette indices, or to a binary PPM file */
+extern void vga_emu_render (unsigned char frame[VGA_EMU_Y_DIM][VGA_EMU_X_DIM]);
+extern int vga_emu_write_ppm (const char* fname);
+
+#endif /* VGA_EMU_H */
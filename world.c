@@ -34,8 +34,13 @@
  */
  
 
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 
 #include "assert.h"
 #include "photo.h"
@@ -44,7 +49,10 @@
 
 /* parameters defined for this file */
 
-/* room identifiers */
+/*
+ * identifiers of the rooms that the game refers to; the world file
+ * describes these and may add others, numbered after them
+ */
 enum {
     R_NONE = -1,
 
@@ -122,10 +130,10 @@ enum {
     R_REM_ICE,		/* the ice fields near rem. sen. lab */
     R_REM_LAB,		/* part of a remote sensing lab      */
 
-    N_ROOMS
+    N_NAMED_ROOMS
 };
 
-/* object identifiers */
+/* identifiers of the objects that the game refers to (likewise) */
 enum {
     O_NONE = -1,
 
@@ -150,7 +158,7 @@ enum {
     O_ROBOT_LIVE,	/* lockpicking robot with new control program */
     O_MIMO_CARD,	/* a MIMO card for planes                     */
 
-    N_OBJECTS
+    N_NAMED_OBJECTS
 };
 
 /* flag identifiers for recording the player's accomplishments */
@@ -179,11 +187,13 @@ enum {
  */
 struct room_t {
     const char* name;		/* name of room                   */
-    photo_t*    view;		/* photo currently shown for room */
+    int32_t     view;		/* photo currently shown for room */
     object_t*   contents; 	/* linked list of objects in room */
     room_t*     left;   	/* room to the "left"             */
     room_t*     enter;  	/* doors, etc.                    */
     room_t*     right;  	/* room to the "right"            */
+    object_t**  by_name;	/* first object with each name id */
+    world_t*    world;		/* world holding the room         */
 };
 
 /*
@@ -197,253 +207,177 @@ struct object_t {
     room_t*      loc;      	/* in what 'room'?                */
     uint16_t     x, y;    	/* location within room photo     */
     image_t*     img;     	/* image for use in room          */
+    int32_t      name_id;	/* interned name (see name_syms)  */
 };
 
 /*
- * This local structure is used to specify room connectivity and data 
- * in a reasonably manageable way.  The array entries in the database
- * specify the room id, name, filename, and connections to other
- * rooms by symbolic name.  Since there are many rooms, trying to
- * keep the order between the enumeration of symbolic names and the
- * array entries can be tricky.  Instead, we associate array entries
- * with specific symbolic names using the id field.  Thus, you can
- * reorder the entries in the room_data array without affecting their
- * meaning.
- */
-typedef struct room_data_t room_data_t;
-struct room_data_t {
-    int32_t           id;	/* id of room being described    */
-    const char* const name;	/* name of room                  */
-    const char* const filename;	/* file name for room photo      */
-    int32_t           left;	/* id of room to 'left'          */
-    int32_t           enter;	/* id of room reached by 'enter' */
-    int32_t           right;	/* id of room to 'right'         */
+ * The state of one game: where every object is, what the player has
+ * done, and which photos are swapped in.  The photos and images belong
+ * to all worlds and are only read, so each world costs just this
+ * structure and the rooms and objects allocated with it.  Each world
+ * draws its own random numbers, so one game's commands never change what
+ * another sees.  Flags are coded as bit vectors using an array of 32-bit
+ * words.  It's overkill for this game, but it's nice not to worry about
+ * the number of flags...
+ */
+#define RNG_STATE_LEN 128 /* bytes of state, as used by rand */
+struct world_t {
+    room_t*   room;                  /* rooms, by room number        */
+    object_t* object;                /* objects, by object number    */
+    uint32_t player_flags[(NUM_FLAGS + 31) / 32]; /* accomplishments */
+    int32_t  swap_photo[N_SWAPS];    /* swapping photos              */
+    struct random_data rng;          /* random number generator      */
+    char     rng_state[RNG_STATE_LEN]; /* state used by rng          */
+    world_status_fn_t show;          /* shows status messages        */
+    void*    show_arg;               /* argument for show            */
 };
 
-/* the room connectivity data */
-static const room_data_t room_data[N_ROOMS] = {
-    /* Area 0: The Backpack */
-    {R_INVENTORY, "Inventory", "images/backpack.photo", 
-                       R_NONE,      R_NONE,      R_NONE},
-
-    /* Area 1: Everitt and Green Street */
-    {R_IN_391LAB, "391 Lab", "images/391lab.photo", 
-                       R_NONE, R_BY_391LAB,      R_NONE},
-    {R_BY_391LAB, "Outside of 391", "images/outside391.photo", 
-                     R_BY_ZAS, R_IN_391LAB,   R_BY_IEEE},
-    {  R_IN_IEEE, "IEEE Office", "images/ieee.photo", 
-                       R_NONE,   R_BY_IEEE,      R_NONE},
-    {  R_BY_IEEE, "Outside IEEE", "images/byieee.photo", 
-                  R_BY_391LAB,   R_IN_IEEE, R_BY_395LAB},
-    {R_IN_395LAB, "395 Lab", "images/395lab.photo", 
-                       R_NONE, R_BY_395LAB,      R_NONE},
-    {R_BY_395LAB, "Outside of 395", "images/outside395.photo", 
-                    R_BY_IEEE,      R_NONE, R_EVT_STAIR},
-    {R_EVT_STAIR, "Everitt Stairs", "images/evtstair.photo", 
-                  R_BY_395LAB, R_EAST_EVRT, R_BY_CLEANR},
-    {R_IN_CLEANR, "In Cleanroom", "images/cleanr.photo", 
-                       R_NONE, R_BY_CLEANR,      R_NONE},
-    {R_BY_CLEANR, "By the Cleanroom", "images/outclean.photo", 
-                  R_EVT_STAIR,      R_NONE, R_EVRT_VEND},
-    {R_EVRT_VEND, "Vending Machine", "images/vend.photo", 
-                  R_BY_CLEANR, R_EVRT_BSMT,      R_NONE},
-    {R_ALMAMATER, "Alma Mater", "images/almamater.photo", 
-                  R_EAST_EVRT, R_EAST_EVRT, R_BY_COCOMR},
-    {R_IN_COCOMR, "Cocomero", "images/incoco.photo", 
-                       R_NONE, R_BY_COCOMR,      R_NONE},
-    {R_BY_COCOMR, "Near Cocomero", "images/bycoco.photo", 
-                  R_ALMAMATER, R_IN_COCOMR,    R_BY_ZAS},
-    {R_BY_ZAS, "The Ruins", "images/ruins.photo", 
-                  R_BY_COCOMR,      R_NONE,      R_NONE},
-    {R_EAST_EVRT, "East of Everitt", "images/eeast.photo", 
-                  R_ALMAMATER, R_EVT_STAIR, R_EVRT_BSMT},
-    {R_EVRT_BSMT, "Basement Entry", "images/basement.photo", 
-                  R_EAST_EVRT, R_EVRT_VEND, R_CIRCLE_SW},
-
-    /* Area 2: Bardeen Quad and Environs */
-    {R_WEST_BONE, "Boneyard Creek", "images/bonew.photo", 
-                  R_CIRCLE_SW,      R_NONE,  R_CIRCLE_N},
-    { R_CIRCLE_N, "Boneyard Bridge", "images/circlen1.photo", 
-                  R_WEST_BONE, R_TALBOT_NW, R_EAST_BONE},
-    {R_CIRCLE_SW, "Boneyard Bridge", "images/circlesw.photo", 
-                  R_EAST_BONE, R_EVRT_BSMT,  R_CIRCLE_N},
-    {R_EAST_BONE, "Boneyard Creek", "images/bonee.photo", 
-                   R_CIRCLE_N,      R_NONE, R_CIRCLE_SW},
-    {  R_BARDEEN, "Bardeen Quad", "images/bardeen.photo", 
-                   R_LIB_BACK, R_EAST_BONE, R_TALBOT_SW},
-    { R_LIB_BACK, "Grainger Library", "images/graingerback.photo", 
-                        R_DCL,   R_RESERVE,   R_BARDEEN},
-    {  R_RESERVE, "Grainger Reserves", "images/reserve.photo", 
-                       R_NONE,  R_LIB_BACK, R_LIB_FRONT},
-    {R_TALBOT_NW, "Talbot Lab", "images/talbotnw.photo", 
-                  R_CIRCLE_SW,    R_TALBOT, R_TALBOT_SW},
-    {R_TALBOT_SW, "Talbot Lab", "images/talbotsw.photo", 
-                  R_TALBOT_NW,    R_TALBOT, R_SPRINGFLD},
-    {   R_TALBOT, "Talbot Lab", "images/talbot.photo", 
-                       R_NONE, R_TALBOT_NW,      R_NONE},
-    {R_SPRINGFLD, "Springfield Avenue", "images/springfield.photo", 
-                  R_TALBOT_SW,   R_CARIBOU,    R_KENNEY},
-    {  R_CARIBOU, "Caribou", "images/caribou.photo", 
-                       R_NONE, R_SPRINGFLD,      R_NONE},
-    {   R_KENNEY, "Kenney Gym", "images/kenney.photo", 
-                  R_SPRINGFLD,      R_NONE,       R_DCL},
-    {      R_DCL, "DCL", "images/dcl.photo", 
-                     R_KENNEY,  R_KENNEY_E, R_LIB_FRONT},
-    {R_LIB_FRONT, "Grainger Library", "images/graingerfront.photo", 
-                        R_DCL,   R_RESERVE, R_TALBOT_SW},
-
-    /* Area 3: CSL and Environs */
-    { R_KENNEY_E, "East of Kenney", "images/kenneye.photo", 
-                        R_DCL,       R_DCL,   R_NEWMARK},
-    {  R_NEWMARK, "Newmark Lab", "images/newmark.photo", 
-                    R_MNTL_NW,      R_NONE,  R_KENNEY_E},
-    {  R_MNTL_NW, "MNTL", "images/mntlnw.photo", 
-                    R_NEWMARK, R_MNTLLOBBY,  R_CSL_VIEW},
-    {  R_MNTL_SW, "MNTL", "images/mntlsw.photo", 
-                    R_MNTL_NW, R_MNTLLOBBY,   R_BECKMAN},
-    {R_MNTLLOBBY, "Lobby of MNTL", "images/mntllobby.photo", 
-                  R_MNTL_LAB1,   R_MNTL_SW, R_MNTL_LAB2},
-    {R_MNTL_LAB1, "Kevin's Lab in MNTL", "images/mntllab1.photo", 
-                       R_NONE,      R_NONE, R_MNTLLOBBY},
-    {R_MNTL_LAB2, "MNTL Laser Lab", "images/mntllab2.photo", 
-                  R_MNTLLOBBY, R_MNTL_LAB3,      R_NONE},
-    {R_MNTL_LAB3, "MNTL Laser Lab", "images/mntllab3.photo", 
-                       R_NONE, R_MNTL_LAB2,      R_NONE},
-    { R_CSL_VIEW, "CSL", "images/csl.photo", 
-                   R_BECK_LOT,  R_CSL_DOOR,   R_MNTL_NW},
-    { R_CSL_DOOR, "CSL Main Entrance", "images/csldoor.photo", 
-                   R_BECK_LOT,      R_NONE,   R_MNTL_NW},
-    {R_CSL_LOBBY, "CSL Lobby", "images/csllobby.photo", 
-                  R_CSL_UPPER,  R_CSL_DOOR,      R_NONE},
-    {R_CSL_UPPER, "Upper Floor of CSL", "images/cslupper.photo", 
-                       R_NONE, R_CSLLOUNGE, R_CSL_LOBBY},
-    {R_CSLLOUNGE, "CSL Lounge", "images/csllounge.photo", 
-                       R_NONE, R_CSL_UPPER,      R_NONE},
-    { R_BECK_LOT, "Beckman Circle Lot", "images/becklot.photo", 
-                    R_BECKMAN,    R_GARAGE,  R_CSL_VIEW},
-    {  R_BECKMAN, "Beckman Institute", "images/beckman.photo", 
-                    R_MNTL_SW, R_BECK_DOOR,  R_BECK_LOT},
-    {R_BECK_DOOR, "Beckman Institute", "images/beckdoor.photo", 
-                    R_MNTL_SW,      R_NONE,  R_BECK_LOT},
-    {R_BECKLOBBY, "Beckman Lobby", "images/becklobby.photo", 
-                       R_NONE,  R_BECK_MRI, R_BECK_DOOR},
-    { R_BECK_MRI, "An MRI Lab", "images/beckmri.photo", 
-                       R_NONE, R_BECKLOBBY,      R_NONE},
+/*
+ * A table of symbols (the ids in the world file, file names, and object
+ * names), each numbered from 0 in the order first seen and found through
+ * an open-addressed hash table that doubles as it fills.  The text of
+ * each symbol is not copied.
+ */
+typedef struct symtab_t symtab_t;
+struct symtab_t {
+    const char** text;		/* text of each symbol, by number   */
+    int32_t      n;		/* number of symbols                */
+    int32_t      cap;		/* length of text array             */
+    int32_t*     slot;		/* symbol number + 1, or 0 if free  */
+    int32_t      n_slots;	/* length of slot (a power of two)  */
+    int32_t      fold;		/* 1 if case is ignored             */
+};
 
-    /* Area 4: The Rest of the World, Featuring the Remote Sensing Lab */
-    {   R_GARAGE, "Campus Parking", "images/garage.photo", 
-                   R_BECK_LOT,  R_CAR_SITE,      R_NONE},
-    { R_CAR_SITE, "Use Someone's Car?", "images/carclosed.photo", 
-                       R_NONE,    R_GARAGE,      R_NONE},
-    { R_ALLERTON, "Allerton Mansion", "images/allerton.photo", 
-                    R_FU_DOGS,      R_NONE, R_SUNSINGER},
-    {  R_FU_DOGS, "Fu Dog Statues", "images/fudogs.photo", 
-                       R_NONE,    R_STATUE,  R_ALLERTON},
-    {   R_STATUE, "A Tall Statue", "images/statue.photo", 
-                       R_NONE,   R_FU_DOGS,      R_NONE},
-    {R_SUNSINGER, "The Sun Singer", "images/sunsinger.photo", 
-                   R_ALLERTON,      R_NONE,      R_NONE},
-    {  R_WILLARD, "Willard Airport", "images/willard.photo", 
-                       R_NONE, R_WILL_SIDE,      R_NONE},
-    {R_WILL_SIDE, "Willard Tower", "images/willardside.photo", 
-                  R_REM_PLANE,      R_NONE,   R_WILLARD},
-    {R_REM_PLANE, "Sensor-Laden Plane", "images/rsenseplane.photo", 
-                    R_COCKPIT,      R_NONE, R_WILL_SIDE},
-    {  R_COCKPIT, "Plane Cockpit", "images/cockpit.photo", 
-                       R_NONE,      R_NONE, R_REM_PLANE},
-    {R_OVER_WILL, "Flying over Willard", "images/overwillard.photo", 
-                       R_NONE,   R_COCKPIT,   R_AIR_RIO},
-    {  R_AIR_RIO, "Rio de Janeiro", "images/riofromair.photo", 
-                  R_OVER_WILL,      R_NONE,   R_REM_ICE},
-    {  R_REM_ICE, "Ice Fields", "images/rsenseice.photo", 
-                    R_AIR_RIO,   R_REM_LAB,      R_NONE},
-    {  R_REM_LAB, "Remote Sensing Lab", "images/rsenselab.photo", 
-                       R_NONE,   R_REM_ICE,      R_NONE}
+/* a room as described by the world file */
+typedef struct room_desc_t room_desc_t;
+struct room_desc_t {
+    const char* name;		/* name of room (NULL until described) */
+    int32_t     view;		/* photo number                        */
+    int32_t     left;		/* room to 'left', or R_NONE           */
+    int32_t     enter;		/* room reached by 'enter', or R_NONE  */
+    int32_t     right;		/* room to 'right', or R_NONE          */
 };
 
-/*
- * This local structure is used to specify object information in a 
- * reasonably manageable way.  The array entries in the database specify 
- * the object id, name, filename, starting room (if any), and starting 
- * location * within that room (if not random).  We use this approach for 
- * the same * reason as with the rooms: to avoid the need to match the 
- * order between the enumeration of symbolic names and the array entries.
- */
-typedef struct obj_data_t obj_data_t;
-struct obj_data_t {
-    int32_t id;			/* object identifier                   */
-    const char* const name;	/* object keyword                      */
-    const char* const filename; /* object image file name              */
-    int32_t room;		/* starting room or R_NONE             */
-    int32_t x;			/* starting x position (-1 for random) */
-    int32_t y;			/* starting y position                 */
+/* an object as described by the world file */
+typedef struct obj_desc_t obj_desc_t;
+struct obj_desc_t {
+    const char* name;		/* object keyword (NULL until described) */
+    int32_t     img;		/* image number                          */
+    int32_t     room;		/* starting room or R_NONE               */
+    int32_t     x;		/* starting x position (-1 for random)   */
+    int32_t     y;		/* starting y position                   */
+    int32_t     name_id;	/* interned name                         */
 };
 
-/* the object positioning data */
-static const obj_data_t obj_data[N_OBJECTS] = {
-    {     O_BOARD, "board", "images/board.obj", R_IN_IEEE, -1, -1},
-    {   O_JETPACK, "jetpack", "images/jetpack.obj", R_TALBOT, -1, -1},
-    {       O_TUX, "tux", "images/tux.obj", R_REM_LAB, 250, 100},
-    {       O_MP2, "mp2", "images/mp2.obj", R_CSLLOUNGE, -1, -1},
-    {    O_BOOK_C, "book", "images/book.obj", R_NONE, -1, -1},
-    { O_BOOK_WODE, "book", "images/book2.obj", R_NONE, -1, -1},
-    {   O_GPS_BAD, "gps", "images/gpsbad.obj", R_TALBOT, -1, -1},
-    {  O_GPS_GOOD, "gps", "images/gpsgood.obj", R_NONE, -1, -1},
-    {  O_GPS_SPEC, "spec", "images/gpsspec.obj", R_CSL_UPPER, -1, -1},
-    { O_BUNNYSUIT, "bunnysuit", "images/bunnysuit.obj", R_ALMAMATER, 230, 250},
-    {O_BATT_EMPTY, "battery", "images/battery.obj", R_NONE, -1, -1},
-    { O_BATT_FULL, "battery", "images/battery.obj", R_NONE, -1, -1},
-    {  O_BATT_CAR, "battery", "images/batteryincar.obj", R_NONE, -1, -1},
-    {   O_MTN_DEW, "dew", "images/dew.obj", R_NONE, -1, -1},
-    {      O_FISH, "fish", "images/fish.obj", R_EAST_BONE, 80, 260},
-    {     O_ICARD, "Icard", "images/icard.obj", R_BARDEEN, -1, -1},
-    {   O_CAR_KEY, "key", "images/key.obj", R_CARIBOU, -1, -1},
-    {O_ROBOT_DEAD, "robot", "images/robot.obj", R_MNTL_LAB3, -1, -1},
-    {O_ROBOT_LIVE, "robot", "images/robot.obj", R_NONE, -1, -1},
-    { O_MIMO_CARD, "mimo", "images/mimo.obj", R_STATUE, -1, -1}
+/* a room photo file, whose pixels are read when the photo is first shown */
+typedef struct photo_file_t photo_file_t;
+struct photo_file_t {
+    photo_t* photo;		/* the photo, or NULL until read */
+    uint32_t width;		/* width of photo in pixels      */
+    uint32_t height;		/* height of photo in pixels     */
 };
 
 /*
- * Some rooms alternate between two photos.  For these rooms, we load the
- * image data for both photos once, but need an extra pointer in order to
- * keep track of the photo currently swapped out.  We use these swap data
- * to name and describe these extra photos.
- */
-typedef struct swap_data_t swap_data_t;
-struct swap_data_t {
-    int32_t id;
-    const char* const filename;
+ * The ids of the rooms, objects, and swap photos named above, which the
+ * world file must describe.  The order must match the enumerations.
+ */
+static const char* const room_id[N_NAMED_ROOMS] = {
+    "R_INVENTORY",
+    "R_IN_391LAB", "R_BY_391LAB", "R_IN_IEEE", "R_BY_IEEE", "R_IN_395LAB",
+    "R_BY_395LAB", "R_EVT_STAIR", "R_IN_CLEANR", "R_BY_CLEANR",
+    "R_EVRT_VEND", "R_ALMAMATER", "R_IN_COCOMR", "R_BY_COCOMR", "R_BY_ZAS",
+    "R_EAST_EVRT", "R_EVRT_BSMT",
+    "R_WEST_BONE", "R_CIRCLE_N", "R_CIRCLE_SW", "R_EAST_BONE", "R_BARDEEN",
+    "R_LIB_BACK", "R_RESERVE", "R_TALBOT_NW", "R_TALBOT_SW", "R_TALBOT",
+    "R_SPRINGFLD", "R_CARIBOU", "R_KENNEY", "R_DCL", "R_LIB_FRONT",
+    "R_KENNEY_E", "R_NEWMARK", "R_MNTL_NW", "R_MNTL_SW", "R_MNTLLOBBY",
+    "R_MNTL_LAB1", "R_MNTL_LAB2", "R_MNTL_LAB3", "R_CSL_VIEW", "R_CSL_DOOR",
+    "R_CSL_LOBBY", "R_CSL_UPPER", "R_CSLLOUNGE", "R_BECK_LOT", "R_BECKMAN",
+    "R_BECK_DOOR", "R_BECKLOBBY", "R_BECK_MRI",
+    "R_GARAGE", "R_CAR_SITE", "R_ALLERTON", "R_FU_DOGS", "R_STATUE",
+    "R_SUNSINGER", "R_WILLARD", "R_WILL_SIDE", "R_REM_PLANE", "R_COCKPIT",
+    "R_OVER_WILL", "R_AIR_RIO", "R_REM_ICE", "R_REM_LAB"
 };
-
-/* the swap photo descriptions */
-static const swap_data_t swap_data[N_SWAPS] = {
-    {SWAP_CIRCLE, "images/circlen2.photo"},	/* alternate for Boneyard */
-    {SWAP_CAR, "images/caropen.photo"}		/* open/closed car photos */
+static const char* const obj_id[N_NAMED_OBJECTS] = {
+    "O_BOARD", "O_JETPACK", "O_TUX", "O_MP2", "O_BOOK_C", "O_BOOK_WODE",
+    "O_GPS_BAD", "O_GPS_GOOD", "O_GPS_SPEC", "O_BUNNYSUIT", "O_BATT_EMPTY",
+    "O_BATT_FULL", "O_BATT_CAR", "O_MTN_DEW", "O_FISH", "O_ICARD",
+    "O_CAR_KEY", "O_ROBOT_DEAD", "O_ROBOT_LIVE", "O_MIMO_CARD"
+};
+static const char* const swap_id[N_SWAPS] = {
+    "SWAP_CIRCLE", "SWAP_CAR"
 };
 
 
 /* functions local to this file--see function headers for details */
 static void do_photo_swap (room_t* r, int32_t which);
 static object_t* find_in_room (const room_t* r, const char* arg);
+static int32_t symbol_slot (const symtab_t* t, const char* s);
+static int32_t find_symbol (symtab_t* t, const char* s, int32_t add);
+static void free_symtab (symtab_t* t);
+static int32_t grow_array (void* a, int32_t* cap, int32_t n, size_t size);
+static void forget_world (void);
+static char* next_word (char** s);
+static char* rest_of_line (char* s);
+static int32_t find_room (const char* id);
+static int32_t find_file (symtab_t* t, void* files, int32_t* cap,
+			  size_t size, const char* fname);
+static int32_t parse_world (char* text, const char* fname);
+static photo_t* get_photo (int32_t idx);
 static void insert_object_at (object_t* o, room_t* r, int32_t x, int32_t y);
 static void insert_object (object_t* o, room_t* r);
-static void move_object_to_inventory (object_t* obj);
+static void move_object_to_inventory (world_t* w, object_t* obj);
 static object_t* obj_special_get (room_t* r, const char* arg);
-static int32_t player_flag_is_set (int32_t fnum);
-static void player_set_flag (int32_t fnum);
+static int32_t player_flag_is_set (const world_t* w, int32_t fnum);
+static void player_set_flag (world_t* w, int32_t fnum);
 static void remove_object (object_t* o);
+static void show_status (world_t* w, const char* s);
+static int32_t world_rand (world_t* w);
 
 
 /* file-scope variables */
-/* 
- * Flags are coded as bit vectors using an array of 32-bit words.  It's 
- * overkill for this game, but it's nice not to worry about the number of 
- * flags...
+
+/*
+ * The world description read by build_world, shared by all worlds.  The
+ * names of rooms and objects and the file names point into the text of
+ * the world file, which is kept.  Room photos are numbered, so that rooms
+ * sharing a photo share its pixels, and each is read when first shown
+ * (only its size is read with the description); object images are read
+ * with the description.
  */
-static room_t   room[N_ROOMS];			     /* rooms                */
-static object_t object[N_OBJECTS];		     /* objects              */
-static uint32_t player_flags[(NUM_FLAGS + 31) / 32]; /* accomplishment flags */
-static photo_t* swap_photo[N_SWAPS];                 /* swapping photos      */
+static char*        world_text;	  /* text of the world file           */
+static size_t       text_bytes;	  /* length of world_text             */
+static symtab_t     room_syms;	  /* room ids                         */
+static room_desc_t* room_desc;	  /* each room, by room number        */
+static int32_t      room_cap;	  /* length of room_desc              */
+static symtab_t     obj_syms;	  /* object ids                       */
+static obj_desc_t*  obj_desc;	  /* each object, by object number    */
+static int32_t      obj_cap;	  /* length of obj_desc               */
+static int32_t*     obj_order;	  /* object numbers, in placing order */
+static int32_t      order_cap;	  /* length of obj_order              */
+static int32_t      n_placed;	  /* objects described so far         */
+static symtab_t     photo_syms;	  /* room photo file names            */
+static photo_file_t* photo;	  /* each photo file                  */
+static int32_t      photo_cap;	  /* length of photo                  */
+static int32_t      photos_read;  /* photos read so far               */
+static symtab_t     image_syms;	  /* object image file names          */
+static image_t**    image;	  /* each object image                */
+static int32_t      image_cap;	  /* length of image                  */
+static int32_t      swap_view[N_SWAPS]; /* photos swapped in later    */
+static uint64_t     load_ns;	  /* time taken by build_world        */
+static uint64_t     prefault_ns;  /* time taken by prefault_world     */
+
+/* Photos may be first shown by the game and drawing threads at once. */
+static pthread_mutex_t photo_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Object names are interned when the world is built: each distinct name
+ * (ignoring case) gets a small id.  Each room keeps the first object in
+ * its contents with each id, so finding an object by name takes time
+ * proportional to the length of the name rather than to the number of
+ * objects in the room.
+ */
+static symtab_t name_syms = {NULL, 0, 0, NULL, 0, 1};
 
 
 /* 
@@ -458,12 +392,12 @@ static photo_t* swap_photo[N_SWAPS];                 /* swapping photos      */
 static void
 do_photo_swap (room_t* r, int32_t which)
 {
-    photo_t* tmp;	/* temporary variable to help with swap */
+    int32_t tmp;	/* temporary variable to help with swap */
 
     /* Swap the photos. */
-    tmp               = r->view;
-    r->view           = swap_photo[which];
-    swap_photo[which] = tmp;
+    tmp                         = r->view;
+    r->view                     = r->world->swap_photo[which];
+    r->world->swap_photo[which] = tmp;
 }
 
 
@@ -480,19 +414,487 @@ do_photo_swap (room_t* r, int32_t which)
 static object_t* 
 find_in_room (const room_t* r, const char* arg)
 {
-    object_t* obj;	/* index over room contents */
+    int32_t id;		/* interned name sought */
+
+    /* No object has a name that was never interned. */
+    if (-1 == (id = find_symbol (&name_syms, arg, 0))) {
+	return NULL;
+    }
+    return r->by_name[id];
+}
 
-    /* Loop over objects in room. */
-    for (obj = r->contents; NULL != obj; obj = obj->next) {
 
-	/* If we find a matching object, return it. */
-        if (0 == strcasecmp (arg, obj->name)) {
-	    return obj;
+/* 
+ * symbol_slot
+ *   DESCRIPTION: Find the slot of the hash table holding a symbol, or the
+ *                free slot in which it would be put.
+ *   INPUTS: t -- the symbol table (with at least one free slot)
+ *           s -- the symbol
+ *   OUTPUTS: none
+ *   RETURN VALUE: index into the hash table
+ *   SIDE EFFECTS: none
+ */
+static int32_t
+symbol_slot (const symtab_t* t, const char* s)
+{
+    uint32_t    hash;	/* FNV-1a hash of symbol */
+    const char* c;	/* index over symbol     */
+    int32_t     slot;	/* index into hash table */
+
+    hash = 2166136261U;
+    for (c = s; '\0' != *c; c++) {
+	hash = (hash ^ (uint8_t)(t->fold ? tolower ((uint8_t)*c) : *c)) *
+	       16777619U;
+    }
+    for (slot = hash & (t->n_slots - 1); 0 != t->slot[slot];
+	 slot = (slot + 1) & (t->n_slots - 1)) {
+	if (0 == (t->fold ? strcasecmp (s, t->text[t->slot[slot] - 1]) :
+		  strcmp (s, t->text[t->slot[slot] - 1]))) {
+	    break;
 	}
     }
+    return slot;
+}
 
-    /* No object found: return NULL. */
-    return NULL;
+
+/* 
+ * find_symbol
+ *   DESCRIPTION: Find the number of a symbol, and optionally number a
+ *                symbol not yet seen.
+ *   INPUTS: t -- the symbol table
+ *           s -- the symbol (kept by the table if added)
+ *           add -- 1 to add a new symbol, 0 only to look it up
+ *   OUTPUTS: none
+ *   RETURN VALUE: the symbol's number, or -1 if it has none (and add is
+ *                 0) or if memory runs out
+ *   SIDE EFFECTS: may add the symbol to the table, growing it
+ */
+static int32_t
+find_symbol (symtab_t* t, const char* s, int32_t add)
+{
+    int32_t  slot;	/* index into hash table        */
+    int32_t* grown;	/* doubled hash table           */
+    int32_t  n_grown;	/* length of grown              */
+    int32_t  idx;	/* index over symbols to rehash */
+
+    if (0 != t->n_slots && 0 != t->slot[slot = symbol_slot (t, s)]) {
+	return t->slot[slot] - 1;
+    }
+    if (!add) {
+	return -1;
+    }
+
+    /* Keep the table no more than half full. */
+    if (t->n_slots < 2 * (t->n + 1)) {
+	n_grown = (0 == t->n_slots ? 64 : 2 * t->n_slots);
+	if (NULL == (grown = calloc (n_grown, sizeof (grown[0])))) {
+	    return -1;
+	}
+	free (t->slot);
+	t->slot = grown;
+	t->n_slots = n_grown;
+	for (idx = 0; t->n > idx; idx++) {
+	    t->slot[symbol_slot (t, t->text[idx])] = idx + 1;
+	}
+    }
+    if (!grow_array (&t->text, &t->cap, t->n + 1, sizeof (t->text[0]))) {
+	return -1;
+    }
+    t->text[t->n] = s;
+    t->slot[symbol_slot (t, s)] = ++t->n;
+    return t->n - 1;
+}
+
+
+/* 
+ * free_symtab
+ *   DESCRIPTION: Empty a symbol table.
+ *   INPUTS: t -- the symbol table
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frees the table's arrays (but not the symbols' text)
+ */
+static void
+free_symtab (symtab_t* t)
+{
+    free (t->text);
+    free (t->slot);
+    t->text = NULL;
+    t->slot = NULL;
+    t->n = t->cap = t->n_slots = 0;
+}
+
+
+/* 
+ * grow_array
+ *   DESCRIPTION: Make sure that a dynamically allocated array has room for
+ *                some number of elements, doubling its length as needed.
+ *                New elements are zeroed.
+ *   INPUTS: a -- pointer to the array pointer (NULL for an empty array)
+ *           cap -- pointer to the array length, in elements
+ *           n -- number of elements needed
+ *           size -- size of one element in bytes
+ *   OUTPUTS: *a -- the array, possibly moved
+ *            *cap -- its new length
+ *   RETURN VALUE: 1 on success, or 0 if memory runs out
+ *   SIDE EFFECTS: may reallocate the array
+ */
+static int32_t
+grow_array (void* a, int32_t* cap, int32_t n, size_t size)
+{
+    void**  array = a;	/* the array pointer     */
+    int32_t len;	/* new length of array   */
+    char*   grown;	/* array after realloc   */
+
+    if (n <= *cap) {
+	return 1;
+    }
+    for (len = (0 == *cap ? 64 : *cap); n > len; len *= 2) { }
+    if (NULL == (grown = realloc (*array, len * size))) {
+	return 0;
+    }
+    (void)memset (grown + *cap * size, 0, (len - *cap) * size);
+    *array = grown;
+    *cap = len;
+    return 1;
+}
+
+
+/* 
+ * forget_world
+ *   DESCRIPTION: Free the world description read by build_world, with
+ *                its photos and images.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frees all memory allocated by build_world
+ */
+static void
+forget_world ()
+{
+    int32_t idx; /* index over photos and images */
+
+    for (idx = 0; photo_syms.n > idx; idx++) {
+	free_photo (photo[idx].photo);
+    }
+    for (idx = 0; image_syms.n > idx; idx++) {
+	free_obj_image (image[idx]);
+    }
+    free (photo);
+    free (image);
+    free (room_desc);
+    free (obj_desc);
+    free (obj_order);
+    free (world_text);
+    photo = NULL;
+    image = NULL;
+    room_desc = NULL;
+    obj_desc = NULL;
+    obj_order = NULL;
+    world_text = NULL;
+    photo_cap = image_cap = room_cap = obj_cap = order_cap = 0;
+    n_placed = photos_read = 0;
+    prefault_ns = 0;
+    text_bytes = 0;
+    free_symtab (&room_syms);
+    free_symtab (&obj_syms);
+    free_symtab (&photo_syms);
+    free_symtab (&image_syms);
+    free_symtab (&name_syms);
+}
+
+
+/* 
+ * next_word
+ *   DESCRIPTION: Split the next word (a run of characters other than
+ *                spaces and tabs) from a line.
+ *   INPUTS: s -- pointer to the rest of the line
+ *   OUTPUTS: *s -- the rest of the line after the word
+ *   RETURN VALUE: the word, or NULL at the end of the line
+ *   SIDE EFFECTS: ends the word with a NUL, in place
+ */
+static char*
+next_word (char** s)
+{
+    char* word; /* start of the word */
+
+    for (word = *s; ' ' == *word || '\t' == *word; word++) { }
+    if ('\0' == *word) {
+	return NULL;
+    }
+    for (*s = word; '\0' != **s && ' ' != **s && '\t' != **s; (*s)++) { }
+    if ('\0' != **s) {
+	*(*s)++ = '\0';
+    }
+    return word;
+}
+
+
+/* 
+ * rest_of_line
+ *   DESCRIPTION: Trim spaces and tabs from both ends of the rest of a line.
+ *   INPUTS: s -- the rest of the line
+ *   OUTPUTS: none
+ *   RETURN VALUE: the trimmed text, or NULL if none is left
+ *   SIDE EFFECTS: ends the text with a NUL, in place
+ */
+static char*
+rest_of_line (char* s)
+{
+    char* end; /* end of the text */
+
+    for ( ; ' ' == *s || '\t' == *s; s++) { }
+    for (end = s + strlen (s); s < end && isspace ((uint8_t)end[-1]);
+	 end--) { }
+    *end = '\0';
+    return ('\0' == *s ? NULL : s);
+}
+
+
+/* 
+ * find_room
+ *   DESCRIPTION: Get the number of a room id in the world file, numbering
+ *                it if it has not been seen.
+ *   INPUTS: id -- the room id, or "-" for none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the room number, R_NONE for "-", or -2 if memory runs
+ *                 out
+ *   SIDE EFFECTS: may add the id to room_syms and grow room_desc
+ */
+static int32_t
+find_room (const char* id)
+{
+    int32_t idx; /* the room number */
+
+    if (0 == strcmp (id, "-")) {
+	return R_NONE;
+    }
+    if (-1 == (idx = find_symbol (&room_syms, id, 1)) ||
+	!grow_array (&room_desc, &room_cap, room_syms.n,
+		     sizeof (room_desc[0]))) {
+	return -2;
+    }
+    return idx;
+}
+
+
+/* 
+ * find_file
+ *   DESCRIPTION: Get the number of a photo or image file named in the
+ *                world file, numbering it if it has not been seen.
+ *   INPUTS: t -- the file names (photo_syms or image_syms)
+ *           files -- pointer to the array of photos or images
+ *           cap -- pointer to the length of that array
+ *           size -- size of an element of that array
+ *           fname -- the file name
+ *   OUTPUTS: none
+ *   RETURN VALUE: the file number, or -1 if memory runs out
+ *   SIDE EFFECTS: may add the name to t and grow the array
+ */
+static int32_t
+find_file (symtab_t* t, void* files, int32_t* cap, size_t size,
+	   const char* fname)
+{
+    int32_t idx; /* the file number */
+
+    if (-1 == (idx = find_symbol (t, fname, 1)) ||
+	!grow_array (files, cap, t->n, size)) {
+	return -1;
+    }
+    return idx;
+}
+
+
+/* 
+ * parse_world
+ *   DESCRIPTION: Read a world description from the text of a world file
+ *                (see adventure.world for the format) in one pass, filling
+ *                in the room, object, and swap tables and numbering the
+ *                photo and image files.  Rooms may be linked before they
+ *                are described.
+ *   INPUTS: text -- the text of the file
+ *           fname -- name of the file, for error messages
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 on success, or 0 on failure
+ *   SIDE EFFECTS: splits text into words in place; prints error messages
+ *                 to stderr on failure
+ */
+static int32_t
+parse_world (char* text, const char* fname)
+{
+    char*        line;		/* rest of line being read           */
+    char*        next;		/* line after it                     */
+    int32_t      line_no;	/* number of line, from 1            */
+    char*        kind;		/* first word: room, object, or swap */
+    char*        word[5];	/* other words before the name       */
+    char*        name;		/* rest of the line                  */
+    char*        end;		/* end of a position                 */
+    int32_t      n_words;	/* words needed before the name      */
+    int32_t      idx;		/* index over words, or an id number */
+    int32_t      link[4];	/* rooms left, entered, right, photo */
+    long         pos[2];	/* position of an object             */
+    room_desc_t* r;		/* room described                    */
+    obj_desc_t*  o;		/* object described                  */
+
+    for (line_no = 1, line = text; '\0' != *line; line_no++, line = next) {
+
+	/* Split off the line and its first word; skip comments. */
+	if (NULL != (next = strchr (line, '\n'))) {
+	    *next++ = '\0';
+	} else {
+	    next = line + strlen (line);
+	}
+	if (NULL == (kind = next_word (&line)) || '#' == *kind) {
+	    continue;
+	}
+
+	/* Split off the words before the name. */
+	if (0 == strcmp (kind, "room") || 0 == strcmp (kind, "object")) {
+	    n_words = 5;
+	} else if (0 == strcmp (kind, "swap")) {
+	    n_words = 2;
+	} else {
+	    fprintf (stderr, "%s:%d: unknown line type %s\n", fname, line_no,
+		     kind);
+	    return 0;
+	}
+	for (idx = 0; n_words > idx; idx++) {
+	    if (NULL == (word[idx] = next_word (&line))) {
+		fprintf (stderr, "%s:%d: %s line too short\n", fname,
+			 line_no, kind);
+		return 0;
+	    }
+	}
+	if (NULL == (name = rest_of_line (line)) && 5 == n_words) {
+	    fprintf (stderr, "%s:%d: %s %s has no name\n", fname, line_no,
+		     kind, word[0]);
+	    return 0;
+	}
+
+	if ('s' == *kind) {
+
+	    /* swap <id> <photo file> */
+	    for (idx = 0; N_SWAPS > idx && 0 != strcmp (word[0], swap_id[idx]);
+		 idx++) { }
+	    if (N_SWAPS == idx || NULL != name) {
+		fprintf (stderr, "%s:%d: bad swap line\n", fname, line_no);
+		return 0;
+	    }
+	    swap_view[idx] = find_file (&photo_syms, &photo, &photo_cap,
+					sizeof (photo[0]), word[1]);
+	    if (-1 == swap_view[idx]) {
+		fprintf (stderr, "%s:%d: out of memory\n", fname, line_no);
+		return 0;
+	    }
+
+	} else if ('r' == *kind) {
+
+	    /* room <id> <left> <enter> <right> <photo file> <name> */
+	    if (R_NONE > (idx = find_room (word[0])) ||
+		R_NONE > (link[0] = find_room (word[1])) ||
+		R_NONE > (link[1] = find_room (word[2])) ||
+		R_NONE > (link[2] = find_room (word[3])) ||
+		-1 == (link[3] = find_file (&photo_syms, &photo, &photo_cap,
+					    sizeof (photo[0]), word[4]))) {
+		fprintf (stderr, "%s:%d: out of memory\n", fname, line_no);
+		return 0;
+	    }
+	    if (R_NONE == idx) {
+		fprintf (stderr, "%s:%d: room has no id\n", fname, line_no);
+		return 0;
+	    }
+	    r = &room_desc[idx];
+	    if (NULL != r->name) {
+		fprintf (stderr, "%s:%d: room %s described twice\n", fname,
+			 line_no, word[0]);
+		return 0;
+	    }
+	    r->name = name;
+	    r->left = link[0];
+	    r->enter = link[1];
+	    r->right = link[2];
+	    r->view = link[3];
+
+	} else {
+
+	    /* object <id> <room> <x> <y> <image file> <name> */
+	    if (-1 == (idx = find_symbol (&obj_syms, word[0], 1)) ||
+		!grow_array (&obj_desc, &obj_cap, obj_syms.n,
+			     sizeof (obj_desc[0])) ||
+		!grow_array (&obj_order, &order_cap, n_placed + 1,
+			     sizeof (obj_order[0])) ||
+		R_NONE > (link[0] = find_room (word[1])) ||
+		-1 == (link[1] = find_file (&image_syms, &image, &image_cap,
+					    sizeof (image[0]), word[4]))) {
+		fprintf (stderr, "%s:%d: out of memory\n", fname, line_no);
+		return 0;
+	    }
+	    o = &obj_desc[idx];
+	    if (NULL != o->name) {
+		fprintf (stderr, "%s:%d: object %s described twice\n", fname,
+			 line_no, word[0]);
+		return 0;
+	    }
+
+	    /* The position is either two dashes or two numbers. */
+	    if (0 == strcmp (word[2], "-") && 0 == strcmp (word[3], "-")) {
+		pos[0] = pos[1] = -1;
+	    } else {
+		pos[0] = strtol (word[2], &end, 10);
+		if ('\0' == *end) {
+		    pos[1] = strtol (word[3], &end, 10);
+		}
+		if ('\0' != *end || 0 > pos[0] || 0 > pos[1] ||
+		    UINT16_MAX < pos[0] || UINT16_MAX < pos[1]) {
+		    fprintf (stderr, "%s:%d: bad position for object %s\n",
+			     fname, line_no, word[0]);
+		    return 0;
+		}
+	    }
+	    o->name = name;
+	    o->room = link[0];
+	    o->x = pos[0];
+	    o->y = pos[1];
+	    o->img = link[1];
+	    obj_order[n_placed++] = idx;
+	}
+    }
+
+    return 1;
+}
+
+
+/* 
+ * get_photo
+ *   DESCRIPTION: Get a room photo by number, reading it the first time it
+ *                is needed.  Any thread may call.
+ *   INPUTS: idx -- the photo number
+ *   OUTPUTS: none
+ *   RETURN VALUE: the photo
+ *   SIDE EFFECTS: may read the photo; panics if it cannot be read
+ */
+static photo_t*
+get_photo (int32_t idx)
+{
+    photo_t* p; /* the photo */
+
+    if (NULL != (p = __atomic_load_n (&photo[idx].photo,
+				      __ATOMIC_ACQUIRE))) {
+	return p;
+    }
+    (void)pthread_mutex_lock (&photo_lock);
+    if (NULL == (p = photo[idx].photo)) {
+	if (NULL == (p = read_photo (photo_syms.text[idx]))) {
+	    fprintf (stderr, "Can't read room photo %s.\n",
+		     photo_syms.text[idx]);
+	    (void)pthread_mutex_unlock (&photo_lock);
+	    PANIC ("can't read room photo");
+	}
+	photos_read++;
+	__atomic_store_n (&photo[idx].photo, p, __ATOMIC_RELEASE);
+    }
+    (void)pthread_mutex_unlock (&photo_lock);
+    return p;
 }
 
 
@@ -523,6 +925,7 @@ insert_object_at (object_t* o, room_t* r, int32_t x, int32_t y)
     o->loc = r;
     o->next = r->contents;
     r->contents = o;
+    r->by_name[o->name_id] = o;
 }
 
 
@@ -548,19 +951,20 @@ insert_object (object_t* o, room_t* r)
 
 
     /* Choose a random x location. */
-    range = photo_width (r->view) - image_width (o->img);
-    xpos = (0 >= range ? 0 : (rand () % range));
+    range = room_photo_width (r) - image_width (o->img);
+    xpos = (0 >= range ? 0 : (world_rand (r->world) % range));
 
     /* Place in the lowest quarter of the roo photo if the object fits... */
-    space = photo_height (r->view);
+    space = room_photo_height (r);
     img_ht = image_height (o->img);
     range = space / 4 - img_ht;
     if (0 >= range) {
 	/* Doesn't fit: try not to let the object fall off the bottom. */
         range = space - img_ht;
-	ypos = (0 >= range ? 0 : (rand () % range));
+	ypos = (0 >= range ? 0 : (world_rand (r->world) % range));
     } else {
-	ypos = (0 >= range ? 0 : (rand () % range) + (3 * space) / 4);
+	ypos = (0 >= range ? 0 : 
+		(world_rand (r->world) % range) + (3 * space) / 4);
     }
 
     /* Now put the object into the room at the chosen location. */
@@ -573,13 +977,14 @@ insert_object (object_t* o, room_t* r)
  *   DESCRIPTION: Move an object into the player's inventory.  Try to 
  *                place objects on a 3x3 grid for clarity, but place
  *                randomly if necessary.
- *   INPUTS: obj -- the object
+ *   INPUTS: w -- the player's world
+ *           obj -- the object
  *   OUTPUTS: none
  *   RETURN VALUE: none
  *   SIDE EFFECTS: takes the object out of its current location
  */
 static void
-move_object_to_inventory (object_t* obj)
+move_object_to_inventory (world_t* w, object_t* obj)
 {
     object_t* conf;	/* loop index over possible conflicts for a space */
     int32_t   x;	/* loop index for 3x3 grid x positions            */
@@ -591,21 +996,21 @@ move_object_to_inventory (object_t* obj)
      */
     for (y = 10; 160 >= y; y += 50) {
         for (x = 10; 210 >= x; x += 100) {
-	    for (conf = room[R_INVENTORY].contents; NULL != conf; 
+	    for (conf = w->room[R_INVENTORY].contents; NULL != conf; 
 	    	 conf = conf->next) {
 	        if (x == conf->x && y == conf->y) {
 		    break;
 		}
 	    }
 	    if (NULL == conf) {
-		insert_object_at (obj, &room[R_INVENTORY], x, y);
+		insert_object_at (obj, &w->room[R_INVENTORY], x, y);
 		return;
 	    }
 	}
     }
 
     /* Give up: place randomly in bottom quarter like a room. */
-    insert_object (obj, &room[R_INVENTORY]);
+    insert_object (obj, &w->room[R_INVENTORY]);
 }
 
 
@@ -623,26 +1028,28 @@ move_object_to_inventory (object_t* obj)
 static object_t*
 obj_special_get (room_t* r, const char* arg)
 {
+    world_t* w = r->world; /* player's world */
+
     /* Get a book from the Grainger reference desk... */
-    if (&room[R_RESERVE] == r && 0 == strcasecmp ("book", arg)) {
+    if (&w->room[R_RESERVE] == r && 0 == strcasecmp ("book", arg)) {
 	/* can only get it once... */
-	if (player_flag_is_set (FLAG_HAS_EATEN)) {
-	    if (NULL == object[O_BOOK_C].loc) {
-		show_status ("You check out the C book.");
-		return &object[O_BOOK_C];
+	if (player_flag_is_set (w, FLAG_HAS_EATEN)) {
+	    if (NULL == w->object[O_BOOK_C].loc) {
+		show_status (w, "You check out the C book.");
+		return &w->object[O_BOOK_C];
 	    }
 	} else {
-	    if (NULL == object[O_BOOK_WODE].loc) {
-		show_status ("Here's a nice Wodehouse collection.");
-		return &object[O_BOOK_WODE];
+	    if (NULL == w->object[O_BOOK_WODE].loc) {
+		show_status (w, "Here's a nice Wodehouse collection.");
+		return &w->object[O_BOOK_WODE];
 	    }
 	}
     }
 
     /* Pick up the car battery... */
-    if (&room[R_CAR_SITE] == r && object[O_BATT_CAR].loc == r) {
-        remove_object (&object[O_BATT_CAR]);
-	return &object[O_BATT_EMPTY];
+    if (&w->room[R_CAR_SITE] == r && w->object[O_BATT_CAR].loc == r) {
+        remove_object (&w->object[O_BATT_CAR]);
+	return &w->object[O_BATT_EMPTY];
     }
 
     /* That's all, folks! */
@@ -653,15 +1060,16 @@ obj_special_get (room_t* r, const char* arg)
 /* 
  * player_flag_is_set
  *   DESCRIPTION: Checks whether the player has accomplished a specified task.
- *   INPUTS: fnum -- the accomplishment identifier (a FLAG_*)
+ *   INPUTS: w -- the player's world
+ *           fnum -- the accomplishment identifier (a FLAG_*)
  *   OUTPUTS: none
  *   RETURN VALUE: 1 if the player has accomplished the task, 0 if not
  *   SIDE EFFECTS: none
  */
 static int32_t
-player_flag_is_set (int32_t fnum)
+player_flag_is_set (const world_t* w, int32_t fnum)
 {
-    return (0 != (player_flags[fnum / 32] & (1UL << (fnum % 32))));
+    return (0 != (w->player_flags[fnum / 32] & (1UL << (fnum % 32))));
 }
 
 
@@ -669,15 +1077,16 @@ player_flag_is_set (int32_t fnum)
  * player_set_flag
  *   DESCRIPTION: Sets the flag indicating that the player has accomplished 
  *                a specified task.
- *   INPUTS: fnum -- the accomplishment identifier (a FLAG_*)
+ *   INPUTS: w -- the player's world
+ *           fnum -- the accomplishment identifier (a FLAG_*)
  *   OUTPUTS: none
  *   RETURN VALUE: none
  *   SIDE EFFECTS: none
  */
 static void
-player_set_flag (int32_t fnum)
+player_set_flag (world_t* w, int32_t fnum)
 {
-    player_flags[fnum / 32] |= (1UL << (fnum % 32));
+    w->player_flags[fnum / 32] |= (1UL << (fnum % 32));
 }
 
 
@@ -694,10 +1103,18 @@ static void
 remove_object (object_t* o)
 {
     object_t** find;	/* loop index over pointers to objects in room */
+    object_t*  same;	/* next object in room with the same name      */
 
     /* Is object already in limbo? */
     if (NULL != o->loc) {
 
+	/* If the room finds the object by name, find the next instead. */
+	if (o == o->loc->by_name[o->name_id]) {
+	    for (same = o->next; NULL != same && o->name_id != same->name_id;
+		 same = same->next);
+	    o->loc->by_name[o->name_id] = same;
+	}
+
 	/* Remove from previous room (with safety check)... */
 	for (find = &o->loc->contents; NULL != *find; find = &(*find)->next) {
 	    if (o == *find) {
@@ -713,6 +1130,45 @@ remove_object (object_t* o)
 }
 
 
+/* 
+ * show_status
+ *   DESCRIPTION: Show a status message to the player of a world.
+ *   INPUTS: w -- the player's world
+ *           s -- the message (up to STATUS_MSG_LEN characters)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: calls the world's status function, if any
+ */
+static void
+show_status (world_t* w, const char* s)
+{
+    if (NULL != w->show) {
+	w->show (w->show_arg, s);
+    }
+}
+
+
+/* 
+ * world_rand
+ *   DESCRIPTION: Draw a random number for a world.  Each world has its
+ *                own generator, which gives the numbers that rand would
+ *                after srand with the same seed, so recorded games play
+ *                the same.
+ *   INPUTS: w -- the world
+ *   OUTPUTS: none
+ *   RETURN VALUE: a number from 0 to RAND_MAX
+ *   SIDE EFFECTS: advances the world's generator
+ */
+static int32_t
+world_rand (world_t* w)
+{
+    int32_t n; /* number drawn */
+
+    (void)random_r (&w->rng, &n);
+    return n;
+}
+
+
 /* 
  * obj_get_x
  *   DESCRIPTION: Get x position of object within containing room.
@@ -817,7 +1273,7 @@ room_name (const room_t* r)
 photo_t*
 room_photo (const room_t* r)
 {
-    return r->view;
+    return get_photo (r->view);
 }
 
 
@@ -832,7 +1288,7 @@ room_photo (const room_t* r)
 uint32_t 
 room_photo_height (const room_t* r)
 {
-    return photo_height (r->view);
+    return photo[r->view].height;
 }
 
 
@@ -847,184 +1303,373 @@ room_photo_height (const room_t* r)
 uint32_t 
 room_photo_width (const room_t* r)
 {
-    return photo_width (r->view);
+    return photo[r->view].width;
 }
 
 
 /* 
  * build_world
- *   DESCRIPTION: Builds and connects the rooms, creates objects, and 
- *                reads in all image data (could be done lazily with 
- *                caching instead).
- *   INPUTS: none
+ *   DESCRIPTION: Reads the description of the world shared by the worlds
+ *                of every game from a world file, checks it, and reads
+ *                the object images; room photos are read when first
+ *                needed.  Any description read before is freed first.
+ *   INPUTS: fname -- name of the world file
  *   OUTPUTS: none
  *   RETURN VALUE: 1 on success, or 0 on failure
  *   SIDE EFFECTS: prints error messages to stderr on failure
  */
 int32_t
-build_world ()
+build_world (const char* fname)
 {
-    int32_t idx;	/* index over data arrays   */
-    int32_t which;	/* id for current data item */
-
-    /* Clear all accomplishment flags. */
-    (void)memset (player_flags, 0, sizeof (player_flags));
-
-    /* Clear room data to enable sanity check for duplication. */
-    (void)memset (room, 0, sizeof (room));
-
-    /* Loop over room data. */
-    for (idx = 0; N_ROOMS > idx; idx++) {
-	
-	/* Set the room id. */
-	which = room_data[idx].id;
+    struct timespec start;	/* time at which loading began */
+    struct timespec done;	/* time at which it ended      */
+    FILE*   in;			/* the world file              */
+    long    len;		/* length of the file          */
+    obj_desc_t* od;		/* object description          */
+    int32_t idx;		/* index over tables           */
+    int32_t ok;			/* 1 if all is well so far     */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &start);
+    forget_world ();
+
+    /* Read the whole file at once, leaving room for a NUL. */
+    if (NULL == (in = fopen (fname, "rb"))) {
+	perror (fname);
+	return 0;
+    }
+    ok = (0 == fseek (in, 0, SEEK_END) && 0 <= (len = ftell (in)) &&
+	  0 == fseek (in, 0, SEEK_SET) &&
+	  NULL != (world_text = malloc (len + 1)) &&
+	  (size_t)len == fread (world_text, 1, len, in));
+    (void)fclose (in);
+    if (!ok) {
+	fprintf (stderr, "Can't read world file %s.\n", fname);
+	return 0;
+    }
+    world_text[len] = '\0';
+    text_bytes = len + 1;
 
-	/* Check for bad and duplicate ids. */
-	if (0 > which || N_ROOMS <= which) {
-	    fputs ("Bad index in room data.\n", stderr);
+    /* Give the ids used by the game their numbers from the enumerations. */
+    for (idx = 0; N_NAMED_ROOMS > idx; idx++) {
+	if (idx != find_room (room_id[idx])) {
+	    fputs ("Out of memory.\n", stderr);
 	    return 0;
 	}
-	if (NULL != room[which].name) {
-	    fprintf (stderr, "Duplicate index %d in room data.\n", which);
-	    return 0;
-	}
-
-	/* Set up the room. */
-        room[which].name = room_data[idx].name;
-	room[which].view = read_photo (room_data[idx].filename);
-	if (NULL == room[which].view) {
-	    fprintf (stderr, "Can't read room photo %s.\n", 
-	    	     room_data[idx].filename);
+    }
+    for (idx = 0; N_NAMED_OBJECTS > idx; idx++) {
+	if (idx != find_symbol (&obj_syms, obj_id[idx], 1) ||
+	    !grow_array (&obj_desc, &obj_cap, obj_syms.n,
+			 sizeof (obj_desc[0]))) {
+	    fputs ("Out of memory.\n", stderr);
 	    return 0;
 	}
-	room[which].contents = NULL;
-	room[which].left  = (R_NONE == room_data[idx].left ? NULL : 
-			     &room[room_data[idx].left]);
-	room[which].enter = (R_NONE == room_data[idx].enter ? NULL : 
-			     &room[room_data[idx].enter]);
-	room[which].right = (R_NONE == room_data[idx].right ? NULL : 
-			     &room[room_data[idx].right]);
+    }
+    for (idx = 0; N_SWAPS > idx; idx++) {
+	swap_view[idx] = -1;
     }
 
-    /* Clear object data to enable sanity check for duplication. */
-    (void)memset (object, 0, sizeof (object));
-
-    /* Loop over object data. */
-    for (idx = 0; N_OBJECTS > idx; idx++) {
-
-	/* Set the object id. */
-	which = obj_data[idx].id;
+    if (!parse_world (world_text, fname)) {
+	return 0;
+    }
 
-	/* Check for bad and duplicate ids. */
-	if (0 > which || N_OBJECTS <= which) {
-	    fputs ("Bad index in object data.\n", stderr);
+    /* Check that everything used was described. */
+    for (idx = 0; room_syms.n > idx; idx++) {
+	if (NULL == room_desc[idx].name) {
+	    fprintf (stderr, "%s: room %s is not described\n", fname,
+		     room_syms.text[idx]);
 	    return 0;
 	}
-	if (NULL != object[which].name) {
-	    fprintf (stderr, "Duplicate index %d in object data.\n", which);
+    }
+    for (idx = 0; N_NAMED_OBJECTS > idx; idx++) {
+	if (NULL == obj_desc[idx].name) {
+	    fprintf (stderr, "%s: object %s is not described\n", fname,
+		     obj_id[idx]);
 	    return 0;
 	}
-
-	/* Set up the object. */
-        object[which].name = obj_data[idx].name;
-	object[which].img = read_obj_image (obj_data[idx].filename);
-	if (NULL == object[which].img) {
-	    fprintf (stderr, "Can't read object photo %s.\n", 
-	    	     obj_data[idx].filename);
+    }
+    for (idx = 0; N_SWAPS > idx; idx++) {
+	if (-1 == swap_view[idx]) {
+	    fprintf (stderr, "%s: swap %s is not described\n", fname,
+		     swap_id[idx]);
 	    return 0;
 	}
-        object[which].next = NULL;
-        object[which].loc = NULL;
-        object[which].x = 0;
-        object[which].y = 0;
-
-	/* Insert it into a room if necessary. */
-	if (R_NONE != obj_data[idx].room) {
-	    if (-1 != obj_data[idx].x) {
-	        insert_object_at (&object[which], &room[obj_data[idx].room],
-				  obj_data[idx].x, obj_data[idx].y);
-	    } else {
-	        insert_object (&object[which], &room[obj_data[idx].room]);
-	    }
-	}
     }
 
-    /* Clear swap photo data to enable sanity check for duplication. */
-    (void)memset (swap_photo, 0, sizeof (swap_photo));
-
-    /* Loop over swap photo data. */
-    for (idx = 0; N_SWAPS > idx; idx++) {
-
-	/* Set the swap photo id. */
-	which = swap_data[idx].id;
-
-	/* Check for bad and duplicate ids. */
-	if (0 > which || N_SWAPS <= which) {
-	    fputs ("Bad index in swap data.\n", stderr);
+    /* Photos are read later; read their sizes, to check that they can be. */
+    for (idx = 0; photo_syms.n > idx; idx++) {
+	if (!read_photo_size (photo_syms.text[idx], &photo[idx].width,
+			      &photo[idx].height)) {
+	    fprintf (stderr, "Can't read room photo %s.\n",
+		     photo_syms.text[idx]);
 	    return 0;
 	}
-	if (NULL != swap_photo[which]) {
-	    fprintf (stderr, "Duplicate index %d in swap data.\n", which);
+    }
+
+    /* Read in the object images. */
+    for (idx = 0; image_syms.n > idx; idx++) {
+	if (NULL == (image[idx] = read_obj_image (image_syms.text[idx]))) {
+	    fprintf (stderr, "Can't read object photo %s.\n",
+		     image_syms.text[idx]);
 	    return 0;
 	}
+    }
 
-	/* Read in the swap photo. */
-	swap_photo[which] = read_photo (swap_data[idx].filename);
-	if (NULL == swap_photo[which]) {
-	    fprintf (stderr, "Can't read room photo %s.\n", 
-	    	     swap_data[idx].filename);
+    /* Intern the object names. */
+    for (idx = 0; n_placed > idx; idx++) {
+	od = &obj_desc[obj_order[idx]];
+	if (-1 == (od->name_id = find_symbol (&name_syms, od->name, 1))) {
+	    fputs ("Out of memory.\n", stderr);
 	    return 0;
 	}
     }
 
+    (void)clock_gettime (CLOCK_MONOTONIC, &done);
+    load_ns = (done.tv_sec - start.tv_sec) * 1000000000ULL +
+	      done.tv_nsec - start.tv_nsec;
+
     /* Everything worked! */
     return 1;
 }
 
 
+/* 
+ * new_world
+ *   DESCRIPTION: Start a new game: build and connect the rooms and put
+ *                the objects in their starting places, as described by
+ *                the world file read by build_world.
+ *   INPUTS: seed -- random seed for the game (objects are placed, and
+ *                   the game plays, as rand would after srand (seed))
+ *           show -- function to show status messages, or NULL for none
+ *           arg -- argument passed to show with each message
+ *   OUTPUTS: none
+ *   RETURN VALUE: the new world, or NULL if memory runs out
+ *   SIDE EFFECTS: dynamically allocates memory for the world
+ */
+world_t*
+new_world (unsigned int seed, world_status_fn_t show, void* arg)
+{
+    world_t*     w;		/* the new world                */
+    object_t**   by_name;	/* rooms' objects by name id    */
+    room_t*      r;		/* room being set up            */
+    object_t*    o;		/* object being placed          */
+    room_desc_t* rd;		/* description of room          */
+    obj_desc_t*  od;		/* description of object        */
+    int32_t      idx;		/* index over rooms and objects */
+
+    /* The rooms, objects, and rooms' name tables follow the world. */
+    if (NULL == (w = calloc (1, world_size ()))) {
+	return NULL;
+    }
+    w->room = (room_t*)(w + 1);
+    w->object = (object_t*)(w->room + room_syms.n);
+    by_name = (object_t**)(w->object + obj_syms.n);
+    (void)initstate_r (seed, w->rng_state, sizeof (w->rng_state), &w->rng);
+    w->show = show;
+    w->show_arg = arg;
+
+    /* Set up the rooms. */
+    for (idx = 0; room_syms.n > idx; idx++) {
+	r = &w->room[idx];
+	rd = &room_desc[idx];
+        r->name = rd->name;
+	r->view = rd->view;
+	r->world = w;
+	r->by_name = by_name + idx * name_syms.n;
+	r->left  = (R_NONE == rd->left ? NULL : &w->room[rd->left]);
+	r->enter = (R_NONE == rd->enter ? NULL : &w->room[rd->enter]);
+	r->right = (R_NONE == rd->right ? NULL : &w->room[rd->right]);
+    }
+
+    /* Set up the objects, inserting each into a room if necessary. */
+    for (idx = 0; n_placed > idx; idx++) {
+	o = &w->object[obj_order[idx]];
+	od = &obj_desc[obj_order[idx]];
+        o->name = od->name;
+	o->name_id = od->name_id;
+	o->img = image[od->img];
+	if (R_NONE != od->room) {
+	    if (-1 != od->x) {
+	        insert_object_at (o, &w->room[od->room], od->x, od->y);
+	    } else {
+	        insert_object (o, &w->room[od->room]);
+	    }
+	}
+    }
+
+    /* Photos not yet swapped in. */
+    (void)memcpy (w->swap_photo, swap_view, sizeof (w->swap_photo));
+    return w;
+}
+
+
+/* 
+ * free_world
+ *   DESCRIPTION: End a game, freeing its world (but not the photos and
+ *                images, which other worlds share).
+ *   INPUTS: w -- the world (may be NULL)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frees the world
+ */
+void
+free_world (world_t* w)
+{
+    free (w);
+}
+
+
+/* 
+ * world_size
+ *   DESCRIPTION: Get the memory used by each world.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes allocated for one world
+ *   SIDE EFFECTS: none
+ */
+size_t
+world_size ()
+{
+    return (sizeof (world_t) + room_syms.n * sizeof (room_t) +
+	    obj_syms.n * sizeof (object_t) +
+	    (size_t)room_syms.n * name_syms.n * sizeof (object_t*));
+}
+
+
 /* 
  * start_in_room
  *   DESCRIPTION: Get a pointer to the room in which the player begins 
  *                the game.
- *   INPUTS: none
+ *   INPUTS: w -- the player's world
  *   OUTPUTS: none
  *   RETURN VALUE: pointer to the starting room
  *   SIDE EFFECTS: none
  */
 room_t*
-start_in_room ()
+start_in_room (world_t* w)
+{
+    return &w->room[R_EAST_EVRT];
+}
+
+
+/* 
+ * get_room
+ *   DESCRIPTION: Get a room by number, so that benchmarks can visit every
+ *                room in the world.
+ *   INPUTS: w -- the world
+ *           idx -- number of the room, from 0
+ *   OUTPUTS: none
+ *   RETURN VALUE: pointer to the room, or NULL if there is no such room
+ *   SIDE EFFECTS: none
+ */
+room_t*
+get_room (world_t* w, int32_t idx)
 {
-    return &room[R_EAST_EVRT];
+    if (0 > idx || room_syms.n <= idx) {
+	return NULL;
+    }
+    return &w->room[idx];
+}
+
+
+/* 
+ * prefault_world
+ *   DESCRIPTION: Read every room photo not yet read (including those
+ *                swapped out of view) and fault in its pixels and those
+ *                of every object image, so that entering a room never
+ *                waits on the disk or on a page fault.  The time taken
+ *                is recorded for get_world_stats.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes of pixel data touched
+ *   SIDE EFFECTS: may read photos and fault pages in; panics if a photo
+ *                 cannot be read
+ */
+size_t
+prefault_world ()
+{
+    struct timespec start; /* time at which reading began */
+    struct timespec done;  /* time at which it ended      */
+    size_t bytes = 0;      /* pixel data touched          */
+    int32_t idx;           /* index over photos/images    */
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &start);
+    for (idx = 0; photo_syms.n > idx; idx++) {
+	bytes += prefault_photo (get_photo (idx));
+    }
+    for (idx = 0; image_syms.n > idx; idx++) {
+	bytes += prefault_image (image[idx]);
+    }
+    (void)clock_gettime (CLOCK_MONOTONIC, &done);
+    prefault_ns += (done.tv_sec - start.tv_sec) * 1000000000ULL +
+		   done.tv_nsec - start.tv_nsec;
+    return bytes;
+}
+
+
+/* 
+ * get_world_stats
+ *   DESCRIPTION: Get the size of the world description read by
+ *                build_world, the time taken to read it (and to read
+ *                the photos ahead with prefault_world), and the memory
+ *                that it and each world use.
+ *   INPUTS: none
+ *   OUTPUTS: s -- the statistics
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void
+get_world_stats (world_stats_t* s)
+{
+    s->rooms = room_syms.n;
+    s->objects = obj_syms.n;
+    s->names = name_syms.n;
+    s->photos = photo_syms.n;
+    s->photos_read = __atomic_load_n (&photos_read, __ATOMIC_RELAXED);
+    s->images = image_syms.n;
+    s->load_ns = load_ns;
+    s->prefault_ns = prefault_ns;
+    s->file_bytes = (0 == text_bytes ? 0 : text_bytes - 1);
+
+    /* Memory held by the description, not counting pixels. */
+    s->shared_bytes = text_bytes +
+	room_cap * sizeof (room_desc[0]) + obj_cap * sizeof (obj_desc[0]) +
+	order_cap * sizeof (obj_order[0]) + photo_cap * sizeof (photo[0]) +
+	image_cap * sizeof (image[0]) +
+	(room_syms.cap + obj_syms.cap + photo_syms.cap + image_syms.cap +
+	 name_syms.cap) * sizeof (const char*) +
+	(room_syms.n_slots + obj_syms.n_slots + photo_syms.n_slots +
+	 image_syms.n_slots + name_syms.n_slots) * sizeof (int32_t);
+    s->world_bytes = world_size ();
 }
 
 
 /* 
  * player_has_board
  *   DESCRIPTION: Check whether the player has the board in inventory.
- *   INPUTS: none
+ *   INPUTS: w -- the player's world
  *   OUTPUTS: none
  *   RETURN VALUE: 1 if the board is in inventory, 0 if not
  *   SIDE EFFECTS: none
  */
 int32_t
-player_has_board ()
+player_has_board (const world_t* w)
 {
-    return (&room[R_INVENTORY] == object[0].loc);
+    return (&w->room[R_INVENTORY] == w->object[0].loc);
 }
 
 
 /* 
  * player_has_jetpack
  *   DESCRIPTION: Check whether the player has the jetpack in inventory.
- *   INPUTS: none
+ *   INPUTS: w -- the player's world
  *   OUTPUTS: none
  *   RETURN VALUE: 1 if the jetpack is in inventory, 0 if not
  *   SIDE EFFECTS: none
  */
 int32_t
-player_has_jetpack ()
+player_has_jetpack (const world_t* w)
 {
-    return (&room[R_INVENTORY] == object[1].loc);
+    return (&w->room[R_INVENTORY] == w->object[1].loc);
 }
 
 
@@ -1039,28 +1684,30 @@ player_has_jetpack ()
 tc_action_t
 try_to_move_left (room_t** rptr)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* If room exists, move into it. */
     if (NULL != r->left) {
         *rptr = r->left;
 
 	/* When entering the Boneyard Circle, choose picture randomly. */
-	if (&room[R_CIRCLE_N] == *rptr && 0 == (rand () % 2)) {
+	if (&w->room[R_CIRCLE_N] == *rptr && 0 == (world_rand (w) % 2)) {
 	    do_photo_swap (*rptr, SWAP_CIRCLE);
 	}
 	return TC_CHANGE_ROOM;
     }
 
-    if (&room[0] == r) {
+    if (&w->room[0] == r) {
 	/* Give a hint as to how to get out of inventory. */
-        show_status ("Push 'home' or type 'inventory'.");
+        show_status (w, "Push 'home' or type 'inventory'.");
     } else {
 	/* Let the player know that the move failed. */
-	show_status ("You can't go that way.");
+	show_status (w, "You can't go that way.");
     }
     return TC_ALLOW_EDIT;
 }
@@ -1077,17 +1724,19 @@ try_to_move_left (room_t** rptr)
 tc_action_t
 try_to_enter (room_t** rptr)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* If room exists, move into it. */
     if (NULL != r->enter) {
         *rptr = r->enter;
 
 	/* When entering the Boneyard Circle, choose picture randomly. */
-	if (&room[R_CIRCLE_N] == *rptr && 0 == (rand () % 2)) {
+	if (&w->room[R_CIRCLE_N] == *rptr && 0 == (world_rand (w) % 2)) {
 	    do_photo_swap (*rptr, SWAP_CIRCLE);
 	}
 	return TC_CHANGE_ROOM;
@@ -1098,46 +1747,46 @@ try_to_enter (room_t** rptr)
      * conditions are met, and give hints when the conditions are 
      * not met. 
      */
-    if (&room[R_BY_CLEANR] == r) {
-	if (player_flag_is_set (FLAG_WEARING_SUIT)) {
-	    *rptr = &room[R_IN_CLEANR];
+    if (&w->room[R_BY_CLEANR] == r) {
+	if (player_flag_is_set (w, FLAG_WEARING_SUIT)) {
+	    *rptr = &w->room[R_IN_CLEANR];
 	    return TC_CHANGE_ROOM;
 	}
-	show_status ("You're not wearing a bunnysuit!");
+	show_status (w, "You're not wearing a bunnysuit!");
 	return TC_ALLOW_EDIT;
     }
-    if (&room[R_BY_395LAB] == r) {
-	if (object[O_ICARD].loc == &room[R_INVENTORY]) {
-	    show_status ("You swiped your Icard.");
-	    *rptr = &room[R_IN_395LAB];
+    if (&w->room[R_BY_395LAB] == r) {
+	if (w->object[O_ICARD].loc == &w->room[R_INVENTORY]) {
+	    show_status (w, "You swiped your Icard.");
+	    *rptr = &w->room[R_IN_395LAB];
 	    return TC_CHANGE_ROOM;
 	}
-	show_status ("You need a valid Icard.");
+	show_status (w, "You need a valid Icard.");
 	return TC_ALLOW_EDIT;
     }
-    if (&room[R_CSL_DOOR] == r) {
-	if (object[O_ICARD].loc == &room[R_INVENTORY]) {
-	    show_status ("You swiped your Icard.");
-	    *rptr = &room[R_CSL_LOBBY];
+    if (&w->room[R_CSL_DOOR] == r) {
+	if (w->object[O_ICARD].loc == &w->room[R_INVENTORY]) {
+	    show_status (w, "You swiped your Icard.");
+	    *rptr = &w->room[R_CSL_LOBBY];
 	    return TC_CHANGE_ROOM;
 	}
-	show_status ("You need a valid Icard.");
+	show_status (w, "You need a valid Icard.");
 	return TC_ALLOW_EDIT;
     }
-    if (&room[R_BECK_DOOR] == r) {
-	if (object[O_ROBOT_LIVE].loc == &room[R_INVENTORY]) {
-	    show_status ("The robot hand picked the lock!");
-	    *rptr = &room[R_BECKLOBBY];
+    if (&w->room[R_BECK_DOOR] == r) {
+	if (w->object[O_ROBOT_LIVE].loc == &w->room[R_INVENTORY]) {
+	    show_status (w, "The robot hand picked the lock!");
+	    *rptr = &w->room[R_BECKLOBBY];
 	    return TC_CHANGE_ROOM;
 	}
-	if (object[O_ROBOT_DEAD].loc == &room[R_INVENTORY]) {
-	    show_status ("Flash the robot's code again.");
+	if (w->object[O_ROBOT_DEAD].loc == &w->room[R_INVENTORY]) {
+	    show_status (w, "Flash the robot's code again.");
 	    return TC_ALLOW_EDIT;
 	}
-	show_status ("Complex lock!  Find a nanotech robot.");
+	show_status (w, "Complex lock!  Find a nanotech robot.");
 	return TC_ALLOW_EDIT;
     }
-    if (&room[R_MNTL_LAB1] == r) {
+    if (&w->room[R_MNTL_LAB1] == r) {
         /* Get advice from Kevin. */
 	static const char* const advice[8] = {
 	    "Kevin says, \"Andres' board is FAST!\"",
@@ -1149,16 +1798,16 @@ try_to_enter (room_t** rptr)
 	    "Kevin asks, \"Maybe you need a Dew?\"",
 	    "Kevin: \"A magnet can charge a battery.\""
 	};
-	show_status (advice[(rand () % 8)]);
+	show_status (w, advice[(world_rand (w) % 8)]);
 	return TC_ALLOW_EDIT;
     }
-    if (&room[R_COCKPIT] == r) {
-        show_status ("A MIMO transmitter card is missing!");
+    if (&w->room[R_COCKPIT] == r) {
+        show_status (w, "A MIMO transmitter card is missing!");
 	return TC_ALLOW_EDIT;
     }
 
     /* Let the player know that the move failed. */
-    show_status ("You can't go that way.");
+    show_status (w, "You can't go that way.");
     return TC_ALLOW_EDIT;
 }
 
@@ -1174,33 +1823,101 @@ try_to_enter (room_t** rptr)
 tc_action_t
 try_to_move_right (room_t** rptr)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* If room exists, move into it. */
     if (NULL != r->right) {
         *rptr = r->right;
 
 	/* When entering the Boneyard Circle, choose picture randomly. */
-	if (&room[R_CIRCLE_N] == *rptr && 0 == (rand () % 2)) {
+	if (&w->room[R_CIRCLE_N] == *rptr && 0 == (world_rand (w) % 2)) {
 	    do_photo_swap (*rptr, SWAP_CIRCLE);
 	}
 	return TC_CHANGE_ROOM;
     }
 
-    if (&room[0] == r) {
+    if (&w->room[0] == r) {
 	/* Give a hint as to how to get out of inventory. */
-        show_status ("Push 'home' or type 'inventory'.");
+        show_status (w, "Push 'home' or type 'inventory'.");
     } else {
 	/* Let the player know that the move failed. */
-	show_status ("You can't go that way.");
+	show_status (w, "You can't go that way.");
     }
     return TC_ALLOW_EDIT;
 }
 
 
+/* 
+ * typed_command
+ *   DESCRIPTION: Carry out a typed command: look up the verb (the first
+ *                word, after any leading spaces) and pass the rest, with
+ *                leading spaces stripped, to the verb's function.
+ *   INPUTS: *rptr -- player's current room
+ *           typed -- the typed command
+ *   OUTPUTS: *rptr -- possibly new room for player
+ *            *verb -- command for the verb, or NUM_TC_VALUES if the
+ *                     command is empty or the verb is unknown
+ *   RETURN VALUE: indicates types of action taken (see header file)
+ *   SIDE EFFECTS: may move objects, show status messages, change player's room
+ */
+tc_action_t
+typed_command (room_t** rptr, const char* typed, cmd_id_t* verb)
+{
+    world_t*    w = (*rptr)->world; /* player's world                 */
+    int32_t     cmd_len;            /* length of command verb         */
+    const char* arg;                /* argument given to command verb */
+
+    /* Strip leading spaces.  If the command is empty, do nothing. */
+    *verb = NUM_TC_VALUES;
+    while (' ' == *typed) { typed++; }
+    if ('\0' == *typed) { return TC_ALLOW_EDIT; }
+
+    /* 
+     * Walk over the command verb, calculating its length as we go.  Space
+     * or NUL marks the end of the verb, after which the argument begins.
+     * Leading spaces are first stripped from the argument, but we make no
+     * attempt to deal with trailing spaces (argument names must match
+     * exactly).
+     */
+    for (cmd_len = 0; ' ' != typed[cmd_len] && '\0' != typed[cmd_len]; 
+	 cmd_len++);
+    arg = &typed[cmd_len];
+    while (' ' == *arg) { arg++; }
+
+    /* Look up the typed verb.  If it is not recognized, say so. */
+    if (NUM_TC_VALUES == (*verb = find_verb (typed, cmd_len))) {
+	show_status (w, "What are you babbling about?");
+	return TC_ALLOW_EDIT;
+    }
+
+    /* Execute the command found. */
+    switch (*verb) {
+	case TC_BUY:       return typed_cmd_buy (rptr, arg);
+	case TC_CHARGE:    return typed_cmd_charge (rptr, arg);
+	case TC_DO:        return typed_cmd_do (rptr, arg);
+	case TC_DRINK:     return typed_cmd_drink (rptr, arg);
+	case TC_DROP:      return typed_cmd_drop (rptr, arg);
+	case TC_FIX:       return typed_cmd_fix (rptr, arg);
+	case TC_FLASH:     return typed_cmd_flash (rptr, arg);
+	case TC_GET:       return typed_cmd_get (rptr, arg);
+	case TC_GO:        return typed_cmd_go (rptr, arg);
+	case TC_INSTALL:   return typed_cmd_install (rptr, arg);
+	case TC_INVENTORY: return typed_cmd_inventory (rptr, arg);
+	case TC_SIGH:      return typed_cmd_sigh (rptr, arg);
+	case TC_USE:       return typed_cmd_use (rptr, arg);
+	case TC_WEAR:      return typed_cmd_wear (rptr, arg);
+	default:
+	    show_status (w, "Bug...!");
+	    return TC_ALLOW_EDIT;
+    }
+}
+
+
 /* 
  * typed_cmd_buy
  *   DESCRIPTION: Execute the typed command "buy," which allows the player
@@ -1215,46 +1932,48 @@ try_to_move_right (room_t** rptr)
 tc_action_t
 typed_cmd_buy (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Buy a Dew! */
     if (0 == strcasecmp ("dew", arg)) {
-        if (&room[R_EVRT_VEND] != r) {
-	    show_status ("Great idea!  But ... where?");
+        if (&w->room[R_EVRT_VEND] != r) {
+	    show_status (w, "Great idea!  But ... where?");
 	    return TC_DISCARD_TEXT;
 	} 
-	if (object[O_MTN_DEW].loc == &room[R_INVENTORY] ||
-	    object[O_MTN_DEW].loc == r) {
-	    show_status ("Slow down!  One at a time...");
+	if (w->object[O_MTN_DEW].loc == &w->room[R_INVENTORY] ||
+	    w->object[O_MTN_DEW].loc == r) {
+	    show_status (w, "Slow down!  One at a time...");
 	    return TC_DISCARD_TEXT;
 	} 
-	if (NULL != object[O_MTN_DEW].loc) {
-	    show_status ("Last one get stolen?  Ok...here we go...");
+	if (NULL != w->object[O_MTN_DEW].loc) {
+	    show_status (w, "Last one get stolen?  Ok...here we go...");
 	} else {
-	    show_status ("You buy a Dew.");
+	    show_status (w, "You buy a Dew.");
 	}
-	move_object_to_inventory (&object[O_MTN_DEW]);
+	move_object_to_inventory (w, &w->object[O_MTN_DEW]);
 	return TC_REDRAW_ROOM;
     }
 
     /* Buy some yogurt. */
     if (0 == strcasecmp ("yogurt", arg)) {
-        if (&room[R_IN_COCOMR] != r) {
-	    show_status ("Cocomero doesn't deliver here.");
-	} else if (player_flag_is_set (FLAG_HAS_EATEN)) {
-	    show_status ("You're not hungry.");
+        if (&w->room[R_IN_COCOMR] != r) {
+	    show_status (w, "Cocomero doesn't deliver here.");
+	} else if (player_flag_is_set (w, FLAG_HAS_EATEN)) {
+	    show_status (w, "You're not hungry.");
 	} else {
-	    player_set_flag (FLAG_HAS_EATEN);
-	    show_status ("So tasty and delicious!");
+	    player_set_flag (w, FLAG_HAS_EATEN);
+	    show_status (w, "So tasty and delicious!");
 	}
 	return TC_DISCARD_TEXT;
     }
 
     /* The player got too imaginative. */
-    show_status ("Sorry, purchasing options are limited.");
+    show_status (w, "Sorry, purchasing options are limited.");
     return TC_ALLOW_EDIT;
 }
 
@@ -1271,35 +1990,37 @@ typed_cmd_buy (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_charge (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Only the battery can be charged. */
     if (0 != strcasecmp ("battery", arg)) {
-        show_status ("Electronic devices aren't (always) toys!");
+        show_status (w, "Electronic devices aren't (always) toys!");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_BATT_EMPTY].loc != &room[R_INVENTORY] &&
-	object[O_BATT_EMPTY].loc != r &&
-	object[O_BATT_FULL].loc != &room[R_INVENTORY] &&
-	object[O_BATT_FULL].loc != r) {
-	show_status ("What battery?");
+    if (w->object[O_BATT_EMPTY].loc != &w->room[R_INVENTORY] &&
+	w->object[O_BATT_EMPTY].loc != r &&
+	w->object[O_BATT_FULL].loc != &w->room[R_INVENTORY] &&
+	w->object[O_BATT_FULL].loc != r) {
+	show_status (w, "What battery?");
 	return TC_DISCARD_TEXT;
     }
-    if (&room[R_BECK_MRI] != r) {
-	show_status ("Find a bigger magnet.");
+    if (&w->room[R_BECK_MRI] != r) {
+	show_status (w, "Find a bigger magnet.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_BATT_FULL].loc == &room[R_INVENTORY] ||
-	object[O_BATT_FULL].loc == r) {
-	show_status ("Don't overdo it.");
+    if (w->object[O_BATT_FULL].loc == &w->room[R_INVENTORY] ||
+	w->object[O_BATT_FULL].loc == r) {
+	show_status (w, "Don't overdo it.");
 	return TC_DISCARD_TEXT;
     }
-    remove_object (&object[O_BATT_EMPTY]);
-    move_object_to_inventory (&object[O_BATT_FULL]);
-    show_status ("Wow!  That's a strong magnet!");
+    remove_object (&w->object[O_BATT_EMPTY]);
+    move_object_to_inventory (w, &w->object[O_BATT_FULL]);
+    show_status (w, "Wow!  That's a strong magnet!");
     return TC_REDRAW_ROOM;
 }
 
@@ -1316,30 +2037,32 @@ typed_cmd_charge (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_do (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
-    if (&room[R_IN_391LAB] != r) {
-        show_status ("You can't 'do' anything here.");
+    if (&w->room[R_IN_391LAB] != r) {
+        show_status (w, "You can't 'do' anything here.");
 	return TC_ALLOW_EDIT;
     }
     if (0 != strcasecmp ("391", arg) &&
 	0 != strcasecmp ("mp2", arg)) {
-        show_status ("Doing the 391 MP2 is more important!");
+        show_status (w, "Doing the 391 MP2 is more important!");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_BOOK_C].loc != &room[R_INVENTORY]) {
-        show_status ("You'd better get a book from Grainger.");
+    if (w->object[O_BOOK_C].loc != &w->room[R_INVENTORY]) {
+        show_status (w, "You'd better get a book from Grainger.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_MP2].loc != &room[R_INVENTORY]) {
-        show_status ("Web's down.  Bring your own MP2.");
+    if (w->object[O_MP2].loc != &w->room[R_INVENTORY]) {
+        show_status (w, "Web's down.  Bring your own MP2.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_TUX].loc != &room[R_IN_391LAB]) {
-        show_status ("You'd have better luck if Tux were here.");
+    if (w->object[O_TUX].loc != &w->room[R_IN_391LAB]) {
+        show_status (w, "You'd have better luck if Tux were here.");
 	return TC_DISCARD_TEXT;
     }
 
@@ -1362,23 +2085,25 @@ typed_cmd_do (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_drink (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* All you can drink is Dew... */
     if (0 != strcasecmp ("dew", arg)) {
-        show_status ("That sounds less refreshing than Dew.");
+        show_status (w, "That sounds less refreshing than Dew.");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_MTN_DEW].loc != &room[R_INVENTORY] &&
-        object[O_MTN_DEW].loc != r) {
-        show_status ("Uh-oh.  Hadewcinations.  Buy one soon!");
+    if (w->object[O_MTN_DEW].loc != &w->room[R_INVENTORY] &&
+        w->object[O_MTN_DEW].loc != r) {
+        show_status (w, "Uh-oh.  Hadewcinations.  Buy one soon!");
 	return TC_DISCARD_TEXT;
     }
-    remove_object (&object[O_MTN_DEW]);
-    show_status ("Ahhhhhhhhhhhhhhhh...........nother?");
+    remove_object (&w->object[O_MTN_DEW]);
+    show_status (w, "Ahhhhhhhhhhhhhhhh...........nother?");
     /* NOT a bug.  Sorry, Dew doesn't count as a food. */
     return TC_REDRAW_ROOM;
 }
@@ -1399,18 +2124,20 @@ tc_action_t
 typed_cmd_drop (room_t** rptr, const char* arg)
 {
     room_t*   r;	/* current room                        */
+    world_t*  w;	/* player's world                     */
     object_t* obj;      /* object being dropped                */
     room_t*   dest;	/* destination room for dropped object */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Search for object to drop--it must be in the player's inventory. */
-    obj = find_in_room (&room[R_INVENTORY], arg);
+    obj = find_in_room (&w->room[R_INVENTORY], arg);
 
     /* No luck--say so. */
     if (NULL == obj) {
-	show_status ("You have no such thing.");
+	show_status (w, "You have no such thing.");
         return TC_ALLOW_EDIT;
     }
     
@@ -1418,16 +2145,16 @@ typed_cmd_drop (room_t** rptr, const char* arg)
      * Issue a warning to player if they seem to be trying to make use
      * of certain objects (as a hint).
      */
-    if ((&object[O_BATT_FULL] == obj && &room[R_CAR_SITE] == r) ||
-	(&object[O_MIMO_CARD] == obj && &room[R_REM_PLANE] == r)) {
-        show_status ("You may want to install it instead.");
+    if ((&w->object[O_BATT_FULL] == obj && &w->room[R_CAR_SITE] == r) ||
+	(&w->object[O_MIMO_CARD] == obj && &w->room[R_REM_PLANE] == r)) {
+        show_status (w, "You may want to install it instead.");
     }
 
     /* 
      * If player is looking at inventory, object goes into the room in 
      * which they're standing.
      */
-    dest = (&room[R_INVENTORY] == r ? room[R_INVENTORY].enter : r);
+    dest = (&w->room[R_INVENTORY] == r ? w->room[R_INVENTORY].enter : r);
     insert_object (obj, dest);
     return TC_REDRAW_ROOM;
 }
@@ -1446,39 +2173,41 @@ typed_cmd_drop (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_fix (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Only the GPS can be fixed. */
     if (0 != strcasecmp ("gps", arg)) {
-        show_status ("In the game, you're not as capable.");
+        show_status (w, "In the game, you're not as capable.");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_GPS_GOOD].loc == &room[R_INVENTORY] ||
-        object[O_GPS_GOOD].loc == r) {
-        show_status ("It's working fine.");
+    if (w->object[O_GPS_GOOD].loc == &w->room[R_INVENTORY] ||
+        w->object[O_GPS_GOOD].loc == r) {
+        show_status (w, "It's working fine.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_GPS_BAD].loc != &room[R_INVENTORY] &&
-        object[O_GPS_BAD].loc != r) {
-        show_status ("Do you have a GPS?");
+    if (w->object[O_GPS_BAD].loc != &w->room[R_INVENTORY] &&
+        w->object[O_GPS_BAD].loc != r) {
+        show_status (w, "Do you have a GPS?");
 	return TC_DISCARD_TEXT;
     }
-    if (&room[R_IN_CLEANR] != r) {
-        show_status ("You'd better go to the cleanroom.");
+    if (&w->room[R_IN_CLEANR] != r) {
+        show_status (w, "You'd better go to the cleanroom.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_GPS_SPEC].loc != &room[R_INVENTORY] &&
-        object[O_GPS_SPEC].loc != r) {
-        show_status ("Maybe you'd better get a spec?");
+    if (w->object[O_GPS_SPEC].loc != &w->room[R_INVENTORY] &&
+        w->object[O_GPS_SPEC].loc != r) {
+        show_status (w, "Maybe you'd better get a spec?");
 	return TC_DISCARD_TEXT;
     }
-    remove_object (&object[O_GPS_BAD]);
-    remove_object (&object[O_GPS_SPEC]);
-    move_object_to_inventory (&object[O_GPS_GOOD]);
-    show_status ("All done--wow, you're good!");
+    remove_object (&w->object[O_GPS_BAD]);
+    remove_object (&w->object[O_GPS_SPEC]);
+    move_object_to_inventory (w, &w->object[O_GPS_GOOD]);
+    show_status (w, "All done--wow, you're good!");
     return TC_CHANGE_ROOM;
 }
 
@@ -1496,35 +2225,37 @@ typed_cmd_fix (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_flash (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Only the robot can be flashed. */
     if (0 != strcasecmp ("robot", arg)) {
-        show_status ("Don't waste your time.");
+        show_status (w, "Don't waste your time.");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_ROBOT_DEAD].loc != &room[R_INVENTORY] &&
-        object[O_ROBOT_DEAD].loc != r &&
-	object[O_ROBOT_LIVE].loc != &room[R_INVENTORY] &&
-        object[O_ROBOT_LIVE].loc != r) {
-        show_status ("Maybe get the robot first?");
+    if (w->object[O_ROBOT_DEAD].loc != &w->room[R_INVENTORY] &&
+        w->object[O_ROBOT_DEAD].loc != r &&
+	w->object[O_ROBOT_LIVE].loc != &w->room[R_INVENTORY] &&
+        w->object[O_ROBOT_LIVE].loc != r) {
+        show_status (w, "Maybe get the robot first?");
 	return TC_DISCARD_TEXT;
     }
-    if (&room[R_IN_395LAB] != r) {
-        show_status ("With spit and a lemon?  Try the lab.");
+    if (&w->room[R_IN_395LAB] != r) {
+        show_status (w, "With spit and a lemon?  Try the lab.");
 	return TC_DISCARD_TEXT;
     }
-    if (object[O_ROBOT_LIVE].loc == &room[R_INVENTORY] ||
-        object[O_ROBOT_LIVE].loc == r) {
-        show_status ("You flash the robot's ROM again.");
+    if (w->object[O_ROBOT_LIVE].loc == &w->room[R_INVENTORY] ||
+        w->object[O_ROBOT_LIVE].loc == r) {
+        show_status (w, "You flash the robot's ROM again.");
 	return TC_DISCARD_TEXT;
     }
-    remove_object (&object[O_ROBOT_DEAD]);
-    move_object_to_inventory (&object[O_ROBOT_LIVE]);
-    show_status ("You flash it with a lockpicking code.");
+    remove_object (&w->object[O_ROBOT_DEAD]);
+    move_object_to_inventory (w, &w->object[O_ROBOT_LIVE]);
+    show_status (w, "You flash it with a lockpicking code.");
     return TC_REDRAW_ROOM;
 }
 
@@ -1543,35 +2274,37 @@ tc_action_t
 typed_cmd_get (room_t** rptr, const char* arg)
 {
     room_t*   r;	/* current room                  */
+    world_t*  w;	/* player's world                */
     room_t*   src;	/* source room for object search */
     object_t* obj;	/* object being sought           */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* 
      * If player is looking at inventory, source room for object search 
      * is the room in which they're standing.
      */
-    src = (&room[R_INVENTORY] == r ? room[R_INVENTORY].enter : r);
+    src = (&w->room[R_INVENTORY] == r ? w->room[R_INVENTORY].enter : r);
 
     /* Try a special effect search followed by a normal search. */
     if (NULL == (obj = obj_special_get (src, arg))) {
 	obj = find_in_room (src, arg);
     } 
     if (NULL == obj) {
-	show_status ("You see no such thing here.");
+	show_status (w, "You see no such thing here.");
         return TC_ALLOW_EDIT;
     }
 
     /* The player can't grab Tux! */
-    if (&object[O_TUX] == obj && !player_flag_is_set (FLAG_LURED_TUX)) {
-        show_status ("Tux must choose you!  Try using a fish.");
+    if (&w->object[O_TUX] == obj && !player_flag_is_set (w, FLAG_LURED_TUX)) {
+        show_status (w, "Tux must choose you!  Try using a fish.");
 	return TC_DISCARD_TEXT;
     }
 
     /* Move the object into the player's inventory. */
-    move_object_to_inventory (obj);
+    move_object_to_inventory (w, obj);
     return TC_REDRAW_ROOM;
 }
 
@@ -1589,83 +2322,85 @@ typed_cmd_get (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_go (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Try to go to Allerton Mansion. */
     if (0 == strcasecmp ("allerton", arg)) {
-        if (&room[R_ALLERTON] == r) {
-	    show_status ("Kazam!  You're at Allerton!");
+        if (&w->room[R_ALLERTON] == r) {
+	    show_status (w, "Kazam!  You're at Allerton!");
 	    return TC_DISCARD_TEXT;
 	}
-        if (&room[R_WILLARD] != r && &room[R_CAR_SITE] != r) {
-	    show_status ("That's quite a hike.");
+        if (&w->room[R_WILLARD] != r && &w->room[R_CAR_SITE] != r) {
+	    show_status (w, "That's quite a hike.");
 	    return TC_DISCARD_TEXT;
 	}
-	if (!player_flag_is_set (FLAG_CAR_FIXED)) {
-	    if (player_flag_is_set (FLAG_CAR_OPEN)) {
-		show_status ("The car isn't working.");
+	if (!player_flag_is_set (w, FLAG_CAR_FIXED)) {
+	    if (player_flag_is_set (w, FLAG_CAR_OPEN)) {
+		show_status (w, "The car isn't working.");
 	    } else {
-		show_status ("Do you want to use that car?");
+		show_status (w, "Do you want to use that car?");
 	    }
 	    return TC_DISCARD_TEXT;
 	}
-	if (object[O_GPS_GOOD].loc != &room[R_INVENTORY]) {
-	    if (object[O_GPS_BAD].loc == &room[R_INVENTORY]) {
-	        show_status ("That's a long road with a broken GPS.");
+	if (w->object[O_GPS_GOOD].loc != &w->room[R_INVENTORY]) {
+	    if (w->object[O_GPS_BAD].loc == &w->room[R_INVENTORY]) {
+	        show_status (w, "That's a long road with a broken GPS.");
 	    } else {
-	        show_status ("You'll need a GPS to find that place.");
+	        show_status (w, "You'll need a GPS to find that place.");
 	    }
 	    return TC_DISCARD_TEXT;
 	}
-	show_status ("You drive to Allerton Park.");
-	*rptr = &room[R_ALLERTON];
+	show_status (w, "You drive to Allerton Park.");
+	*rptr = &w->room[R_ALLERTON];
 	return TC_CHANGE_ROOM;
     }
 
     /* Try to go to Willard Airport. */
     if (0 == strcasecmp ("willard", arg) ||
 	0 == strcasecmp ("airport", arg)) {
-        if (&room[R_WILLARD] == r) {
-	    show_status ("Kazap!  You're at Willard!");
+        if (&w->room[R_WILLARD] == r) {
+	    show_status (w, "Kazap!  You're at Willard!");
 	    return TC_DISCARD_TEXT;
 	}
-        if (&room[R_ALLERTON] != r && &room[R_CAR_SITE] != r) {
-	    show_status ("That's quite a hike.");
+        if (&w->room[R_ALLERTON] != r && &w->room[R_CAR_SITE] != r) {
+	    show_status (w, "That's quite a hike.");
 	    return TC_DISCARD_TEXT;
 	}
-	if (!player_flag_is_set (FLAG_CAR_FIXED)) {
-	    if (player_flag_is_set (FLAG_CAR_OPEN)) {
-		show_status ("The car isn't working.");
+	if (!player_flag_is_set (w, FLAG_CAR_FIXED)) {
+	    if (player_flag_is_set (w, FLAG_CAR_OPEN)) {
+		show_status (w, "The car isn't working.");
 	    } else {
-		show_status ("Do you want to use that car?");
+		show_status (w, "Do you want to use that car?");
 	    }
 	    return TC_DISCARD_TEXT;
 	}
-	show_status ("You drive to Willard Airport.");
-	*rptr = &room[R_WILLARD];
+	show_status (w, "You drive to Willard Airport.");
+	*rptr = &w->room[R_WILLARD];
 	return TC_CHANGE_ROOM;
     }
 
     /* Try to go to campus. */
     if (0 == strcasecmp ("campus", arg)) {
-        if (&room[R_CAR_SITE] == r) {
-	    show_status ("Kazar!  You're on campus!");
+        if (&w->room[R_CAR_SITE] == r) {
+	    show_status (w, "Kazar!  You're on campus!");
 	    return TC_DISCARD_TEXT;
 	}
-        if (&room[R_ALLERTON] != r && &room[R_WILLARD] != r) {
-	    show_status ("That's quite a hike.");
+        if (&w->room[R_ALLERTON] != r && &w->room[R_WILLARD] != r) {
+	    show_status (w, "That's quite a hike.");
 	    return TC_DISCARD_TEXT;
 	}
-	show_status ("You drive back to campus.");
-	*rptr = &room[R_CAR_SITE];
+	show_status (w, "You drive back to campus.");
+	*rptr = &w->room[R_CAR_SITE];
 	return TC_CHANGE_ROOM;
     }
 
     /* Location unrecognized.  Say so. */
-    show_status ("The game map lacks certain places.");
+    show_status (w, "The game map lacks certain places.");
     return TC_ALLOW_EDIT;
 }
 
@@ -1683,56 +2418,58 @@ typed_cmd_go (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_install (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Try to install a battery. */
     if (0 == strcasecmp ("battery", arg)) {
-	if (object[O_BATT_EMPTY].loc != &room[R_INVENTORY] &&
-	    object[O_BATT_EMPTY].loc != r &&
-	    object[O_BATT_FULL].loc != &room[R_INVENTORY] &&
-	    object[O_BATT_FULL].loc != r) {
-	    show_status ("What battery?");
+	if (w->object[O_BATT_EMPTY].loc != &w->room[R_INVENTORY] &&
+	    w->object[O_BATT_EMPTY].loc != r &&
+	    w->object[O_BATT_FULL].loc != &w->room[R_INVENTORY] &&
+	    w->object[O_BATT_FULL].loc != r) {
+	    show_status (w, "What battery?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (&room[R_CAR_SITE] != r) {
-	    show_status ("Do you see the car?");
+	if (&w->room[R_CAR_SITE] != r) {
+	    show_status (w, "Do you see the car?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (object[O_BATT_EMPTY].loc == &room[R_INVENTORY] ||
-	    object[O_BATT_EMPTY].loc == r) {
-	    show_status ("You want to install a dead battery?");
+	if (w->object[O_BATT_EMPTY].loc == &w->room[R_INVENTORY] ||
+	    w->object[O_BATT_EMPTY].loc == r) {
+	    show_status (w, "You want to install a dead battery?");
 	    return TC_DISCARD_TEXT;
         }
-	remove_object (&object[O_BATT_FULL]);
-	player_set_flag (FLAG_CAR_FIXED);
+	remove_object (&w->object[O_BATT_FULL]);
+	player_set_flag (w, FLAG_CAR_FIXED);
 	do_photo_swap (r, SWAP_CAR);
-	show_status ("Nice work!  Now you can use it!");
+	show_status (w, "Nice work!  Now you can use it!");
 	return TC_CHANGE_ROOM;
     }
 
     /* Try to install a MIMO transmitter card. */
     if (0 == strcasecmp ("mimo", arg) || 0 == strcasecmp ("card", arg) ||
 	0 == strcasecmp ("transmitter", arg)) {
-	if (object[O_MIMO_CARD].loc != &room[R_INVENTORY] &&
-	    object[O_MIMO_CARD].loc != r) {
-	    show_status ("Do you have one of those?");
+	if (w->object[O_MIMO_CARD].loc != &w->room[R_INVENTORY] &&
+	    w->object[O_MIMO_CARD].loc != r) {
+	    show_status (w, "Do you have one of those?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (&room[R_COCKPIT] != r) {
-	    show_status ("Nothing here needs that.");
+	if (&w->room[R_COCKPIT] != r) {
+	    show_status (w, "Nothing here needs that.");
 	    return TC_DISCARD_TEXT;
 	}
-	remove_object (&object[O_MIMO_CARD]);
-	room[R_COCKPIT].enter = &room[R_OVER_WILL];
-	show_status ("Ready for takeoff, captain!");
+	remove_object (&w->object[O_MIMO_CARD]);
+	w->room[R_COCKPIT].enter = &w->room[R_OVER_WILL];
+	show_status (w, "Ready for takeoff, captain!");
 	return TC_REDRAW_ROOM;
     }
 
     /* There's nothing else that can be installed. */
-    show_status ("What are you playing at?");
+    show_status (w, "What are you playing at?");
     return TC_ALLOW_EDIT;
 }
 
@@ -1757,18 +2494,20 @@ typed_cmd_install (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_inventory (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
-    if (&room[R_INVENTORY] == r) {
+    if (&w->room[R_INVENTORY] == r) {
 	/* Return from inventory to previous room. */
 	*rptr = r->enter;
     } else {
 	/* Record current room and enter inventory view. */
-	room[R_INVENTORY].enter = r;
-	*rptr = &room[R_INVENTORY];
+	w->room[R_INVENTORY].enter = r;
+	*rptr = &w->room[R_INVENTORY];
     }
     return TC_CHANGE_ROOM;
 }
@@ -1789,15 +2528,17 @@ typed_cmd_inventory (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_sigh (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
-    if (&room[R_BY_ZAS] != r) {
-        show_status ("MP2 got you down?  Take a break!");
+    w = r->world;
+    if (&w->room[R_BY_ZAS] != r) {
+        show_status (w, "MP2 got you down?  Take a break!");
     } else {
-	show_status ("So sad... you lose your appetite.");
-	player_set_flag (FLAG_HAS_EATEN);
+	show_status (w, "So sad... you lose your appetite.");
+	player_set_flag (w, FLAG_HAS_EATEN);
     }
     return TC_DISCARD_TEXT;
 }
@@ -1816,65 +2557,67 @@ typed_cmd_sigh (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_use (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Try to use a car. */
     if (0 == strcasecmp ("car", arg)) {
-    	if (&room[R_ALLERTON] == r) {
-	    show_status ("Go to campus or Willard Airport?");
+    	if (&w->room[R_ALLERTON] == r) {
+	    show_status (w, "Go to campus or Willard Airport?");
 	    return TC_DISCARD_TEXT;
 	}
-    	if (&room[R_WILLARD] == r) {
-	    show_status ("Go to Allerton or campus?");
+    	if (&w->room[R_WILLARD] == r) {
+	    show_status (w, "Go to Allerton or campus?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (&room[R_CAR_SITE] != r) {
-	    show_status ("You have a car?");
+	if (&w->room[R_CAR_SITE] != r) {
+	    show_status (w, "You have a car?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (player_flag_is_set (FLAG_CAR_FIXED)) {
-	    show_status ("Go to Allerton or Willard Airport?");
+	if (player_flag_is_set (w, FLAG_CAR_FIXED)) {
+	    show_status (w, "Go to Allerton or Willard Airport?");
 	    return TC_DISCARD_TEXT;
 	}
-	if (player_flag_is_set (FLAG_CAR_OPEN)) {
-	    show_status ("You'll have to charge the battery.");
+	if (player_flag_is_set (w, FLAG_CAR_OPEN)) {
+	    show_status (w, "You'll have to charge the battery.");
 	    return TC_DISCARD_TEXT;
 	}
-	if (object[O_CAR_KEY].loc != &room[R_INVENTORY]) {
-	    show_status ("Perhaps you can find a key?");
+	if (w->object[O_CAR_KEY].loc != &w->room[R_INVENTORY]) {
+	    show_status (w, "Perhaps you can find a key?");
 	    return TC_DISCARD_TEXT;
 	}
 	do_photo_swap (r, SWAP_CAR);
-	remove_object (&object[O_CAR_KEY]);
-	insert_object_at (&object[O_BATT_CAR], r, 265, 122);
-	player_set_flag (FLAG_CAR_OPEN);
-	show_status ("The key works, but the battery's dead.");
+	remove_object (&w->object[O_CAR_KEY]);
+	insert_object_at (&w->object[O_BATT_CAR], r, 265, 122);
+	player_set_flag (w, FLAG_CAR_OPEN);
+	show_status (w, "The key works, but the battery's dead.");
 	return TC_CHANGE_ROOM;
     }
 
     /* Try to use a fish. */
     if (0 == strcasecmp ("fish", arg)) {
-	if (object[O_FISH].loc != &room[R_INVENTORY] &&
-	    object[O_FISH].loc != r) {
-	    show_status ("Using the invisible fish...no effect!");
+	if (w->object[O_FISH].loc != &w->room[R_INVENTORY] &&
+	    w->object[O_FISH].loc != r) {
+	    show_status (w, "Using the invisible fish...no effect!");
 	    return TC_DISCARD_TEXT;
 	}
-	if (&room[R_REM_LAB] != r) {
-	    show_status ("I don't think that's sanitary.");
+	if (&w->room[R_REM_LAB] != r) {
+	    show_status (w, "I don't think that's sanitary.");
 	    return TC_DISCARD_TEXT;
 	}
-	remove_object (&object[O_FISH]);
-	move_object_to_inventory (&object[O_TUX]);
-	player_set_flag (FLAG_LURED_TUX);
-        show_status ("Tux likes you!");
+	remove_object (&w->object[O_FISH]);
+	move_object_to_inventory (w, &w->object[O_TUX]);
+	player_set_flag (w, FLAG_LURED_TUX);
+        show_status (w, "Tux likes you!");
 	return TC_REDRAW_ROOM;
     }
 
     /* Don't ask.  Oh, was that YOU who tried to use that?  Uh. */
-    show_status ("You want to use what!?");
+    show_status (w, "You want to use what!?");
     return TC_ALLOW_EDIT;
 }
 
@@ -1892,24 +2635,139 @@ typed_cmd_use (room_t** rptr, const char* arg)
 tc_action_t
 typed_cmd_wear (room_t** rptr, const char* arg)
 {
-    room_t* r;	/* current room */
+    room_t*  r;	/* current room   */
+    world_t* w;	/* player's world */
 
-    /* Set current room. */
+    /* Set current room and world. */
     r = *rptr;
+    w = r->world;
 
     /* Only the bunnysuit can be worn. */
     if (0 != strcasecmp ("bunnysuit", arg)) {
-        show_status ("Big Brother forbids fashion statements.");
+        show_status (w, "Big Brother forbids fashion statements.");
 	return TC_ALLOW_EDIT;
     }
-    if (object[O_BUNNYSUIT].loc != &room[R_INVENTORY] &&
-        object[O_BUNNYSUIT].loc != r) {
-        show_status ("Do you have a bunnysuit?");
+    if (w->object[O_BUNNYSUIT].loc != &w->room[R_INVENTORY] &&
+        w->object[O_BUNNYSUIT].loc != r) {
+        show_status (w, "Do you have a bunnysuit?");
 	return TC_DISCARD_TEXT;
     }
-    remove_object (&object[O_BUNNYSUIT]);
-    player_set_flag (FLAG_WEARING_SUIT);
-    show_status ("You look good in pink!");
+    remove_object (&w->object[O_BUNNYSUIT]);
+    player_set_flag (w, FLAG_WEARING_SUIT);
+    show_status (w, "You look good in pink!");
     return TC_REDRAW_ROOM;
 }
 
+
+
+#if defined(WORLD_BENCH_PROGRAM)
+
+#define BENCH_WORLD_FILE "world-bench.world" /* generated world file   */
+#define BENCH_NEW_WORLDS 20                  /* worlds timed per size  */
+
+/* 
+ * write_copies
+ *   DESCRIPTION: Write a world file holding adventure.world and copies
+ *                of all of its rooms, for the "world-bench" program.
+ *                Copy c of room R_X is R_X_c, linked to the copies of
+ *                R_X's neighbors; objects and swaps are not copied.
+ *   INPUTS: copies -- number of copies of the rooms (1 for none)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 on success, or 0 on failure
+ *   SIDE EFFECTS: writes BENCH_WORLD_FILE
+ */
+static int32_t
+write_copies (int32_t copies)
+{
+    FILE*   in;		/* the game's world file          */
+    FILE*   out;	/* the generated world file       */
+    char    line[256];	/* line read                      */
+    char    id[4][64];	/* room id and links              */
+    char    file[64];	/* photo file name                */
+    int     len;	/* length of the line before name */
+    int32_t c;		/* index over copies              */
+    int32_t i;		/* index over ids                 */
+
+    if (NULL == (in = fopen ("adventure.world", "r"))) {
+	return 0;
+    }
+    if (NULL == (out = fopen (BENCH_WORLD_FILE, "w"))) {
+	(void)fclose (in);
+	return 0;
+    }
+    while (NULL != fgets (line, sizeof (line), in)) {
+	fputs (line, out);
+	if (5 != sscanf (line, "room %63s %63s %63s %63s %63s %n", id[0],
+			 id[1], id[2], id[3], file, &len)) {
+	    continue;
+	}
+	for (c = 1; copies > c; c++) {
+	    fputs ("room", out);
+	    for (i = 0; 4 > i; i++) {
+		if (0 == strcmp (id[i], "-")) {
+		    fputs (" -", out);
+		} else {
+		    fprintf (out, " %s_%d", id[i], c);
+		}
+	    }
+	    fprintf (out, " %s %s", file, line + len);
+	}
+    }
+    (void)fclose (in);
+    return (0 == fclose (out));
+}
+
+
+/* 
+ * main -- for the "world-bench" program
+ *   DESCRIPTION: Load worlds of 1, 10, 100, and 1000 copies of the game's
+ *                rooms, and report the time taken to load each and to
+ *                start a game in it, and the memory used for each room.
+ *   INPUTS: none (command line arguments are ignored)
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 on success, 1 if a world cannot be written or read
+ */
+int
+main ()
+{
+    static const int32_t copies[] = {1, 10, 100, 1000};
+    world_stats_t ws;		/* statistics on the loaded world */
+    struct timespec start;	/* time at which new_world began  */
+    struct timespec done;	/* time at which the last ended   */
+    world_t* w;			/* a new world                    */
+    double   new_ns;		/* time per new_world             */
+    int32_t  i;			/* index over world sizes         */
+    int32_t  j;			/* index over new worlds          */
+
+    printf ("%8s %9s %10s %10s %12s %12s %12s\n", "rooms", "file",
+	    "load ms", "ns/room", "shared/room", "world/room", "new_world us");
+    for (i = 0; sizeof (copies) / sizeof (copies[0]) > i; i++) {
+	if (!write_copies (copies[i]) || !build_world (BENCH_WORLD_FILE)) {
+	    (void)remove (BENCH_WORLD_FILE);
+	    return 1;
+	}
+	(void)clock_gettime (CLOCK_MONOTONIC, &start);
+	for (j = 0; BENCH_NEW_WORLDS > j; j++) {
+	    if (NULL == (w = new_world (BENCH_NEW_WORLDS, NULL, NULL)) ||
+		NULL == get_room (w, room_syms.n - 1)) {
+		PANIC ("can't start a game");
+	    }
+	    free_world (w);
+	}
+	(void)clock_gettime (CLOCK_MONOTONIC, &done);
+	new_ns = ((done.tv_sec - start.tv_sec) * 1e9 + done.tv_nsec -
+		  start.tv_nsec) / BENCH_NEW_WORLDS;
+	get_world_stats (&ws);
+	printf ("%8d %9zu %10.3f %10.0f %12.1f %12.1f %12.1f\n", ws.rooms,
+		ws.file_bytes, ws.load_ns / 1e6, (double)ws.load_ns / ws.rooms,
+		(double)ws.shared_bytes / ws.rooms,
+		(double)ws.world_bytes / ws.rooms, new_ns / 1e3);
+    }
+    printf ("%d of %d photos read (none are needed to start a game)\n",
+	    ws.photos_read, ws.photos);
+    forget_world ();
+    (void)remove (BENCH_WORLD_FILE);
+    return 0;
+}
+
+#endif /* defined(WORLD_BENCH_PROGRAM) */
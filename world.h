@@ -36,7 +36,10 @@
 #define WORLD_H
 
 
+#include <stddef.h>
+
 #include "types.h"
+#include "verbs.h"
 
 
 /* structure access functions */
@@ -50,18 +53,71 @@ extern photo_t* room_photo (const room_t* r);
 extern uint32_t room_photo_height (const room_t* r);
 extern uint32_t room_photo_width (const room_t* r);
 
-/* Build the game world.  Returns 0 on failure, or 1 on success. */
-extern int32_t build_world (void);
+/* 
+ * Read the description of the world shared by all worlds (its rooms,
+ * connections, objects, and photo swaps) from a world file, in the
+ * format shown in adventure.world, along with the object images.  Room
+ * photos are read when first needed.  Call before new_world; calling
+ * again replaces the description, so no world may remain.  Returns 0 on
+ * failure, or 1 on success.
+ */
+extern int32_t build_world (const char* fname);
+
+/* the size of the world description, and the cost of loading it */
+typedef struct {
+    int32_t  rooms;        /* rooms described                          */
+    int32_t  objects;      /* objects described                        */
+    int32_t  names;        /* distinct object names                    */
+    int32_t  photos;       /* distinct room photos                     */
+    int32_t  photos_read;  /* room photos read so far                  */
+    int32_t  images;       /* distinct object images                   */
+    uint64_t load_ns;      /* time taken by build_world (no photos)    */
+    uint64_t prefault_ns;  /* time taken by prefault_world             */
+    size_t   file_bytes;   /* length of the world file                 */
+    size_t   shared_bytes; /* memory held by the description (without
+			      the pixels of photos and images)         */
+    size_t   world_bytes;  /* memory allocated for each world          */
+} world_stats_t;
+
+/* Get statistics on the world description read by build_world. */
+extern void get_world_stats (world_stats_t* s);
+
+/* function that shows a world's status messages, with its argument */
+typedef void (*world_status_fn_t) (void* arg, const char* msg);
+
+/*
+ * Start a game in a new world, with objects placed and the game played
+ * as rand would after srand (seed); status messages are passed to show
+ * (if not NULL).  Worlds are independent, so any number may be played at
+ * once, by one thread each.  Returns NULL if memory runs out.
+ */
+extern world_t* new_world (unsigned int seed, world_status_fn_t show, 
+			   void* arg);
+
+/* Free a world (the shared photos and images are kept). */
+extern void free_world (world_t* w);
+
+/* Get the bytes of memory allocated for each world. */
+extern size_t world_size (void);
 
 /* Get pointer to starting room for player. */
-extern room_t* start_in_room (void);
+extern room_t* start_in_room (world_t* w);
+
+/* Get pointer to room number idx (from 0), or NULL if there is none. */
+extern room_t* get_room (world_t* w, int32_t idx);
+
+/* 
+ * Read any room photos not yet read and fault in all room photos and
+ * object images; returns the bytes touched.
+ */
+extern size_t prefault_world (void);
 
 /*
  * checks for accelerator object ownership; these make horizontal (board)
  * and vertical (jetpack) pixel panning faster
  */
-extern int32_t player_has_board ();
-extern int32_t player_has_jetpack ();
+extern int32_t player_has_board (const world_t* w);
+extern int32_t player_has_jetpack (const world_t* w);
 
 /* responses possible for command actions */
 typedef enum {
@@ -76,6 +132,14 @@ extern tc_action_t try_to_move_left (room_t** rptr);
 extern tc_action_t try_to_enter (room_t** rptr);
 extern tc_action_t try_to_move_right (room_t** rptr);
 
+/*
+ * Carry out a typed command (a verb and its argument), showing a message
+ * if the verb is unknown.  Sets *verb to the verb's command, or to
+ * NUM_TC_VALUES if there is none.
+ */
+extern tc_action_t typed_command (room_t** rptr, const char* typed, 
+				  cmd_id_t* verb);
+
 /* typed command actions */
 extern tc_action_t typed_cmd_buy (room_t** rptr, const char* arg);
 extern tc_action_t typed_cmd_charge (room_t** rptr, const char* arg);
@@ -92,7 +156,4 @@ extern tc_action_t typed_cmd_sigh (room_t** rptr, const char* arg);
 extern tc_action_t typed_cmd_use (room_t** rptr, const char* arg);
 extern tc_action_t typed_cmd_wear (room_t** rptr, const char* arg);
 
-/* in adventure.c */
-extern void show_status (const char* s);
-
 #endif /* WORLD_H */